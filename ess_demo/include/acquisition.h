@@ -0,0 +1,66 @@
+/**
+ * @file acquisition.h
+ * @brief Sensor acquisition thread which reads the sensor off the system
+ * workqueue and passes samples to the consumers
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __ACQUISITION_H__
+#define __ACQUISITION_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <sys/slist.h>
+
+#include "sample.h"
+#include "sample_ring.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+/* Samples are written to the sample ring, consumers read them using their
+ * own struct sample_ring_reader and are notified of new samples through
+ * their work item
+ */
+struct acquisition_consumer {
+	sys_snode_t node;
+	/* Work item submitted after each new sample */
+	struct k_work *work;
+};
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Registers a consumer which will be notified of all future samples
+ *
+ * @param Consumer to register
+ */
+void acquisition_register_consumer(struct acquisition_consumer *consumer);
+
+/**
+ * @brief Starts the periodic gas measurements if the sensor supports
+ * measuring gas separately, each one runs after the next sample so the heater
+ * does not delay the temperature, humidity and pressure readings
+ */
+void acquisition_start_gas(void);
+
+/**
+ * @brief Requests a new sample, the sensor is read from the acquisition
+ * thread so this returns immediately and can be called from an ISR
+ */
+void acquisition_trigger(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ACQUISITION_H__ */
@@ -0,0 +1,41 @@
+/**
+ * @file advertising.h
+ * @brief Advertising, optionally broadcasting the latest readings in the
+ * advertising data so they can be collected without connecting, using
+ * legacy or extended advertising and optionally a periodic advertising
+ * train carrying the most recent samples
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __ADVERTISING_H__
+#define __ADVERTISING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Starts connectable advertising and, if enabled, the periodic
+ * advertising train. In beacon mode the advertising data is updated with
+ * each new sample
+ *
+ * @retval 0 on success, negative error code from the Bluetooth stack
+ * otherwise
+ */
+int advertising_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ADVERTISING_H__ */
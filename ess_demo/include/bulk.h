@@ -0,0 +1,60 @@
+/**
+ * @file bulk.h
+ * @brief LE L2CAP connection oriented channel for bulk transfer of the
+ * sample history, live samples and throughput measurements
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __BULK_H__
+#define __BULK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+/* Results of the last throughput test and of the live samples sent since
+ * the channel was connected
+ */
+struct bulk_stats {
+	uint32_t bytes;
+	uint32_t duration_ms;
+	uint32_t samples;
+	uint32_t samples_dropped;
+	uint32_t latency_min_ms;
+	uint32_t latency_max_ms;
+	uint64_t latency_total_ms;
+};
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Registers the L2CAP server on CONFIG_ESS_BULK_PSM
+ *
+ * @retval 0 on success, negative error code from the Bluetooth stack
+ * otherwise
+ */
+int bulk_init(void);
+
+/**
+ * @brief Gets the transfer statistics
+ *
+ * @param Statistics output
+ */
+void bulk_get_stats(struct bulk_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BULK_H__ */
@@ -0,0 +1,96 @@
+/**
+ * @file chart_reducer.h
+ * @brief Incremental min/max downsampling of samples to a fixed number of
+ * chart points covering a time window
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __CHART_REDUCER_H__
+#define __CHART_REDUCER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+#define CHART_REDUCER_SERIES 4
+#define CHART_REDUCER_POINTS CONFIG_ESS_DISPLAY_CHART_POINTS
+
+/* Each bucket is drawn as two points, its minimum and maximum */
+#define CHART_REDUCER_BUCKETS (CHART_REDUCER_POINTS / 2)
+
+/* Window divided into buckets, the points of closed buckets are held in a
+ * ring which can be drawn directly
+ */
+struct chart_reducer_level {
+	uint32_t bucket_ms;
+	/* Points in the ring, fewer than CHART_REDUCER_POINTS if the buckets
+	 * would otherwise be shorter than the minimum
+	 */
+	uint16_t point_count;
+	/* Uptime at which the open bucket closes, 0 before the first sample */
+	int64_t bucket_end;
+	/* Value of empty buckets before the first sample */
+	int16_t blank;
+	bool primed;
+	/* Open bucket */
+	uint16_t count;
+	int16_t min[CHART_REDUCER_SERIES];
+	int16_t max[CHART_REDUCER_SERIES];
+	bool max_first[CHART_REDUCER_SERIES];
+	int16_t last[CHART_REDUCER_SERIES];
+	/* Index of the next point to be written, below point_count */
+	uint16_t head;
+	int16_t points[CHART_REDUCER_SERIES][CHART_REDUCER_POINTS];
+};
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Initialises a level with all points blank
+ *
+ * @param Level to initialise
+ * @param Time covered by all points of the level in ms
+ * @param Shortest bucket in ms, e.g. the minimum sample period so that
+ * every bucket can hold a sample, 0 for no minimum
+ * @param Value of points with no samples, e.g. LV_CHART_POINT_DEF
+ */
+void chart_reducer_init(struct chart_reducer_level *level, uint32_t window_ms,
+			uint32_t min_bucket_ms, int16_t blank);
+
+/**
+ * @brief Clears all points and the open bucket of a level
+ *
+ * @param Level to clear
+ */
+void chart_reducer_clear(struct chart_reducer_level *level);
+
+/**
+ * @brief Adds a sample to the open bucket, closing it first if the sample
+ * is past its end. This is O(1) unless buckets were skipped, buckets
+ * without samples repeat the last value
+ *
+ * @param Level to add to
+ * @param Uptime of the sample in ms
+ * @param Value of each series
+ *
+ * @retval Number of points written, starting at the head before the call
+ */
+uint16_t chart_reducer_add(struct chart_reducer_level *level, int64_t time,
+			   const int16_t *values);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CHART_REDUCER_H__ */
@@ -0,0 +1,94 @@
+/**
+ * @file conn_policy.h
+ * @brief Connection parameter policy, requests short intervals whilst bulk
+ * data is being transferred and long intervals with peripheral latency
+ * whilst only periodic updates are sent
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __CONN_POLICY_H__
+#define __CONN_POLICY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <bluetooth/conn.h>
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+enum conn_policy_profile {
+	/* Parameters chosen by the central, not yet changed */
+	CONN_POLICY_PROFILE_CENTRAL = 0,
+	CONN_POLICY_PROFILE_FAST,
+	CONN_POLICY_PROFILE_SLOW,
+};
+
+struct conn_policy_params {
+	/* Current parameters, in 1.25 ms, connection event and 10 ms units */
+	uint16_t interval;
+	uint16_t latency;
+	uint16_t timeout;
+	/* Last profile requested */
+	enum conn_policy_profile profile;
+	/* Number of parameter updates since connecting */
+	uint16_t updates;
+};
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Registers the connection callbacks used to track the parameters
+ */
+void conn_policy_init(void);
+
+/**
+ * @brief Marks the start of a bulk transfer or high rate stream on a
+ * connection, the fast parameters are requested until the matching
+ * conn_policy_bulk_end()
+ *
+ * @param Connection
+ */
+void conn_policy_bulk_begin(struct bt_conn *conn);
+
+/**
+ * @brief Marks the end of a bulk transfer or high rate stream, the slow
+ * parameters are requested once no transfers have run for
+ * CONFIG_ESS_CONN_SLOW_DELAY_MS
+ *
+ * @param Connection
+ */
+void conn_policy_bulk_end(struct bt_conn *conn);
+
+/**
+ * @brief Requests the profiles are re-evaluated, for example after the
+ * sample period changes or a central subscribes or unsubscribes. Subscribed
+ * connections use the fast parameters whilst the sample period is at most
+ * CONFIG_ESS_CONN_STREAM_PERIOD_MS
+ */
+void conn_policy_update(void);
+
+/**
+ * @brief Gets the current parameters of a connection
+ *
+ * @param Connection
+ * @param Parameters output
+ *
+ * @retval 0 on success, -ENOTCONN if the connection is not tracked
+ */
+int conn_policy_get_params(struct bt_conn *conn,
+			   struct conn_policy_params *params);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONN_POLICY_H__ */
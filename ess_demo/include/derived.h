@@ -0,0 +1,126 @@
+/**
+ * @file derived.h
+ * @brief Metrics derived from the sensor readings, such as the dew point,
+ * which are calculated once per sample for all consumers
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __DERIVED_H__
+#define __DERIVED_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+enum derived_metric {
+	/* Dew point in degrees celsius (C) in 0.01 units */
+	DERIVED_METRIC_DEW_POINT = 0,
+	/* Absolute humidity in grams per cubic metre (g/m3) in 0.01 units */
+	DERIVED_METRIC_ABSOLUTE_HUMIDITY,
+	/* Heat index in degrees celsius (C) in 0.01 units */
+	DERIVED_METRIC_HEAT_INDEX,
+	/* Barometric altitude in metres (m) in 0.01 units */
+	DERIVED_METRIC_ALTITUDE,
+	/* Pressure change in pascals per hour (Pa/h) in 0.1 units */
+	DERIVED_METRIC_PRESSURE_TREND,
+	/* Indoor air quality index from 0 (clean) to 500 (polluted) */
+	DERIVED_METRIC_IAQ,
+
+	DERIVED_METRIC_COUNT
+};
+
+#define DERIVED_METRICS_ALL (BIT(DERIVED_METRIC_COUNT) - 1)
+
+#define DERIVED_TREND_SLOTS 12
+
+struct ess_sample;
+
+/* History kept between samples by the stateful metrics */
+struct derived_state {
+	/* Pressure snapshots for the trend, a slot is written every
+	 * 1 / DERIVED_TREND_SLOTS of the trend window
+	 */
+	int64_t trend_timestamp[DERIVED_TREND_SLOTS];
+	uint32_t trend_pressure[DERIVED_TREND_SLOTS];
+	uint8_t trend_head;
+	uint8_t trend_count;
+	/* Gas resistance of clean air in ohms which the IAQ is relative to */
+	uint32_t gas_baseline;
+	/* Number of gas resistance measurements tracked, up to the burn in */
+	uint32_t gas_samples;
+	/* Gas sequence number of the last measurement tracked */
+	uint32_t gas_sequence;
+};
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Clears the history of the stateful metrics
+ *
+ * @param State to initialise
+ */
+void derived_state_init(struct derived_state *state);
+
+/**
+ * @brief Calculates the requested metrics of a sample, intermediate terms
+ * such as the Magnus gamma are only calculated once however many of the
+ * metrics need them. Stateful metrics track every sample whether or not they
+ * are requested, so that they are valid as soon as they are
+ *
+ * @param History of the stateful metrics
+ * @param Bit mask of the enum derived_metric values to calculate
+ * @param Sample to read the inputs from and store the derived values in
+ *
+ * @retval Bit mask of the metrics which could be calculated, metrics whose
+ * inputs are not measured or whose history is not long enough are skipped
+ */
+uint32_t derived_evaluate(struct derived_state *state, uint32_t metrics,
+			  struct ess_sample *sample);
+
+/**
+ * @brief Adds a consumer of metrics, each metric is calculated whilst at
+ * least one consumer demands it
+ *
+ * @param Bit mask of the enum derived_metric values
+ */
+void derived_demand(uint32_t metrics);
+
+/**
+ * @brief Removes a consumer of metrics added by derived_demand()
+ *
+ * @param Bit mask of the enum derived_metric values
+ */
+void derived_release(uint32_t metrics);
+
+/**
+ * @brief Gets the metrics which at least one consumer demands
+ *
+ * @retval Bit mask of the enum derived_metric values
+ */
+uint32_t derived_get_demand(void);
+
+/**
+ * @brief Gets the name of a metric
+ *
+ * @param Metric
+ *
+ * @retval Name of the metric
+ */
+const char *derived_metric_name(enum derived_metric metric);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DERIVED_H__ */
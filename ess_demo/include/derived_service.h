@@ -0,0 +1,48 @@
+/**
+ * @file derived_service.h
+ * @brief Vendor specific service notifying the derived metrics selected by
+ * each connection
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __DERIVED_SERVICE_H__
+#define __DERIVED_SERVICE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <bluetooth/uuid.h>
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+#define BT_UUID_DERIVED_SERVICE_VAL                                            \
+	BT_UUID_128_ENCODE(0x8a7f1300, 0x4b2d, 0x4f3e, 0x9c5a, 0x6e0b2d4c3a10)
+#define BT_UUID_DERIVED_METRICS_VAL                                            \
+	BT_UUID_128_ENCODE(0x8a7f1301, 0x4b2d, 0x4f3e, 0x9c5a, 0x6e0b2d4c3a10)
+
+#define BT_UUID_DERIVED_SERVICE                                                \
+	BT_UUID_DECLARE_128(BT_UUID_DERIVED_SERVICE_VAL)
+#define BT_UUID_DERIVED_METRICS                                                \
+	BT_UUID_DECLARE_128(BT_UUID_DERIVED_METRICS_VAL)
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Initialises the derived metrics service
+ */
+void derived_service_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DERIVED_SERVICE_H__ */
@@ -20,17 +20,38 @@ extern "C" {
 /* Global Function Prototypes                                                 */
 /******************************************************************************/
 /**
- * @brief Calculates the dew point of a given temperature and humidity
+ * @brief Calculates the Magnus gamma term, ln(RH) + (b * T) / (c + T), which
+ * is shared by the dew point and the vapour pressure
+ *
+ * @param Temperature in degrees celsius (C) in 0.01 units
+ * @param Humidity in percent (%) in 0.01 units
+ *
+ * @retval Gamma in Q16.16
+ */
+int32_t calculate_magnus_gamma(int16_t temperature, uint16_t humidity);
+
+/**
+ * @brief Calculates the dew point from the Magnus gamma term
+ *
+ * @param Gamma in Q16.16 from calculate_magnus_gamma()
+ *
+ * @retval Dew point in degrees celsius (C) in 0.01 units
+ */
+int16_t calculate_dew_point_gamma(int32_t gamma);
+
+/**
+ * @brief Calculates the dew point of a given temperature and humidity using
+ * integer maths only, with a lookup table approximation of the logarithm
  *
  * @note The formula for calculating the dew point was adapted from
  * http://irtfweb.ifa.hawaii.edu/~tcs3/tcs3/Misc/Dewpoint_Calculation_Humidity_Sensor_E.pdf
  *
- * @param Temperature in degrees celsius (C)
- * @param Humidity in percent (%)
+ * @param Temperature in degrees celsius (C) in 0.01 units
+ * @param Humidity in percent (%) in 0.01 units
  *
- * @retval Dew point in celsius
+ * @retval Dew point in degrees celsius (C) in 0.01 units
  */
-int8_t calculate_dew_point(float temperature, float humidity);
+int16_t calculate_dew_point_fixed(int16_t temperature, uint16_t humidity);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,108 @@
+/**
+ * @file ess_service.h
+ * @brief Environmental Sensing Service with batched notifications
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __ESS_SERVICE_H__
+#define __ESS_SERVICE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/uuid.h>
+
+#include "sample.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+/* Vendor specific characteristic holding all readings of a sample */
+#define BT_UUID_ESS_PACKED_VAL                                                 \
+	BT_UUID_128_ENCODE(0x8a7f1001, 0x4b2d, 0x4f3e, 0x9c5a, 0x6e0b2d4c3a10)
+#define BT_UUID_ESS_PACKED BT_UUID_DECLARE_128(BT_UUID_ESS_PACKED_VAL)
+
+/* Vendor specific characteristic holding the sampling period */
+#define BT_UUID_ESS_SAMPLE_PERIOD_VAL                                          \
+	BT_UUID_128_ENCODE(0x8a7f1002, 0x4b2d, 0x4f3e, 0x9c5a, 0x6e0b2d4c3a10)
+#define BT_UUID_ESS_SAMPLE_PERIOD                                              \
+	BT_UUID_DECLARE_128(BT_UUID_ESS_SAMPLE_PERIOD_VAL)
+
+/* Vendor specific characteristic holding the connection parameters of the
+ * reading central
+ */
+#define BT_UUID_ESS_CONN_PARAMS_VAL                                            \
+	BT_UUID_128_ENCODE(0x8a7f1003, 0x4b2d, 0x4f3e, 0x9c5a, 0x6e0b2d4c3a10)
+#define BT_UUID_ESS_CONN_PARAMS                                                \
+	BT_UUID_DECLARE_128(BT_UUID_ESS_CONN_PARAMS_VAL)
+
+/* Vendor specific characteristic holding the gas sensor resistance */
+#define BT_UUID_ESS_GAS_RESISTANCE_VAL                                         \
+	BT_UUID_128_ENCODE(0x8a7f1004, 0x4b2d, 0x4f3e, 0x9c5a, 0x6e0b2d4c3a10)
+#define BT_UUID_ESS_GAS_RESISTANCE                                             \
+	BT_UUID_DECLARE_128(BT_UUID_ESS_GAS_RESISTANCE_VAL)
+
+/* Vendor specific characteristic holding the reading filter settings */
+#define BT_UUID_ESS_FILTER_CONFIG_VAL                                          \
+	BT_UUID_128_ENCODE(0x8a7f1005, 0x4b2d, 0x4f3e, 0x9c5a, 0x6e0b2d4c3a10)
+#define BT_UUID_ESS_FILTER_CONFIG                                              \
+	BT_UUID_DECLARE_128(BT_UUID_ESS_FILTER_CONFIG_VAL)
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Initialises the ESS service
+ */
+void ess_service_init(void);
+
+/**
+ * @brief Counts the connections subscribed to notifications of any of the
+ * ESS characteristics
+ *
+ * @retval Number of subscribed connections
+ */
+uint32_t ess_service_subscriber_count(void);
+
+/**
+ * @brief Checks if a connection is subscribed to notifications of any of
+ * the ESS characteristics
+ *
+ * @param Connection
+ *
+ * @retval True if subscribed
+ */
+bool ess_service_is_subscribed(struct bt_conn *conn);
+
+/**
+ * @brief Sets the update interval reported in the ES Measurement descriptors
+ *
+ * @param Update interval in seconds
+ */
+void ess_service_set_update_interval(uint32_t seconds);
+
+/**
+ * @brief Updates the characteristic values from a sample and notifies each
+ * subscribed connection of the characteristics whose ES Trigger Setting
+ * condition for that connection is met. Connections subscribed to the packed
+ * characteristic receive a single notification with all readings, others
+ * receive the standard characteristics as a multiple handle notification
+ * where the central supports it, otherwise as separate notifications
+ *
+ * @param Sample to send
+ */
+void ess_service_update(const struct ess_sample *sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ESS_SERVICE_H__ */
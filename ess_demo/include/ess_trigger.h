@@ -0,0 +1,125 @@
+/**
+ * @file ess_trigger.h
+ * @brief ESS Trigger Setting descriptor parsing and evaluation
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __ESS_TRIGGER_H__
+#define __ESS_TRIGGER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+/* Condition (1 byte) followed by an operand of up to 4 bytes */
+#define ESS_TRIGGER_MAX_SIZE 5
+
+/* Trigger conditions from the Environmental Sensing Service specification */
+enum ess_trigger_condition {
+	ESS_TRIGGER_INACTIVE = 0x00,
+	ESS_TRIGGER_FIXED_INTERVAL = 0x01,
+	ESS_TRIGGER_MIN_INTERVAL = 0x02,
+	ESS_TRIGGER_VALUE_CHANGED = 0x03,
+	ESS_TRIGGER_LESS_THAN = 0x04,
+	ESS_TRIGGER_LESS_THAN_OR_EQUAL = 0x05,
+	ESS_TRIGGER_GREATER_THAN = 0x06,
+	ESS_TRIGGER_GREATER_THAN_OR_EQUAL = 0x07,
+	ESS_TRIGGER_EQUAL = 0x08,
+	ESS_TRIGGER_NOT_EQUAL = 0x09,
+
+	ESS_TRIGGER_CONDITION_COUNT
+};
+
+/* Value of a Trigger Setting descriptor */
+struct ess_trigger {
+	uint8_t condition;
+	/* Time in seconds for interval conditions, the deadband for the value
+	 * changed condition, otherwise the value to compare against in the
+	 * units of the characteristic
+	 */
+	int32_t operand;
+	/* Descriptor value as written, returned on reads */
+	uint8_t raw[ESS_TRIGGER_MAX_SIZE];
+	uint8_t raw_size;
+};
+
+/* Value and time of the last notification sent for a trigger */
+struct ess_trigger_state {
+	bool notified;
+	int32_t value;
+	int64_t time;
+};
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Parses a written Trigger Setting descriptor value
+ *
+ * @note The value changed condition takes an optional operand, the minimum
+ * change from the last notified value needed to trigger. Without an operand
+ * any change triggers, as per the specification
+ *
+ * @param Trigger to update, only updated if the value is valid
+ * @param Written descriptor value
+ * @param Size of the written value
+ * @param Size of the characteristic value in bytes
+ * @param True if the characteristic value is signed
+ *
+ * @retval 0 on success, -ENOTSUP if the condition is not supported, -EINVAL
+ * if the operand size is invalid
+ */
+int ess_trigger_parse(struct ess_trigger *trigger, const uint8_t *data,
+		      uint16_t size, uint8_t value_size, bool value_signed);
+
+/**
+ * @brief Sets a trigger to a condition and operand
+ *
+ * @param Trigger to set
+ * @param Condition
+ * @param Operand
+ * @param Size of the characteristic value in bytes
+ */
+void ess_trigger_set(struct ess_trigger *trigger,
+		     enum ess_trigger_condition condition, int32_t operand,
+		     uint8_t value_size);
+
+/**
+ * @brief Checks if a new value should be notified
+ *
+ * @param Trigger setting
+ * @param State of the last notification
+ * @param New value in the units of the characteristic
+ * @param Current uptime in ms
+ *
+ * @retval True if the value should be notified
+ */
+bool ess_trigger_evaluate(const struct ess_trigger *trigger,
+			  const struct ess_trigger_state *state, int32_t value,
+			  int64_t now);
+
+/**
+ * @brief Records that a value has been notified
+ *
+ * @param State to update
+ * @param Notified value
+ * @param Current uptime in ms
+ */
+void ess_trigger_notified(struct ess_trigger_state *state, int32_t value,
+			  int64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ESS_TRIGGER_H__ */
@@ -0,0 +1,133 @@
+/**
+ * @file filter.h
+ * @brief Streaming noise filter which rejects outliers from the sensor
+ * readings before they are published
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FILTER_H__
+#define __FILTER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+#include "sample.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+enum filter_channel {
+	FILTER_CHANNEL_TEMPERATURE = 0,
+	FILTER_CHANNEL_HUMIDITY,
+	FILTER_CHANNEL_PRESSURE,
+
+	FILTER_CHANNEL_COUNT
+};
+
+/* Longest median window, windows must be odd */
+#define FILTER_MEDIAN_WINDOW_MAX 5
+
+/* Longest moving average time constant, as a power of two samples */
+#define FILTER_EMA_SHIFT_MAX 6
+
+/* Fraction bits of the moving average, so that a long time constant does
+ * not round away small changes
+ */
+#define FILTER_EMA_FRACTION_BITS 8
+
+struct filter_config {
+	/* Number of readings the median is taken over, 1 disables it */
+	uint8_t median_window;
+	/* Weight of a new reading in the moving average is 1 / 2^ema_shift,
+	 * 0 disables it
+	 */
+	uint8_t ema_shift;
+	/* Largest change per minute in the units of the reading, 0 disables
+	 * the limit
+	 */
+	uint32_t max_rate;
+};
+
+struct filter_channel_state {
+	/* Newest readings for the median */
+	int32_t window[FILTER_MEDIAN_WINDOW_MAX];
+	uint8_t head;
+	/* Output of the rate limit */
+	int32_t limited;
+	/* Moving average in 1 / 2^FILTER_EMA_FRACTION_BITS units */
+	int32_t average;
+};
+
+/* History kept between samples, the first sample primes it */
+struct filter_state {
+	struct filter_channel_state channels[FILTER_CHANNEL_COUNT];
+	int64_t timestamp;
+	bool primed;
+};
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Clears the history of the filter, the next sample is passed
+ * through unchanged
+ *
+ * @param State to initialise
+ */
+void filter_state_init(struct filter_state *state);
+
+/**
+ * @brief Filters the temperature, humidity and pressure of a sample in
+ * place. Each reading passes through a median of the newest readings, a
+ * limit on the rate of change since the previous sample and an
+ * exponential moving average, each stage has a constant cost
+ *
+ * @param History of the filter
+ * @param Sample with the raw readings and timestamp, the readings are
+ * replaced with the filtered values
+ */
+void filter_apply(struct filter_state *state, struct ess_sample *sample);
+
+/**
+ * @brief Sets the filter settings of a channel, the history is kept so
+ * the change applies from the next sample
+ *
+ * @param Channel to configure
+ * @param New settings
+ *
+ * @retval 0 on success, -EINVAL if the channel or a setting is invalid
+ */
+int filter_configure(enum filter_channel channel,
+		     const struct filter_config *config);
+
+/**
+ * @brief Gets the filter settings of a channel
+ *
+ * @param Channel
+ * @param Current settings
+ */
+void filter_get_config(enum filter_channel channel,
+		       struct filter_config *config);
+
+/**
+ * @brief Gets the name of a channel
+ *
+ * @param Channel
+ *
+ * @retval Name of the channel
+ */
+const char *filter_channel_name(enum filter_channel channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FILTER_H__ */
@@ -0,0 +1,58 @@
+/**
+ * @file fixed_math.h
+ * @brief Q16.16 fixed point logarithm and exponential shared by the dew
+ * point and derived metric calculations
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FIXED_MATH_H__
+#define __FIXED_MATH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+#define FIXED_Q16_ONE 65536
+
+/* Largest argument of fixed_exp_q16() whose result fits in 32 bits */
+#define FIXED_EXP_Q16_MAX 726000 /* 11.08 */
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Calculates the natural logarithm of an integer, the table
+ * approximation is accurate to around 1e-4
+ *
+ * @param Value to take the logarithm of, any value from 1 to UINT32_MAX
+ *
+ * @retval ln(value) in Q16.16
+ */
+int32_t fixed_ln_q16(uint32_t value);
+
+/**
+ * @brief Calculates e to the power of a Q16.16 value, the table
+ * approximation has a relative error of around 1e-4 for results above 1,
+ * smaller results are limited by the Q16.16 resolution
+ *
+ * @param Exponent in Q16.16, clamped to FIXED_EXP_Q16_MAX
+ *
+ * @retval exp(x) in Q16.16, 0 if it is too small to be represented
+ */
+uint32_t fixed_exp_q16(int32_t x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FIXED_MATH_H__ */
@@ -0,0 +1,91 @@
+/**
+ * @file history.h
+ * @brief Compressed sample history, kept in a RAM ring of blocks with
+ * optional spillover of the oldest blocks to flash
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __HISTORY_H__
+#define __HISTORY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#ifdef CONFIG_ESS_HISTORY_FCB
+#include <fs/fcb.h>
+#endif
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+/* Each block starts with a header, little endian:
+ *   uint32 first sequence number
+ *   uint32 last sequence number
+ *   uint16 size of the block including the header
+ *   uint16 number of records
+ * followed by the records. The first record holds the sequence number,
+ * timestamp (ms), temperature, humidity and pressure of a sample as
+ * varints, later records hold the difference from the previous sample.
+ * Signed values are zigzag encoded.
+ */
+#define HISTORY_BLOCK_HEADER_SIZE 12
+
+/* Position in the history whilst reading blocks */
+struct history_cursor {
+	uint32_t first_sequence;
+	uint32_t last_sequence;
+#ifdef CONFIG_ESS_HISTORY_FCB
+	bool in_flash;
+	struct fcb_entry flash_entry;
+#endif
+	/* Next RAM block to read */
+	uint32_t block;
+};
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Starts recording samples to the history. Blocks spilled to flash
+ * by a previous boot are erased, as sequence numbers and timestamps restart
+ * from 0 after a reset
+ */
+void history_init(void);
+
+/**
+ * @brief Initialises a cursor to read the blocks holding a range of samples,
+ * oldest first
+ *
+ * @param Cursor to initialise
+ * @param First sequence number of the range
+ * @param Last sequence number of the range
+ */
+void history_cursor_init(struct history_cursor *cursor,
+			 uint32_t first_sequence, uint32_t last_sequence);
+
+/**
+ * @brief Reads the next block holding samples in the range of a cursor,
+ * blocks may also hold samples outside of the range. Must be called from
+ * the system workqueue, which records the samples
+ *
+ * @param Cursor
+ * @param Buffer for the block
+ * @param Size of the buffer, at least CONFIG_ESS_HISTORY_BLOCK_SIZE
+ *
+ * @retval Size of the block, 0 if there are no more blocks in the range
+ */
+size_t history_read_block(struct history_cursor *cursor, uint8_t *data,
+			  size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HISTORY_H__ */
@@ -0,0 +1,50 @@
+/**
+ * @file history_service.h
+ * @brief Vendor specific service which streams ranges of the sample history
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __HISTORY_SERVICE_H__
+#define __HISTORY_SERVICE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <bluetooth/uuid.h>
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+#define BT_UUID_HISTORY_SERVICE_VAL                                            \
+	BT_UUID_128_ENCODE(0x8a7f1100, 0x4b2d, 0x4f3e, 0x9c5a, 0x6e0b2d4c3a10)
+#define BT_UUID_HISTORY_CONTROL_POINT_VAL                                      \
+	BT_UUID_128_ENCODE(0x8a7f1101, 0x4b2d, 0x4f3e, 0x9c5a, 0x6e0b2d4c3a10)
+#define BT_UUID_HISTORY_DATA_VAL                                               \
+	BT_UUID_128_ENCODE(0x8a7f1102, 0x4b2d, 0x4f3e, 0x9c5a, 0x6e0b2d4c3a10)
+
+#define BT_UUID_HISTORY_SERVICE                                                \
+	BT_UUID_DECLARE_128(BT_UUID_HISTORY_SERVICE_VAL)
+#define BT_UUID_HISTORY_CONTROL_POINT                                          \
+	BT_UUID_DECLARE_128(BT_UUID_HISTORY_CONTROL_POINT_VAL)
+#define BT_UUID_HISTORY_DATA BT_UUID_DECLARE_128(BT_UUID_HISTORY_DATA_VAL)
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Initialises the history service
+ */
+void history_service_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HISTORY_SERVICE_H__ */
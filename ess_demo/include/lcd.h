@@ -24,8 +24,23 @@ extern "C" {
 #include <drivers/display.h>
 #include <lvgl.h>
 
+#include "sample.h"
+
 #ifdef CONFIG_DISPLAY
 
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+/* Display loop activity since boot */
+struct lcd_stats {
+	/* Number of times the display work has run */
+	uint32_t wakeups;
+	/* Time with the LVGL refresh and input tasks turned off */
+	uint32_t idle_ms;
+	/* Time spent running the display work */
+	uint32_t busy_us;
+};
+
 /******************************************************************************/
 /* Global Function Prototypes                                                 */
 /******************************************************************************/
@@ -45,31 +60,37 @@ void setup_lcd(bool error, char *error_string);
 bool is_lcd_present(void);
 
 /**
- * @brief Updates the current graph results
+ * @brief Adds a sample to the graph, this is called for each new sample
+ * from the sample ring
  *
- * @param Temperature in degrees celsius (C)
- * @param Humidity in percent (%)
- * @param Pressure in pascals (pa)
- * @param Dew point in degrees celsius (C)
+ * @param Sample to add
  */
-void update_lcd_graph(float temperature, float humidity, float pressure,
-		      float dew_point);
+void update_lcd_graph(const struct ess_sample *sample);
 
 /**
- * @brief Updates the display with the connected device's address (if connected)
+ * @brief Updates the display with a connected device's address (if connected)
  *
+ * @param Index of the connection
  * @param True if connected, otherwise false
  * @param Type of the address
  * @param BLE address byte array
  */
-void update_lcd_connected_address(bool connected, uint8_t type,
-				  const uint8_t *address);
+void update_lcd_connected_address(uint8_t index, bool connected,
+				  uint8_t type, const uint8_t *address);
 
 /**
- * @brief Updates the LCD display text
+ * @brief Rebuilds the connection status text (the uptime is updated
+ * separately), must only be called from the display work
  */
 void update_lcd_text(void);
 
+/**
+ * @brief Gets the display loop activity counters
+ *
+ * @param Filled with the counters
+ */
+void lcd_get_stats(struct lcd_stats *stats);
+
 #endif
 
 #ifdef __cplusplus
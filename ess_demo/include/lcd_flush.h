@@ -0,0 +1,59 @@
+/**
+ * @file lcd_flush.h
+ * @brief Flushes rendered LVGL stripes to the display from a separate
+ * thread, so the SPI transfer of one stripe overlaps rendering of the next
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __LCD_FLUSH_H__
+#define __LCD_FLUSH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+/* Flush activity since boot */
+struct lcd_flush_stats {
+	/* Number of stripes written to the display */
+	uint32_t stripes;
+	/* Time the SPI bus was busy writing stripes */
+	uint32_t bus_us;
+	/* Time LVGL waited for a flush before it could render */
+	uint32_t wait_us;
+};
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Replaces the flush callback of the default LVGL display with one
+ * which hands the stripe to the flush thread and returns straight away.
+ * Requires two render buffers (CONFIG_LVGL_DOUBLE_VDB) so that LVGL renders
+ * into the other buffer whilst the transfer is in progress
+ *
+ * @retval 0 on success, -ENODEV if there is no LVGL display
+ */
+int lcd_flush_init(void);
+
+/**
+ * @brief Gets the flush activity counters
+ *
+ * @param Filled with the counters
+ */
+void lcd_flush_get_stats(struct lcd_flush_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LCD_FLUSH_H__ */
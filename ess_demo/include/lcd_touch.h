@@ -0,0 +1,53 @@
+/**
+ * @file lcd_touch.h
+ * @brief LVGL pointer input from the touch controller, the display loop is
+ * woken from the touch interrupt instead of polling for input
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __LCD_TOUCH_H__
+#define __LCD_TOUCH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+typedef void (*lcd_touch_wakeup_t)(void);
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Registers the touch controller as an LVGL pointer input device,
+ * must be called after the display has been set up
+ *
+ * @param Function called from the touch callback for each touch event
+ *
+ * @retval 0 on success, -ENODEV if the touch controller was not found
+ */
+int lcd_touch_init(lcd_touch_wakeup_t wakeup);
+
+/**
+ * @brief Checks if LVGL still has touch input to process, whilst this is
+ * the case the input device must keep being read
+ *
+ * @retval True if the panel is pressed or a touch event has not yet been
+ * read by LVGL
+ */
+bool lcd_touch_is_active(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LCD_TOUCH_H__ */
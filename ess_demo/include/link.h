@@ -0,0 +1,44 @@
+/**
+ * @file link.h
+ * @brief Requests a larger ATT MTU, data length and the 2M PHY on new
+ * connections so that notifications and bulk transfers use fewer, fuller
+ * packets
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __LINK_H__
+#define __LINK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <bluetooth/conn.h>
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Registers the connection callbacks used to track the link
+ */
+void link_init(void);
+
+/**
+ * @brief Starts the MTU exchange and data length and PHY updates on a new
+ * connection, the results are logged as they complete
+ *
+ * @param New connection
+ */
+void link_connected(struct bt_conn *conn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LINK_H__ */
@@ -0,0 +1,58 @@
+/**
+ * @file sample.h
+ * @brief Sensor sample record passed from acquisition to the consumers
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __SAMPLE_H__
+#define __SAMPLE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+#include "derived.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+struct ess_sample {
+	/* Uptime when the sample was acquired in ms */
+	int64_t timestamp;
+	/* Incremented for each acquired sample */
+	uint32_t sequence;
+	/* Temperature in degrees celsius (C) in 0.01 units */
+	int16_t temperature;
+	/* Humidity in percent (%) in 0.01 units */
+	uint16_t humidity;
+	/* Pressure in pascals (Pa) in 0.1 units */
+	uint32_t pressure;
+	/* Gas resistance in ohms (Ohm), 0 if not measured */
+	uint32_t gas_resistance;
+	/* Incremented for each gas resistance measurement, the newest
+	 * resistance is carried by the samples until the next one
+	 */
+	uint32_t gas_sequence;
+	/* Derived metrics indexed by enum derived_metric, in the units given
+	 * there, derived_valid has a bit set for each calculated metric
+	 */
+	int32_t derived[DERIVED_METRIC_COUNT];
+	uint32_t derived_valid;
+#ifdef CONFIG_ESS_TRACE
+	/* Trace timestamp of the trigger which requested the sample */
+	uint32_t trace_start;
+#endif
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SAMPLE_H__ */
@@ -0,0 +1,81 @@
+/**
+ * @file sample_ring.h
+ * @brief Single producer, multiple consumer ring buffer of sensor samples
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __SAMPLE_RING_H__
+#define __SAMPLE_RING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+#include "sample.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+/* Read cursor, each consumer has its own so reads are independent */
+struct sample_ring_reader {
+	/* Index of the next sample to read */
+	uint32_t next;
+	/* Number of samples overwritten before this reader read them */
+	uint32_t dropped;
+};
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Writes a sample to the ring, overwriting the oldest sample if full
+ *
+ * @note Only one thread (the acquisition thread) may write to the ring
+ *
+ * @param Sample to write
+ */
+void sample_ring_write(const struct ess_sample *sample);
+
+/**
+ * @brief Initialises a reader so that it will read samples written after
+ * this call
+ *
+ * @param Reader to initialise
+ */
+void sample_ring_reader_init(struct sample_ring_reader *reader);
+
+/**
+ * @brief Reads the next sample for a reader, if the reader has fallen more
+ * than the ring size behind it skips to the oldest available sample
+ *
+ * @param Reader
+ * @param Sample output
+ *
+ * @retval 0 on success, -EAGAIN if there are no new samples
+ */
+int sample_ring_read(struct sample_ring_reader *reader,
+		     struct ess_sample *sample);
+
+/**
+ * @brief Reads a previous sample without using a reader
+ *
+ * @param Age of the sample, 0 for the newest sample
+ * @param Sample output
+ *
+ * @retval 0 on success, -ENOENT if the sample is no longer (or not yet) in
+ * the ring
+ */
+int sample_ring_peek(uint32_t age, struct ess_sample *sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SAMPLE_RING_H__ */
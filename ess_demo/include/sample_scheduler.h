@@ -0,0 +1,65 @@
+/**
+ * @file sample_scheduler.h
+ * @brief Adaptive sampling scheduler which sets the sensor sampling period
+ * from the rate of change of the readings, the connection state and the
+ * number of subscribers
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __SAMPLE_SCHEDULER_H__
+#define __SAMPLE_SCHEDULER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Starts sampling, the first sample is taken immediately
+ */
+void sample_scheduler_start(void);
+
+/**
+ * @brief Informs the scheduler of a connection or disconnection
+ *
+ * @param True if a central connected, false if one disconnected
+ */
+void sample_scheduler_connection_changed(bool connected);
+
+/**
+ * @brief Requests the sampling period is re-evaluated, for example after a
+ * central subscribes or unsubscribes
+ */
+void sample_scheduler_update(void);
+
+/**
+ * @brief Fixes the sampling period, overriding the adaptive period
+ *
+ * @param Sampling period in ms, 0 returns to the adaptive period
+ *
+ * @retval 0 on success, -EINVAL if the period is outside of the configured
+ * minimum and maximum periods
+ */
+int sample_scheduler_set_override(uint32_t period_ms);
+
+/**
+ * @brief Gets the current sampling period
+ *
+ * @retval Sampling period in ms
+ */
+uint32_t sample_scheduler_get_period(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SAMPLE_SCHEDULER_H__ */
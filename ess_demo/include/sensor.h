@@ -22,11 +22,73 @@ extern "C" {
 #include <stdio.h>
 #include <sys/byteorder.h>
 
+#include "sample.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+/* Channels which can be read using read_sensor_channels() */
+#define SENSOR_READ_TEMPERATURE BIT(0)
+#define SENSOR_READ_HUMIDITY BIT(1)
+#define SENSOR_READ_PRESSURE BIT(2)
+#define SENSOR_READ_ALL                                                        \
+	(SENSOR_READ_TEMPERATURE | SENSOR_READ_HUMIDITY | SENSOR_READ_PRESSURE)
+
+/* Sensor specific attributes, used alongside SENSOR_ATTR_OVERSAMPLING */
+enum ess_sensor_attribute {
+	/* IIR filter coefficient, 0 for off */
+	ESS_SENSOR_ATTR_IIR_FILTER = SENSOR_ATTR_PRIV_START,
+	/* Measurement mode, one of enum ess_sensor_mode */
+	ESS_SENSOR_ATTR_MODE,
+	/* Standby time between measurements in normal mode in ms */
+	ESS_SENSOR_ATTR_STANDBY_TIME,
+	/* Gas sensor heater temperature in degrees celsius (C), set on
+	 * SENSOR_CHAN_GAS_RES
+	 */
+	ESS_SENSOR_ATTR_HEATER_TEMPERATURE,
+	/* Gas sensor heater duration in ms, set on SENSOR_CHAN_GAS_RES.
+	 * Drivers which support the heater attributes only run the heater
+	 * when SENSOR_CHAN_GAS_RES is fetched on its own
+	 */
+	ESS_SENSOR_ATTR_HEATER_DURATION,
+};
+
+enum ess_sensor_gas_mode {
+	/* No gas sensor, or gas measurement is disabled */
+	ESS_SENSOR_GAS_NONE = 0,
+	/* The driver has no heater control and runs its own heater profile
+	 * with every read, the gas resistance is read with the other channels
+	 */
+	ESS_SENSOR_GAS_EVERY_READ,
+	/* The heater only runs for read_sensor_gas(), so gas measurements can
+	 * be interleaved with the other readings
+	 */
+	ESS_SENSOR_GAS_INTERLEAVED,
+};
+
+enum ess_sensor_mode {
+	/* One measurement is taken each time the sensor is read */
+	ESS_SENSOR_MODE_FORCED = 0,
+	/* Measurements are taken continuously, separated by the standby time */
+	ESS_SENSOR_MODE_NORMAL,
+};
+
+struct ess_sensor_config {
+	/* Oversampling of each channel, 0 skips the measurement */
+	uint8_t temperature_oversampling;
+	uint8_t humidity_oversampling;
+	uint8_t pressure_oversampling;
+	uint8_t iir_filter;
+	enum ess_sensor_mode mode;
+	uint16_t standby_time_ms;
+};
+
 /******************************************************************************/
 /* Global Function Prototypes                                                 */
 /******************************************************************************/
 /**
- * @brief Sets up the sensor
+ * @brief Sets up the sensor and applies the default configuration from
+ * Kconfig
  */
 void setup_sensor(void);
 
@@ -38,51 +100,104 @@ void setup_sensor(void);
 bool is_sensor_present(void);
 
 /**
- * @brief Reads the data from the sensor and stores readings internally
+ * @brief Configures the sensor oversampling, IIR filter and mode
+ *
+ * @note Drivers which cannot be configured at runtime use the settings from
+ * their own Kconfig options instead (e.g. CONFIG_BME280_TEMP_OVER_1X), the
+ * board configuration files set these to match the ESS_SENSOR defaults
+ *
+ * @param Configuration to apply
+ *
+ * @retval 0 on success, -ENOTSUP if the driver does not support runtime
+ * configuration, -ENODEV if the sensor is not present, -EINVAL if a value is
+ * invalid, otherwise the error from the driver. On failure the previous
+ * configuration is kept
  */
-void read_sensor(void);
+int configure_sensor(const struct ess_sensor_config *config);
 
 /**
- * @brief Reads the latest temperature sensor reading
+ * @brief Gets the configuration the sensor is using, the Kconfig defaults
+ * until a configuration has been applied successfully
  *
- * @retval Temperature in degrees celsius (C) in 0.01 units
+ * @param Configuration output
  */
-int16_t read_temperature(void);
+void get_sensor_config(struct ess_sensor_config *config);
 
 /**
- * @brief Reads the latest humidity sensor reading
+ * @brief Reads the temperature, humidity and pressure from the sensor
  *
- * @retval Humidity in percent (%) in 0.01 units
+ * @param Sample in which the readings are stored, other fields are unchanged
+ *
+ * @retval 0 on success, negative error code on failure
+ */
+int read_sensor(struct ess_sample *sample);
+
+/**
+ * @brief Reads only the specified channels from the sensor, readings of
+ * other channels are left unchanged
+ *
+ * @param Bitmask of SENSOR_READ_* channels to read
+ * @param Sample in which the readings are stored
+ *
+ * @retval 0 on success, negative error code on failure
  */
-int16_t read_humidity(void);
+int read_sensor_channels(uint8_t channels, struct ess_sample *sample);
 
 /**
- * @brief Reads the latest pressure sensor reading
+ * @brief Gets how the gas resistance is measured, which depends on the
+ * sensor and the heater control supported by its driver
  *
- * @retval Pressure in pascals (pa) in 0.1 units
+ * @retval Gas measurement mode
  */
-int32_t read_pressure(void);
+enum ess_sensor_gas_mode get_sensor_gas_mode(void);
 
 /**
- * @brief Reads the latest temperature sensor reading
+ * @brief Measures the gas resistance using the heater profile from Kconfig,
+ * the sensor is busy for the heater duration
+ *
+ * @param Sample in which the gas resistance is stored, other fields are
+ * unchanged
  *
- * @param Temperature in degrees celsius (C)
+ * @retval 0 on success, -ENOTSUP if the gas mode is not
+ * ESS_SENSOR_GAS_INTERLEAVED, negative error code on failure
  */
-void read_temperature_float(float *temperature);
+int read_sensor_gas(struct ess_sample *sample);
 
 /**
- * @brief Reads the latest humidity sensor reading
+ * @brief Converts a sensor temperature reading to fixed point
  *
- * @param Humidity in percent (%)
+ * @param Temperature sensor value
+ *
+ * @retval Temperature in degrees celsius (C) in 0.01 units
  */
-void read_humidity_float(float *humidity);
+int16_t sensor_value_to_temperature(const struct sensor_value *value);
 
 /**
- * @brief Reads the latest pressure sensor reading
+ * @brief Converts a sensor humidity reading to fixed point
+ *
+ * @param Humidity sensor value
+ *
+ * @retval Humidity in percent (%) in 0.01 units
+ */
+uint16_t sensor_value_to_humidity(const struct sensor_value *value);
+
+/**
+ * @brief Converts a sensor pressure reading (in kPa) to fixed point
+ *
+ * @param Pressure sensor value
+ *
+ * @retval Pressure in pascals (Pa) in 0.1 units
+ */
+uint32_t sensor_value_to_pressure(const struct sensor_value *value);
+
+/**
+ * @brief Converts a sensor gas resistance reading to fixed point
+ *
+ * @param Gas resistance sensor value
  *
- * @param Pressure in pascals (Pa)
+ * @retval Gas resistance in ohms (Ohm)
  */
-void read_pressure_float(float *pressure);
+uint32_t sensor_value_to_gas_resistance(const struct sensor_value *value);
 
 #ifdef __cplusplus
 }
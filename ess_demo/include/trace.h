@@ -0,0 +1,138 @@
+/**
+ * @file trace.h
+ * @brief Per-stage latency histograms of the sample pipeline. When
+ * CONFIG_ESS_TRACE is disabled the stage markers compile to nothing
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#if defined(CONFIG_ESS_TRACE) && defined(CONFIG_CORTEX_M_DWT)
+#include <arch/arm/aarch32/cortex_m/cmsis.h>
+#endif
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+/* Bucket 0 counts durations under 1 us, bucket n (n > 0) those from
+ * 2^(n - 1) us up to 2^n us, the last bucket also counts anything longer
+ */
+#define TRACE_HISTOGRAM_BUCKETS 20
+
+enum trace_stage {
+	/* From the sample being triggered to the acquisition thread running */
+	TRACE_STAGE_QUEUE_WAIT = 0,
+	/* Sensor measurement and bus transfer */
+	TRACE_STAGE_SENSOR_FETCH,
+	/* Sensor values to characteristic units */
+	TRACE_STAGE_CONVERSION,
+	/* Gas sensor heater cycle and measurement */
+	TRACE_STAGE_GAS,
+	/* Derived metrics such as the dew point */
+	TRACE_STAGE_DERIVED,
+	/* Updating the characteristics and queueing the notifications */
+	TRACE_STAGE_GATT,
+	/* Adding a sample to the chart */
+	TRACE_STAGE_LCD_GRAPH,
+	/* LVGL task handler (rendering and flushing) */
+	TRACE_STAGE_LCD_TASKS,
+	/* From the sample being triggered to the GATT update returning */
+	TRACE_STAGE_PIPELINE,
+
+	TRACE_STAGE_COUNT
+};
+
+struct trace_stage_stats {
+	uint32_t count;
+	uint64_t total_us;
+	uint32_t max_us;
+	uint32_t buckets[TRACE_HISTOGRAM_BUCKETS];
+};
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Starts the trace clock, the DWT cycle counter on Cortex-M and the
+ * system hardware clock elsewhere (which is monotonic on native_posix)
+ */
+void trace_init(void);
+
+/**
+ * @brief Adds the time since a trace_begin() timestamp to a stage
+ *
+ * @param Stage to add the duration to
+ * @param Timestamp from trace_begin()
+ */
+void trace_record(enum trace_stage stage, uint32_t start);
+
+/**
+ * @brief Gets a copy of the statistics of a stage
+ *
+ * @param Stage to get
+ * @param Filled with the statistics
+ */
+void trace_get_stage(enum trace_stage stage, struct trace_stage_stats *stats);
+
+/**
+ * @brief Gets the name of a stage for output
+ *
+ * @param Stage
+ *
+ * @retval Name of the stage
+ */
+const char *trace_stage_name(enum trace_stage stage);
+
+/**
+ * @brief Clears the statistics of all stages
+ */
+void trace_reset(void);
+
+/**
+ * @brief Gets the current trace clock timestamp at the start of a stage
+ *
+ * @retval Timestamp to pass to trace_end(), 0 when tracing is disabled
+ */
+static inline uint32_t trace_begin(void)
+{
+#if defined(CONFIG_ESS_TRACE) && defined(CONFIG_CORTEX_M_DWT)
+	return DWT->CYCCNT;
+#elif defined(CONFIG_ESS_TRACE)
+	return k_cycle_get_32();
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @brief Records the end of a stage
+ *
+ * @param Stage which has ended
+ * @param Timestamp from trace_begin() at the start of the stage
+ */
+static inline void trace_end(enum trace_stage stage, uint32_t start)
+{
+#ifdef CONFIG_ESS_TRACE
+	trace_record(stage, start);
+#else
+	ARG_UNUSED(stage);
+	ARG_UNUSED(start);
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRACE_H__ */
@@ -0,0 +1,39 @@
+/**
+ * @file trace_service.h
+ * @brief Vendor specific service exporting the sample pipeline latency
+ * histograms
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __TRACE_SERVICE_H__
+#define __TRACE_SERVICE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <bluetooth/uuid.h>
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+#define BT_UUID_TRACE_SERVICE_VAL                                              \
+	BT_UUID_128_ENCODE(0x8a7f1200, 0x4b2d, 0x4f3e, 0x9c5a, 0x6e0b2d4c3a10)
+#define BT_UUID_TRACE_HISTOGRAMS_VAL                                           \
+	BT_UUID_128_ENCODE(0x8a7f1201, 0x4b2d, 0x4f3e, 0x9c5a, 0x6e0b2d4c3a10)
+
+#define BT_UUID_TRACE_SERVICE BT_UUID_DECLARE_128(BT_UUID_TRACE_SERVICE_VAL)
+#define BT_UUID_TRACE_HISTOGRAMS                                               \
+	BT_UUID_DECLARE_128(BT_UUID_TRACE_HISTOGRAMS_VAL)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRACE_SERVICE_H__ */
@@ -0,0 +1,163 @@
+/**
+ * @file workload.h
+ * @brief Inputs, baselines and references of the sample processing hot
+ * paths, shared by the bench shell commands and the tests
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __WORKLOAD_H__
+#define __WORKLOAD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+/* Grid covering the operating range of the BME280/BME680 in 0.01 units */
+#define GRID_TEMPERATURE_MIN -4000
+#define GRID_TEMPERATURE_MAX 8500
+#define GRID_TEMPERATURE_STEP 100
+#define GRID_HUMIDITY_MIN 100
+#define GRID_HUMIDITY_MAX 10000
+#define GRID_HUMIDITY_STEP 100
+
+/* Sensor values in the driver units (C, % and kPa) */
+#define GRID_SENSOR_TEMPERATURE_MIN -40
+#define GRID_SENSOR_TEMPERATURE_MAX 85
+#define GRID_SENSOR_HUMIDITY_MIN 0
+#define GRID_SENSOR_HUMIDITY_MAX 100
+#define GRID_SENSOR_PRESSURE_MIN 30
+#define GRID_SENSOR_PRESSURE_MAX 110
+#define GRID_SENSOR_FRACTION_STEP 50000
+#define SENSOR_FRACTION_DIVIDER 1000000
+
+/* One day of samples at 1 Hz, so that all the display zoom levels wrap */
+#define WORKLOAD_CHART_SAMPLES (24 * 60 * 60)
+#define WORKLOAD_CHART_SAMPLE_PERIOD_MS 1000
+#define WORKLOAD_CHART_LEVELS 3
+
+enum conversion_channel {
+	CONVERSION_CHANNEL_TEMPERATURE = 0,
+	CONVERSION_CHANNEL_HUMIDITY,
+	CONVERSION_CHANNEL_PRESSURE,
+
+	CONVERSION_CHANNEL_COUNT
+};
+
+/* Range of the sensor values of a channel and the characteristic units
+ * per sensor unit
+ */
+struct conversion_grid {
+	const char *name;
+	int32_t min;
+	int32_t max;
+	int32_t multiplier;
+};
+
+struct sensor_value;
+struct chart_reducer_level;
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Single precision dew point, the baseline of the fixed point
+ * implementation. It is built with software floating point when the FPU is
+ * disabled
+ *
+ * @param Temperature in degrees celsius (C) in 0.01 units
+ * @param Humidity in percent (%) in 0.01 units
+ *
+ * @retval Dew point in degrees celsius (C)
+ */
+float workload_dew_point_float(int16_t temperature, uint16_t humidity);
+
+/**
+ * @brief Reference Magnus formula in double precision which the dew point
+ * implementations are compared against
+ *
+ * @param Temperature in degrees celsius (C) in 0.01 units
+ * @param Humidity in percent (%) in 0.01 units
+ *
+ * @retval Dew point in degrees celsius (C) in 0.01 units
+ */
+double workload_dew_point_exact(int16_t temperature, uint16_t humidity);
+
+/**
+ * @brief Gets the range of the sensor values of a channel
+ *
+ * @param Channel
+ *
+ * @retval Grid of the channel
+ */
+const struct conversion_grid *
+workload_conversion_grid(enum conversion_channel channel);
+
+/**
+ * @brief Sets a sensor value, the fraction has the same sign as the whole
+ * number as in the drivers
+ *
+ * @param Value to set
+ * @param Whole number
+ * @param Positive fraction in millionths
+ */
+void workload_conversion_value(struct sensor_value *value, int32_t whole,
+			       int32_t fraction);
+
+/**
+ * @brief Converts a sensor value with the fixed point conversion used by
+ * the firmware
+ *
+ * @param Channel of the value
+ * @param Value in the driver units
+ *
+ * @retval Value in the characteristic units
+ */
+int32_t workload_conversion_fixed(enum conversion_channel channel,
+				  const struct sensor_value *value);
+
+/**
+ * @brief Single precision baseline of the conversions, the equivalent of
+ * converting the sensor value to a float and scaling it
+ *
+ * @param Channel of the value
+ * @param Value in the driver units
+ *
+ * @retval Value in the characteristic units
+ */
+int32_t workload_conversion_float(enum conversion_channel channel,
+				  const struct sensor_value *value);
+
+/**
+ * @brief Initialises one level per display zoom level, with the same
+ * windows
+ *
+ * @param WORKLOAD_CHART_LEVELS levels to initialise
+ * @param Value of points with no samples
+ */
+void workload_chart_init(struct chart_reducer_level *levels, int16_t blank);
+
+/**
+ * @brief Adds WORKLOAD_CHART_SAMPLES samples of four sawtooth series to
+ * every level, as update_lcd_graph() does
+ *
+ * @param WORKLOAD_CHART_LEVELS levels from workload_chart_init()
+ *
+ * @retval Number of points written to all the levels
+ */
+uint32_t workload_chart_run(struct chart_reducer_level *levels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WORKLOAD_H__ */
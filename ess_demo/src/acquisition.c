@@ -0,0 +1,193 @@
+/**
+ * @file acquisition.c
+ * @brief Sensor acquisition thread which reads the sensor off the system
+ * workqueue and passes samples to the consumers
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <logging/log.h>
+
+#include "acquisition.h"
+#include "sensor.h"
+#include "derived.h"
+#include "filter.h"
+#include "trace.h"
+
+LOG_MODULE_REGISTER(acquisition);
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+/* Bits of acquisition_pending */
+#define ACQUISITION_PENDING_SAMPLE 0
+#define ACQUISITION_PENDING_GAS 1
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static void acquire_sample(struct ess_sample *sample);
+static void publish_sample(const struct ess_sample *sample);
+static void acquisition_thread(void *p1, void *p2, void *p3);
+static void gas_timer_handler(struct k_timer *timer);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+K_SEM_DEFINE(acquisition_trigger_sem, 0, 1);
+K_MUTEX_DEFINE(acquisition_consumers_mutex);
+K_TIMER_DEFINE(acquisition_gas_timer, gas_timer_handler, NULL);
+
+K_THREAD_DEFINE(acquisition_tid, CONFIG_ESS_ACQUISITION_STACK_SIZE,
+		acquisition_thread, NULL, NULL, NULL,
+		CONFIG_ESS_ACQUISITION_THREAD_PRIORITY, 0, 0);
+
+static sys_slist_t acquisition_consumers =
+	SYS_SLIST_STATIC_INIT(&acquisition_consumers);
+static struct ess_sample acquisition_sample;
+static uint32_t acquisition_trigger_start;
+static atomic_t acquisition_pending;
+static struct derived_state acquisition_derived;
+#ifdef CONFIG_ESS_FILTER
+static struct filter_state acquisition_filter;
+#endif
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static void acquire_sample(struct ess_sample *sample)
+{
+	uint32_t start;
+	int rc;
+
+	/* The sensor drivers sleep whilst the conversion is in progress, so
+	 * this thread yields for the duration of the measurement. If the read
+	 * fails the previous readings are kept
+	 */
+	rc = read_sensor(sample);
+
+	sample->timestamp = k_uptime_get();
+	++sample->sequence;
+
+#ifdef CONFIG_ESS_FILTER
+	/* Kept readings have already been filtered */
+	if (rc == 0) {
+		filter_apply(&acquisition_filter, sample);
+	}
+#else
+	ARG_UNUSED(rc);
+#endif
+
+	/* Only the metrics with a consumer are calculated, once for all of
+	 * them
+	 */
+	start = trace_begin();
+	(void)derived_evaluate(&acquisition_derived, derived_get_demand(),
+			       sample);
+	trace_end(TRACE_STAGE_DERIVED, start);
+}
+
+static void publish_sample(const struct ess_sample *sample)
+{
+	struct acquisition_consumer *consumer;
+
+	sample_ring_write(sample);
+
+	k_mutex_lock(&acquisition_consumers_mutex, K_FOREVER);
+
+	SYS_SLIST_FOR_EACH_CONTAINER (&acquisition_consumers, consumer, node) {
+		k_work_submit(consumer->work);
+	}
+
+	k_mutex_unlock(&acquisition_consumers_mutex);
+}
+
+static void acquisition_thread(void *p1, void *p2, void *p3)
+{
+	derived_state_init(&acquisition_derived);
+#ifdef CONFIG_ESS_FILTER
+	filter_state_init(&acquisition_filter);
+#endif
+
+	while (true) {
+		k_sem_take(&acquisition_trigger_sem, K_FOREVER);
+
+		if (atomic_test_and_clear_bit(&acquisition_pending,
+					      ACQUISITION_PENDING_SAMPLE)) {
+			trace_end(TRACE_STAGE_QUEUE_WAIT,
+				  acquisition_trigger_start);
+#ifdef CONFIG_ESS_TRACE
+			acquisition_sample.trace_start =
+				acquisition_trigger_start;
+#endif
+
+			acquire_sample(&acquisition_sample);
+			publish_sample(&acquisition_sample);
+		}
+
+		/* The heater cycle runs once the sample has been published,
+		 * the gas resistance is carried by the next sample
+		 */
+		if (atomic_test_and_clear_bit(&acquisition_pending,
+					      ACQUISITION_PENDING_GAS)) {
+			(void)read_sensor_gas(&acquisition_sample);
+		}
+	}
+}
+
+static void gas_timer_handler(struct k_timer *timer)
+{
+	/* A due gas measurement waits for the next sample, so the heater runs
+	 * straight after it in the longest gap before the following one. If
+	 * no sample was taken for a whole gas period it is measured on its
+	 * own
+	 */
+	if (atomic_test_and_set_bit(&acquisition_pending,
+				    ACQUISITION_PENDING_GAS)) {
+		k_sem_give(&acquisition_trigger_sem);
+	}
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void acquisition_register_consumer(struct acquisition_consumer *consumer)
+{
+	k_mutex_lock(&acquisition_consumers_mutex, K_FOREVER);
+	sys_slist_append(&acquisition_consumers, &consumer->node);
+	k_mutex_unlock(&acquisition_consumers_mutex);
+}
+
+void acquisition_start_gas(void)
+{
+#ifdef CONFIG_ESS_SENSOR_GAS
+	if (get_sensor_gas_mode() == ESS_SENSOR_GAS_INTERLEAVED) {
+		/* The first measurement starts the heater burn in */
+		atomic_set_bit(&acquisition_pending, ACQUISITION_PENDING_GAS);
+		k_timer_start(&acquisition_gas_timer,
+			      K_MSEC(CONFIG_ESS_SENSOR_GAS_PERIOD_MS),
+			      K_MSEC(CONFIG_ESS_SENSOR_GAS_PERIOD_MS));
+	}
+#endif
+}
+
+void acquisition_trigger(void)
+{
+	/* Triggers whilst one is pending are merged, the wait is measured
+	 * from the first
+	 */
+	if (IS_ENABLED(CONFIG_ESS_TRACE) &&
+	    !atomic_test_bit(&acquisition_pending,
+			     ACQUISITION_PENDING_SAMPLE)) {
+		acquisition_trigger_start = trace_begin();
+	}
+
+	atomic_set_bit(&acquisition_pending, ACQUISITION_PENDING_SAMPLE);
+	k_sem_give(&acquisition_trigger_sem);
+}
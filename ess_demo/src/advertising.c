@@ -0,0 +1,434 @@
+/**
+ * @file advertising.c
+ * @brief Advertising, optionally broadcasting the latest readings in the
+ * advertising data so they can be collected without connecting, using
+ * legacy or extended advertising and optionally a periodic advertising
+ * train carrying the most recent samples
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <logging/log.h>
+#include <sys/byteorder.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/uuid.h>
+
+#include "advertising.h"
+#include "acquisition.h"
+
+LOG_MODULE_REGISTER(advertising);
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define ADVERTISING_INTERVAL_MIN 320 /* in 0.625ms units */
+#define ADVERTISING_INTERVAL_MAX 800 /* in 0.625ms units */
+
+/* BTHome v2 service data, objects must be in ascending object ID order */
+#define BTHOME_UUID 0xfcd2
+#define BTHOME_DEVICE_INFO 0x40 /* Version 2, unencrypted, regular interval */
+#define BTHOME_PACKET_ID 0x00
+#define BTHOME_TEMPERATURE 0x02 /* sint16, 0.01 C */
+#define BTHOME_HUMIDITY 0x03 /* uint16, 0.01 % */
+#define BTHOME_PRESSURE 0x04 /* uint24, 0.01 hPa */
+#define BTHOME_DEW_POINT 0x08 /* sint16, 0.01 C */
+#define BTHOME_DATA_SIZE 18
+
+/* ESS service data: sequence number followed by the packed characteristic
+ * value
+ */
+#define ESS_DATA_SIZE 12
+
+/* Samples hold pressure in 0.1 Pa, BTHome uses 0.01 hPa (1 Pa) */
+#define BTHOME_PRESSURE_DIVIDER 10
+#define DEW_POINT_DIVIDER 100
+
+#ifdef CONFIG_ESS_BEACON_FORMAT_BTHOME
+#define BEACON_DATA_SIZE BTHOME_DATA_SIZE
+#else
+#define BEACON_DATA_SIZE ESS_DATA_SIZE
+#endif
+
+/* Periodic advertising data: ESS UUID followed by the most recent samples,
+ * newest first, each as a sequence number and the packed characteristic
+ * value
+ */
+#define PERIODIC_RECORD_SIZE (ESS_DATA_SIZE - sizeof(uint16_t))
+#define PERIODIC_DATA_SIZE                                                     \
+	(sizeof(uint16_t) +                                                    \
+	 PERIODIC_RECORD_SIZE * CONFIG_ESS_ADV_PERIODIC_SAMPLES)
+
+/* Periodic advertising interval is in 1.25 ms units */
+#define PERIODIC_INTERVAL                                                      \
+	((CONFIG_ESS_ADV_PERIODIC_INTERVAL_MS * 4) / 5)
+
+/* Advertising data length the network core controller must be built with
+ * (CONFIG_BT_CTLR_ADV_DATA_LEN_MAX), the longest without chained PDUs
+ */
+#define CONTROLLER_ADV_DATA_LEN_MAX 191
+#define AD_HEADER_SIZE 2
+
+#ifdef CONFIG_ESS_ADV_PERIODIC
+BUILD_ASSERT(CONFIG_ESS_ADV_PERIODIC_SAMPLES <= CONFIG_ESS_SAMPLE_RING_SIZE,
+	     "More periodic advertising samples than the sample ring holds");
+BUILD_ASSERT(AD_HEADER_SIZE + PERIODIC_DATA_SIZE <=
+		     CONTROLLER_ADV_DATA_LEN_MAX,
+	     "Periodic advertising data is longer than the controller allows");
+#endif
+
+#ifdef CONFIG_ESS_ADV_PHY_CODED
+#define ADVERTISING_PHY_OPTIONS BT_LE_ADV_OPT_CODED
+#else
+#define ADVERTISING_PHY_OPTIONS 0
+#endif
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+#ifdef CONFIG_ESS_BEACON
+static void encode_beacon(uint8_t *data, const struct ess_sample *sample);
+static void update_beacon(const struct ess_sample *sample);
+#endif
+#ifdef CONFIG_ESS_ADV_PERIODIC
+static void encode_record(uint8_t *data, const struct ess_sample *sample);
+static void update_periodic(void);
+static int start_periodic(void);
+#endif
+#ifdef CONFIG_ESS_ADV_EXTENDED
+static void restart_handler(struct k_work *work);
+static void connected(struct bt_conn *conn, uint8_t err);
+static void disconnected(struct bt_conn *conn, uint8_t reason);
+static int start_extended(uint32_t options, size_t ad_count);
+#endif
+#ifdef CONFIG_ESS_ADV_SAMPLES
+static void advertising_update_handler(struct k_work *work);
+#endif
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+#ifdef CONFIG_ESS_ADV_SAMPLES
+K_WORK_DEFINE(advertising_update, advertising_update_handler);
+
+static struct sample_ring_reader advertising_reader;
+static struct acquisition_consumer advertising_consumer = {
+	.work = &advertising_update,
+};
+#endif
+
+#ifdef CONFIG_ESS_BEACON
+/* Only valid readings are broadcast, so the service data is left out until
+ * the first sample has been taken
+ */
+static uint8_t beacon_data[BEACON_DATA_SIZE];
+#endif
+
+#ifdef CONFIG_ESS_ADV_EXTENDED
+K_WORK_DEFINE(advertising_restart, restart_handler);
+
+static struct bt_le_ext_adv *advertising_set;
+
+static struct bt_conn_cb advertising_conn_callbacks = {
+	.connected = connected,
+	.disconnected = disconnected,
+};
+#endif
+
+#ifdef CONFIG_ESS_ADV_PERIODIC
+static struct bt_le_ext_adv *periodic_set;
+static uint8_t periodic_data[PERIODIC_DATA_SIZE];
+
+static struct bt_data periodic_ad[] = {
+	BT_DATA(BT_DATA_SVC_DATA16, periodic_data, sizeof(periodic_data)),
+};
+
+/* Advertises the name and service so scanners can find the train to sync
+ * to
+ */
+static const struct bt_data periodic_set_ad[] = {
+	BT_DATA_BYTES(BT_DATA_UUID16_ALL, BT_UUID_16_ENCODE(BT_UUID_ESS_VAL)),
+};
+#endif
+
+static struct bt_data ad[] = {
+	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
+	BT_DATA_BYTES(BT_DATA_UUID16_ALL, BT_UUID_16_ENCODE(BT_UUID_ESS_VAL)),
+#ifdef CONFIG_ESS_BEACON
+	BT_DATA(BT_DATA_SVC_DATA16, beacon_data, sizeof(beacon_data)),
+#endif
+};
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+#ifdef CONFIG_ESS_BEACON
+#ifdef CONFIG_ESS_BEACON_FORMAT_BTHOME
+static void encode_beacon(uint8_t *data, const struct ess_sample *sample)
+{
+	sys_put_le16(BTHOME_UUID, &data[0]);
+	data[2] = BTHOME_DEVICE_INFO;
+	data[3] = BTHOME_PACKET_ID;
+	data[4] = (uint8_t)sample->sequence;
+	data[5] = BTHOME_TEMPERATURE;
+	sys_put_le16(sample->temperature, &data[6]);
+	data[8] = BTHOME_HUMIDITY;
+	sys_put_le16(sample->humidity, &data[9]);
+	data[11] = BTHOME_PRESSURE;
+	sys_put_le24(sample->pressure / BTHOME_PRESSURE_DIVIDER, &data[12]);
+	data[15] = BTHOME_DEW_POINT;
+	sys_put_le16(sample->derived[DERIVED_METRIC_DEW_POINT],
+		     &data[16]);
+}
+#else
+static void encode_beacon(uint8_t *data, const struct ess_sample *sample)
+{
+	sys_put_le16(BT_UUID_ESS_VAL, &data[0]);
+	data[2] = (uint8_t)sample->sequence;
+	sys_put_le16(sample->temperature, &data[3]);
+	sys_put_le16(sample->humidity, &data[5]);
+	sys_put_le32(sample->pressure, &data[7]);
+	data[11] = (uint8_t)(sample->derived[DERIVED_METRIC_DEW_POINT] /
+			     DEW_POINT_DIVIDER);
+}
+#endif
+
+static void update_beacon(const struct ess_sample *sample)
+{
+	int rc;
+
+	encode_beacon(beacon_data, sample);
+
+#ifdef CONFIG_ESS_ADV_EXTENDED
+	/* Fails if the controller does not support data this long, see
+	 * overlay-periodic-adv.conf
+	 */
+	rc = bt_le_ext_adv_set_data(advertising_set, ad, ARRAY_SIZE(ad), NULL,
+				    0);
+	if (rc != 0) {
+		LOG_ERR("Extended advertising data update failed (err %d)",
+			rc);
+	}
+#else
+	/* Fails whilst advertising is stopped during a connection, the next
+	 * sample after advertising resumes updates it
+	 */
+	rc = bt_le_adv_update_data(ad, ARRAY_SIZE(ad), NULL, 0);
+	if (rc != 0) {
+		LOG_DBG("Advertising data update failed (err %d)", rc);
+	}
+#endif
+}
+#endif
+
+#ifdef CONFIG_ESS_ADV_PERIODIC
+static void encode_record(uint8_t *data, const struct ess_sample *sample)
+{
+	data[0] = (uint8_t)sample->sequence;
+	sys_put_le16(sample->temperature, &data[1]);
+	sys_put_le16(sample->humidity, &data[3]);
+	sys_put_le32(sample->pressure, &data[5]);
+	data[9] = (uint8_t)(sample->derived[DERIVED_METRIC_DEW_POINT] /
+			    DEW_POINT_DIVIDER);
+}
+
+static void update_periodic(void)
+{
+	struct ess_sample sample;
+	uint8_t *record = &periodic_data[sizeof(uint16_t)];
+	uint32_t age;
+	int rc;
+
+	for (age = 0; age < CONFIG_ESS_ADV_PERIODIC_SAMPLES; ++age) {
+		if (sample_ring_peek(age, &sample) != 0) {
+			break;
+		}
+		encode_record(record, &sample);
+		record += PERIODIC_RECORD_SIZE;
+	}
+
+	periodic_ad[0].data_len = record - periodic_data;
+
+	rc = bt_le_per_adv_set_data(periodic_set, periodic_ad,
+				    ARRAY_SIZE(periodic_ad));
+	if (rc != 0) {
+		LOG_ERR("Periodic advertising data update failed (err %d)",
+			rc);
+	}
+}
+
+static int start_periodic(void)
+{
+	int rc;
+
+	sys_put_le16(BT_UUID_ESS_VAL, periodic_data);
+	periodic_ad[0].data_len = sizeof(uint16_t);
+
+	rc = bt_le_ext_adv_create(
+		BT_LE_ADV_PARAM(BT_LE_ADV_OPT_EXT_ADV | BT_LE_ADV_OPT_USE_NAME |
+					ADVERTISING_PHY_OPTIONS,
+				ADVERTISING_INTERVAL_MIN,
+				ADVERTISING_INTERVAL_MAX, NULL),
+		NULL, &periodic_set);
+	if (rc == 0) {
+		rc = bt_le_ext_adv_set_data(periodic_set, periodic_set_ad,
+					    ARRAY_SIZE(periodic_set_ad), NULL,
+					    0);
+	}
+	if (rc == 0) {
+		rc = bt_le_per_adv_set_param(
+			periodic_set,
+			BT_LE_PER_ADV_PARAM(PERIODIC_INTERVAL,
+					    PERIODIC_INTERVAL,
+					    BT_LE_PER_ADV_OPT_NONE));
+	}
+	if (rc == 0) {
+		rc = bt_le_per_adv_set_data(periodic_set, periodic_ad,
+					    ARRAY_SIZE(periodic_ad));
+	}
+	if (rc == 0) {
+		rc = bt_le_per_adv_start(periodic_set);
+	}
+	if (rc == 0) {
+		rc = bt_le_ext_adv_start(periodic_set,
+					 BT_LE_EXT_ADV_START_DEFAULT);
+	}
+
+	return rc;
+}
+#endif
+
+#ifdef CONFIG_ESS_ADV_EXTENDED
+static void restart_handler(struct k_work *work)
+{
+	int rc;
+
+	rc = bt_le_ext_adv_start(advertising_set, BT_LE_EXT_ADV_START_DEFAULT);
+	if (rc == -ENOMEM || rc == -EALREADY) {
+		/* All connections are in use, advertising is restarted when
+		 * one of them disconnects
+		 */
+		LOG_DBG("Advertising not restarted (err %d)", rc);
+	} else if (rc != 0) {
+		LOG_ERR("Advertising failed to restart (err %d)", rc);
+	}
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	/* The set stops when a central connects, it is restarted so that
+	 * further centrals can connect whilst connections are free
+	 */
+	k_work_submit(&advertising_restart);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	/* Unlike legacy advertising, extended advertising sets are not
+	 * resumed by the stack after a connection
+	 */
+	k_work_submit(&advertising_restart);
+}
+
+static int start_extended(uint32_t options, size_t ad_count)
+{
+	int rc;
+
+	/* Extended connectable advertising cannot be scanned, so the name is
+	 * always in the advertising data, which has room for it alongside the
+	 * readings
+	 */
+	rc = bt_le_ext_adv_create(
+		BT_LE_ADV_PARAM(options | BT_LE_ADV_OPT_EXT_ADV |
+					BT_LE_ADV_OPT_FORCE_NAME_IN_AD |
+					ADVERTISING_PHY_OPTIONS,
+				ADVERTISING_INTERVAL_MIN,
+				ADVERTISING_INTERVAL_MAX, NULL),
+		NULL, &advertising_set);
+	if (rc == 0) {
+		rc = bt_le_ext_adv_set_data(advertising_set, ad, ad_count,
+					    NULL, 0);
+	}
+	if (rc == 0) {
+		bt_conn_cb_register(&advertising_conn_callbacks);
+		rc = bt_le_ext_adv_start(advertising_set,
+					 BT_LE_EXT_ADV_START_DEFAULT);
+	}
+
+	return rc;
+}
+#endif
+
+#ifdef CONFIG_ESS_ADV_SAMPLES
+static void advertising_update_handler(struct k_work *work)
+{
+	struct ess_sample sample;
+	bool updated = false;
+
+	while (sample_ring_read(&advertising_reader, &sample) == 0) {
+		updated = true;
+	}
+
+	if (!updated) {
+		return;
+	}
+
+#ifdef CONFIG_ESS_BEACON
+	update_beacon(&sample);
+#endif
+#ifdef CONFIG_ESS_ADV_PERIODIC
+	update_periodic();
+#endif
+}
+#endif
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+int advertising_start(void)
+{
+	uint32_t options = BT_LE_ADV_OPT_CONNECTABLE | BT_LE_ADV_OPT_USE_NAME;
+	size_t ad_count = ARRAY_SIZE(ad);
+	int rc;
+
+#ifdef CONFIG_ESS_BEACON
+	ad_count -= 1;
+#endif
+
+#ifdef CONFIG_ESS_ADV_PERIODIC
+	rc = start_periodic();
+	if (rc != 0) {
+		LOG_ERR("Periodic advertising failed to start (err %d)", rc);
+		return rc;
+	}
+#endif
+
+#ifdef CONFIG_ESS_ADV_EXTENDED
+	rc = start_extended(options, ad_count);
+#else
+#ifndef CONFIG_ESS_BEACON
+	options |= BT_LE_ADV_OPT_FORCE_NAME_IN_AD;
+#endif
+	/* In beacon mode the readings leave no room for the name in legacy
+	 * advertising, so it is moved to the scan response
+	 */
+	rc = bt_le_adv_start(BT_LE_ADV_PARAM(options, ADVERTISING_INTERVAL_MIN,
+					     ADVERTISING_INTERVAL_MAX, NULL),
+			     ad, ad_count, NULL, 0);
+#endif
+
+#ifdef CONFIG_ESS_ADV_SAMPLES
+	if (rc == 0) {
+		sample_ring_reader_init(&advertising_reader);
+		acquisition_register_consumer(&advertising_consumer);
+	}
+#endif
+
+	return rc;
+}
@@ -0,0 +1,864 @@
+/**
+ * @file benchmark.c
+ * @brief Shell commands for benchmarking the sample processing hot paths
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <string.h>
+#include <shell/shell.h>
+#include <math.h>
+#ifdef CONFIG_TIMING_FUNCTIONS
+#include <timing/timing.h>
+#endif
+
+#include "dewpoint.h"
+#include "derived.h"
+#include "filter.h"
+#include "sample.h"
+#include "sensor.h"
+#include "workload.h"
+#ifdef CONFIG_ESS_BULK
+#include "bulk.h"
+#endif
+#ifdef CONFIG_DISPLAY
+#include "lcd.h"
+#include "chart_reducer.h"
+#endif
+#ifdef CONFIG_ESS_DISPLAY_FLUSH
+#include "lcd_flush.h"
+#endif
+#ifdef CONFIG_ESS_TRACE
+#include "trace.h"
+#endif
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define CENTI_DIVIDER 100.0f
+#define ERROR_MULTIPLIER 1000.0 /* Errors are output in 0.001 units */
+
+/* The fixed point dew point is used by the firmware, it is accurate to
+ * better than 0.01 C over the grid
+ */
+#define DEW_POINT_FIXED_ERROR_MAX 0.05
+/* The fixed point conversions truncate to the characteristic units */
+#define CONVERSION_FIXED_ERROR_MAX 1.0
+
+/* Pressure and gas resistance change with every derived metrics sample so
+ * that the trend and air quality index are calculated
+ */
+#define DERIVED_SAMPLE_PERIOD_MS 1000
+#define DERIVED_PRESSURE_BASE 1000000
+#define DERIVED_PRESSURE_RANGE 20000
+#define DERIVED_GAS_BASE 50000
+#define DERIVED_GAS_RANGE 50000
+
+/* An hour of samples at 1 Hz following a triangle wave with some noise,
+ * every FILTER_SPIKE_INTERVAL samples all readings are corrupted. The
+ * slopes are within the default rate limits
+ */
+#define FILTER_SAMPLES (60 * 60)
+#define FILTER_SAMPLE_PERIOD_MS 1000
+#define FILTER_WAVE_PERIOD 600
+#define FILTER_NOISE_RANGE 5
+#define FILTER_SPIKE_INTERVAL 97
+
+#ifdef CONFIG_TIMING_FUNCTIONS
+typedef timing_t bench_time_t;
+#else
+typedef uint32_t bench_time_t;
+#endif
+
+enum conversion_impl {
+	CONVERSION_IMPL_FLOAT = 0,
+	CONVERSION_IMPL_FIXED,
+
+	CONVERSION_IMPL_COUNT
+};
+
+enum dew_point_impl {
+	DEW_POINT_IMPL_DOUBLE = 0,
+	DEW_POINT_IMPL_FLOAT,
+	DEW_POINT_IMPL_FIXED,
+
+	DEW_POINT_IMPL_COUNT
+};
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static const char *const dew_point_impl_names[DEW_POINT_IMPL_COUNT] = {
+	"double (original)", "float", "fixed"
+};
+
+static const char *const conversion_impl_names[CONVERSION_IMPL_COUNT] = {
+	"float", "fixed"
+};
+
+#ifdef CONFIG_DISPLAY
+static struct chart_reducer_level chart_levels[WORKLOAD_CHART_LEVELS];
+#endif
+
+static struct derived_state derived_bench_state;
+
+#ifdef CONFIG_ESS_FILTER
+/* Clean reading at the bottom of the wave, change per sample and the size
+ * of a spike for each enum filter_channel value
+ */
+static const int32_t filter_bases[FILTER_CHANNEL_COUNT] = { 2000, 4000,
+							      1000000 };
+static const int32_t filter_slopes[FILTER_CHANNEL_COUNT] = { 1, 2, 5 };
+static const int32_t filter_spikes[FILTER_CHANNEL_COUNT] = { 4000, 3000,
+							      100000 };
+
+static struct filter_state filter_bench_state;
+#endif
+
+/* Prevents the compiler from optimising away the calculations */
+static volatile int32_t bench_sink;
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static void bench_begin(void);
+static void bench_end(void);
+static bench_time_t bench_timestamp(void);
+static uint64_t bench_cycles(bench_time_t *start, bench_time_t *end);
+static uint64_t bench_cycles_to_ns(uint64_t cycles);
+static int bench_check_budget(const struct shell *shell, uint32_t ns_per_op,
+			      uint32_t budget_ns);
+static int8_t dew_point_double(float fTemp, float fHum);
+static int32_t dew_point_run(enum dew_point_impl impl, int16_t temperature,
+			     uint16_t humidity);
+static double dew_point_result(enum dew_point_impl impl, int16_t temperature,
+			       uint16_t humidity);
+static int cmd_bench_dewpoint(const struct shell *shell, size_t argc,
+			      char **argv);
+static int32_t conversion_run(enum conversion_impl impl,
+			      enum conversion_channel channel,
+			      const struct sensor_value *value);
+static double conversion_exact(enum conversion_channel channel,
+			       const struct sensor_value *value);
+static int cmd_bench_conversion(const struct shell *shell, size_t argc,
+				char **argv);
+static uint32_t derived_run(uint32_t metrics, uint32_t *complete);
+static int cmd_bench_derived(const struct shell *shell, size_t argc,
+			     char **argv);
+#ifdef CONFIG_ESS_FILTER
+static void filter_bench_sample(uint32_t n, int32_t *clean,
+				struct ess_sample *sample);
+static int cmd_bench_filter(const struct shell *shell, size_t argc,
+			    char **argv);
+#endif
+#ifdef CONFIG_DISPLAY
+static int cmd_bench_chart(const struct shell *shell, size_t argc,
+			   char **argv);
+#endif
+static int cmd_bench_all(const struct shell *shell, size_t argc, char **argv);
+#ifdef CONFIG_ESS_BULK
+static int cmd_bench_bulk(const struct shell *shell, size_t argc,
+			  char **argv);
+#endif
+#ifdef CONFIG_DISPLAY
+static int cmd_bench_display(const struct shell *shell, size_t argc,
+			     char **argv);
+#endif
+#ifdef CONFIG_ESS_TRACE
+static int cmd_bench_trace(const struct shell *shell, size_t argc,
+			   char **argv);
+#endif
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static void bench_begin(void)
+{
+#ifdef CONFIG_TIMING_FUNCTIONS
+	timing_init();
+	timing_start();
+#endif
+}
+
+static void bench_end(void)
+{
+	/* Stopping the timing functions would also stop the DWT cycle
+	 * counter used by the pipeline tracing
+	 */
+#if defined(CONFIG_TIMING_FUNCTIONS) && !defined(CONFIG_ESS_TRACE)
+	timing_stop();
+#endif
+}
+
+static bench_time_t bench_timestamp(void)
+{
+#ifdef CONFIG_TIMING_FUNCTIONS
+	return timing_counter_get();
+#else
+	return k_cycle_get_32();
+#endif
+}
+
+static uint64_t bench_cycles(bench_time_t *start, bench_time_t *end)
+{
+#ifdef CONFIG_TIMING_FUNCTIONS
+	return timing_cycles_get(start, end);
+#else
+	return *end - *start;
+#endif
+}
+
+static uint64_t bench_cycles_to_ns(uint64_t cycles)
+{
+#ifdef CONFIG_TIMING_FUNCTIONS
+	return timing_cycles_to_ns(cycles);
+#else
+	return k_cyc_to_ns_floor64(cycles);
+#endif
+}
+
+/* Budgets of 0 are not checked, they are only meaningful for one board */
+static int bench_check_budget(const struct shell *shell, uint32_t ns_per_op,
+			      uint32_t budget_ns)
+{
+	if (budget_ns == 0 || ns_per_op <= budget_ns) {
+		return 0;
+	}
+
+	shell_error(shell, "Regression: %u ns/op is over the budget of %u ns",
+		    ns_per_op, budget_ns);
+
+	return -ETIME;
+}
+
+/* Original double precision implementation, kept as the baseline */
+static int8_t dew_point_double(float fTemp, float fHum)
+{
+	float hTmp =
+		(log10(fHum) - 2) / 0.4343 + (17.62 * fTemp) / (243.12 + fTemp);
+	hTmp = 243.12 * hTmp / (17.62 - hTmp);
+
+	return (int8_t)hTmp;
+}
+
+/* Runs an implementation, the result is only consumed by the timed pass */
+static int32_t dew_point_run(enum dew_point_impl impl, int16_t temperature,
+			     uint16_t humidity)
+{
+	switch (impl) {
+	case DEW_POINT_IMPL_DOUBLE:
+		return dew_point_double(temperature / CENTI_DIVIDER,
+					humidity / CENTI_DIVIDER);
+	case DEW_POINT_IMPL_FLOAT:
+		return (int32_t)workload_dew_point_float(temperature, humidity);
+	case DEW_POINT_IMPL_FIXED:
+	default:
+		return calculate_dew_point_fixed(temperature, humidity);
+	}
+}
+
+/* Runs an implementation and returns the dew point in degrees C */
+static double dew_point_result(enum dew_point_impl impl, int16_t temperature,
+			       uint16_t humidity)
+{
+	switch (impl) {
+	case DEW_POINT_IMPL_DOUBLE:
+		return dew_point_double(temperature / CENTI_DIVIDER,
+					humidity / CENTI_DIVIDER);
+	case DEW_POINT_IMPL_FLOAT:
+		return workload_dew_point_float(temperature, humidity);
+	case DEW_POINT_IMPL_FIXED:
+	default:
+		return calculate_dew_point_fixed(temperature, humidity) /
+		       100.0;
+	}
+}
+
+static int cmd_bench_dewpoint(const struct shell *shell, size_t argc,
+			      char **argv)
+{
+	enum dew_point_impl impl;
+	bench_time_t start, end;
+	uint32_t operations;
+	uint32_t ns_per_op;
+	uint64_t cycles;
+	double error, error_max, error_sum;
+	int16_t t;
+	uint16_t h;
+	int rc = 0;
+
+	bench_begin();
+
+	shell_print(shell, "%-18s %10s %10s %14s %14s", "implementation",
+		    "cycles/op", "ns/op", "max err mC", "mean err mC");
+
+	for (impl = 0; impl < DEW_POINT_IMPL_COUNT; ++impl) {
+		/* Timed pass */
+		operations = 0;
+		start = bench_timestamp();
+		for (t = GRID_TEMPERATURE_MIN; t <= GRID_TEMPERATURE_MAX;
+		     t += GRID_TEMPERATURE_STEP) {
+			for (h = GRID_HUMIDITY_MIN; h <= GRID_HUMIDITY_MAX;
+			     h += GRID_HUMIDITY_STEP) {
+				bench_sink = dew_point_run(impl, t, h);
+				++operations;
+			}
+		}
+		end = bench_timestamp();
+		cycles = bench_cycles(&start, &end);
+
+		/* Accuracy pass against the exact Magnus formula */
+		error_max = 0;
+		error_sum = 0;
+		for (t = GRID_TEMPERATURE_MIN; t <= GRID_TEMPERATURE_MAX;
+		     t += GRID_TEMPERATURE_STEP) {
+			for (h = GRID_HUMIDITY_MIN; h <= GRID_HUMIDITY_MAX;
+			     h += GRID_HUMIDITY_STEP) {
+				error = fabs(dew_point_result(impl, t, h) -
+					     workload_dew_point_exact(t, h) /
+						     100.0);
+				error_sum += error;
+				if (error > error_max) {
+					error_max = error;
+				}
+			}
+		}
+
+		ns_per_op = (uint32_t)(bench_cycles_to_ns(cycles) / operations);
+		shell_print(shell, "%-18s %10u %10u %14u %14u",
+			    dew_point_impl_names[impl],
+			    (uint32_t)(cycles / operations), ns_per_op,
+			    (uint32_t)(error_max * ERROR_MULTIPLIER),
+			    (uint32_t)(error_sum * ERROR_MULTIPLIER /
+				       operations));
+
+		/* Only the implementation used by the firmware is guarded */
+		if (impl != DEW_POINT_IMPL_FIXED) {
+			continue;
+		}
+		if (error_max > DEW_POINT_FIXED_ERROR_MAX) {
+			shell_error(shell, "Regression: maximum error over "
+					   "%u mC",
+				    (uint32_t)(DEW_POINT_FIXED_ERROR_MAX *
+					       ERROR_MULTIPLIER));
+			rc = -EDOM;
+		}
+		if (rc == 0) {
+			rc = bench_check_budget(
+				shell, ns_per_op,
+				CONFIG_ESS_BENCHMARK_DEW_POINT_BUDGET_NS);
+		}
+	}
+
+	bench_end();
+
+	return rc;
+}
+
+static int32_t conversion_run(enum conversion_impl impl,
+			      enum conversion_channel channel,
+			      const struct sensor_value *value)
+{
+	if (impl == CONVERSION_IMPL_FLOAT) {
+		return workload_conversion_float(channel, value);
+	}
+
+	return workload_conversion_fixed(channel, value);
+}
+
+static double conversion_exact(enum conversion_channel channel,
+			       const struct sensor_value *value)
+{
+	return (value->val1 + value->val2 / (double)SENSOR_FRACTION_DIVIDER) *
+	       workload_conversion_grid(channel)->multiplier;
+}
+
+static int cmd_bench_conversion(const struct shell *shell, size_t argc,
+				char **argv)
+{
+	const struct conversion_grid *grid;
+	enum conversion_channel channel;
+	enum conversion_impl impl;
+	struct sensor_value value;
+	bench_time_t start, end;
+	uint32_t budget_ns = CONFIG_ESS_BENCHMARK_CONVERSION_BUDGET_NS;
+	int32_t whole, fraction;
+	uint32_t operations;
+	uint32_t ns_per_op;
+	uint64_t cycles;
+	double error, error_max;
+	int rc = 0;
+
+	bench_begin();
+
+	shell_print(shell, "%-12s %-8s %10s %10s %18s", "channel",
+		    "impl", "cycles/op", "ns/op", "max err 0.001 unit");
+
+	for (channel = 0; channel < CONVERSION_CHANNEL_COUNT; ++channel) {
+		grid = workload_conversion_grid(channel);
+
+		for (impl = 0; impl < CONVERSION_IMPL_COUNT; ++impl) {
+			/* Timed pass */
+			operations = 0;
+			start = bench_timestamp();
+			for (whole = grid->min; whole <= grid->max; ++whole) {
+				for (fraction = 0;
+				     fraction < SENSOR_FRACTION_DIVIDER;
+				     fraction += GRID_SENSOR_FRACTION_STEP) {
+					workload_conversion_value(
+						&value, whole, fraction);
+					bench_sink = conversion_run(
+						impl, channel, &value);
+					++operations;
+				}
+			}
+			end = bench_timestamp();
+			cycles = bench_cycles(&start, &end);
+
+			/* Accuracy pass against double precision */
+			error_max = 0;
+			for (whole = grid->min; whole <= grid->max; ++whole) {
+				for (fraction = 0;
+				     fraction < SENSOR_FRACTION_DIVIDER;
+				     fraction += GRID_SENSOR_FRACTION_STEP) {
+					workload_conversion_value(
+						&value, whole, fraction);
+					error = fabs(
+						conversion_run(impl, channel,
+							       &value) -
+						conversion_exact(channel,
+								 &value));
+					error_max = MAX(error, error_max);
+				}
+			}
+
+			ns_per_op = (uint32_t)(bench_cycles_to_ns(cycles) /
+					       operations);
+			shell_print(shell, "%-12s %-8s %10u %10u %18u",
+				    grid->name, conversion_impl_names[impl],
+				    (uint32_t)(cycles / operations),
+				    ns_per_op,
+				    (uint32_t)(error_max * ERROR_MULTIPLIER));
+
+			if (impl != CONVERSION_IMPL_FIXED || rc != 0) {
+				continue;
+			}
+			if (error_max >= CONVERSION_FIXED_ERROR_MAX) {
+				shell_error(shell, "Regression: %s conversion "
+						   "is off by a whole unit",
+					    grid->name);
+				rc = -EDOM;
+			} else {
+				rc = bench_check_budget(shell, ns_per_op,
+							budget_ns);
+			}
+		}
+	}
+
+	bench_end();
+
+	return rc;
+}
+
+/* Evaluates the metrics for every sample of the grid, returns the number of
+ * samples and counts those for which all the metrics were calculated
+ */
+static uint32_t derived_run(uint32_t metrics, uint32_t *complete)
+{
+	struct ess_sample sample = { 0 };
+	uint32_t operations = 0;
+	int16_t t;
+	uint16_t h;
+
+	derived_state_init(&derived_bench_state);
+	*complete = 0;
+
+	for (t = GRID_TEMPERATURE_MIN; t <= GRID_TEMPERATURE_MAX;
+	     t += GRID_TEMPERATURE_STEP) {
+		for (h = GRID_HUMIDITY_MIN; h <= GRID_HUMIDITY_MAX;
+		     h += GRID_HUMIDITY_STEP) {
+			sample.timestamp =
+				(int64_t)operations * DERIVED_SAMPLE_PERIOD_MS;
+			sample.temperature = t;
+			sample.humidity = h;
+			sample.pressure = DERIVED_PRESSURE_BASE +
+					  operations % DERIVED_PRESSURE_RANGE;
+			sample.gas_resistance = DERIVED_GAS_BASE +
+						operations % DERIVED_GAS_RANGE;
+			sample.gas_sequence = operations + 1;
+			if (derived_evaluate(&derived_bench_state, metrics,
+					     &sample) == metrics) {
+				++*complete;
+			}
+			++operations;
+		}
+	}
+
+	return operations;
+}
+
+static int cmd_bench_derived(const struct shell *shell, size_t argc,
+			     char **argv)
+{
+	bench_time_t start, end;
+	uint32_t operations;
+	uint32_t complete;
+	uint32_t ns_per_op = 0;
+	uint32_t metrics;
+	uint64_t cycles;
+	size_t metric;
+
+	bench_begin();
+
+	shell_print(shell, "%-18s %10s %10s %10s", "metric", "cycles/op",
+		    "ns/op", "valid");
+
+	/* The final pass calculates all the metrics together, which costs
+	 * less than the sum of the rows as they share the Magnus terms
+	 */
+	for (metric = 0; metric <= DERIVED_METRIC_COUNT; ++metric) {
+		metrics = (metric < DERIVED_METRIC_COUNT ?
+				   BIT(metric) :
+				   DERIVED_METRICS_ALL);
+
+		start = bench_timestamp();
+		operations = derived_run(metrics, &complete);
+		end = bench_timestamp();
+		cycles = bench_cycles(&start, &end);
+
+		ns_per_op = (uint32_t)(bench_cycles_to_ns(cycles) / operations);
+		shell_print(shell, "%-18s %10u %10u %10u",
+			    (metric < DERIVED_METRIC_COUNT ?
+				     derived_metric_name(metric) :
+				     "all"),
+			    (uint32_t)(cycles / operations), ns_per_op,
+			    complete);
+	}
+
+	bench_end();
+
+	return bench_check_budget(shell, ns_per_op,
+				  CONFIG_ESS_BENCHMARK_DERIVED_BUDGET_NS);
+}
+
+#ifdef CONFIG_ESS_FILTER
+/* Fills in the readings of sample n, clean is set to the readings without
+ * the noise or spike
+ */
+static void filter_bench_sample(uint32_t n, int32_t *clean,
+				struct ess_sample *sample)
+{
+	uint32_t position = n % FILTER_WAVE_PERIOD;
+	int32_t noise = (int32_t)((n * 7919) % FILTER_NOISE_RANGE) -
+			FILTER_NOISE_RANGE / 2;
+	int32_t readings[FILTER_CHANNEL_COUNT];
+	size_t i;
+
+	if (position >= FILTER_WAVE_PERIOD / 2) {
+		position = FILTER_WAVE_PERIOD - position;
+	}
+
+	for (i = 0; i < FILTER_CHANNEL_COUNT; ++i) {
+		clean[i] = filter_bases[i] + filter_slopes[i] * position;
+		readings[i] = clean[i] + noise;
+		if (n % FILTER_SPIKE_INTERVAL == FILTER_SPIKE_INTERVAL - 1) {
+			readings[i] += filter_spikes[i];
+		}
+	}
+
+	sample->timestamp = (int64_t)n * FILTER_SAMPLE_PERIOD_MS;
+	sample->temperature = (int16_t)readings[FILTER_CHANNEL_TEMPERATURE];
+	sample->humidity = (uint16_t)readings[FILTER_CHANNEL_HUMIDITY];
+	sample->pressure = (uint32_t)readings[FILTER_CHANNEL_PRESSURE];
+}
+
+static int cmd_bench_filter(const struct shell *shell, size_t argc,
+			    char **argv)
+{
+	struct filter_config config;
+	struct ess_sample sample = { 0 };
+	int32_t clean[FILTER_CHANNEL_COUNT];
+	int32_t filtered[FILTER_CHANNEL_COUNT];
+	uint32_t passed[FILTER_CHANNEL_COUNT] = { 0 };
+	bench_time_t start, end;
+	uint64_t cycles = 0;
+	uint32_t ns_per_op;
+	int failures = 0;
+	uint32_t n;
+	size_t i;
+
+	filter_state_init(&filter_bench_state);
+
+	bench_begin();
+
+	/* Only the filter is timed, a spike has passed if any output is
+	 * closer to the spike than to the clean reading
+	 */
+	for (n = 0; n < FILTER_SAMPLES; ++n) {
+		filter_bench_sample(n, clean, &sample);
+
+		start = bench_timestamp();
+		filter_apply(&filter_bench_state, &sample);
+		end = bench_timestamp();
+		cycles += bench_cycles(&start, &end);
+
+		filtered[FILTER_CHANNEL_TEMPERATURE] = sample.temperature;
+		filtered[FILTER_CHANNEL_HUMIDITY] = sample.humidity;
+		filtered[FILTER_CHANNEL_PRESSURE] = (int32_t)sample.pressure;
+		for (i = 0; i < FILTER_CHANNEL_COUNT; ++i) {
+			if (filtered[i] - clean[i] > filter_spikes[i] / 2) {
+				++passed[i];
+			}
+		}
+	}
+
+	bench_end();
+
+	shell_print(shell, "%-12s %6s %5s %10s %8s", "channel", "median",
+		    "shift", "rate/min", "spikes");
+
+	/* Every spike is a single sample, so any median rejects them all */
+	for (i = 0; i < FILTER_CHANNEL_COUNT; ++i) {
+		filter_get_config(i, &config);
+		shell_print(shell, "%-12s %6u %5u %10u %3u/%-4u",
+			    filter_channel_name(i), config.median_window,
+			    config.ema_shift, config.max_rate, passed[i],
+			    FILTER_SAMPLES / FILTER_SPIKE_INTERVAL);
+		if (config.median_window > 1 && passed[i] > 0) {
+			shell_error(shell, "%s spikes were not rejected",
+				    filter_channel_name(i));
+			++failures;
+		}
+	}
+
+	ns_per_op = (uint32_t)(bench_cycles_to_ns(cycles) / FILTER_SAMPLES);
+	shell_print(shell, "filter: %u samples, %u cycles/sample, %u ns/sample",
+		    FILTER_SAMPLES, (uint32_t)(cycles / FILTER_SAMPLES),
+		    ns_per_op);
+
+	if (failures > 0) {
+		return -EINVAL;
+	}
+
+	return bench_check_budget(shell, ns_per_op,
+				  CONFIG_ESS_BENCHMARK_FILTER_BUDGET_NS);
+}
+#endif
+
+#ifdef CONFIG_DISPLAY
+static int cmd_bench_chart(const struct shell *shell, size_t argc,
+			   char **argv)
+{
+	bench_time_t start, end;
+	uint32_t points;
+	uint32_t ns_per_op;
+	uint64_t cycles;
+
+	workload_chart_init(chart_levels, INT16_MAX);
+
+	bench_begin();
+
+	/* The LVGL redraw of the shown level is measured by "bench display"
+	 * instead
+	 */
+	start = bench_timestamp();
+	points = workload_chart_run(chart_levels);
+	end = bench_timestamp();
+	cycles = bench_cycles(&start, &end);
+
+	bench_end();
+
+	ns_per_op = (uint32_t)(bench_cycles_to_ns(cycles) /
+			       WORKLOAD_CHART_SAMPLES);
+	shell_print(shell,
+		    "chart: %u samples, %u points, %u cycles/sample, "
+		    "%u ns/sample",
+		    WORKLOAD_CHART_SAMPLES, points,
+		    (uint32_t)(cycles / WORKLOAD_CHART_SAMPLES), ns_per_op);
+
+	return bench_check_budget(shell, ns_per_op,
+				  CONFIG_ESS_BENCHMARK_CHART_BUDGET_NS);
+}
+#endif
+
+static int cmd_bench_all(const struct shell *shell, size_t argc, char **argv)
+{
+	int failures = 0;
+
+	/* Every benchmark runs even if an earlier one has regressed */
+	failures += (cmd_bench_dewpoint(shell, argc, argv) != 0);
+	failures += (cmd_bench_conversion(shell, argc, argv) != 0);
+	failures += (cmd_bench_derived(shell, argc, argv) != 0);
+#ifdef CONFIG_ESS_FILTER
+	failures += (cmd_bench_filter(shell, argc, argv) != 0);
+#endif
+#ifdef CONFIG_DISPLAY
+	failures += (cmd_bench_chart(shell, argc, argv) != 0);
+#endif
+
+	if (failures > 0) {
+		shell_error(shell, "%d benchmark(s) regressed", failures);
+		return -EINVAL;
+	}
+
+	shell_print(shell, "All benchmarks passed");
+
+	return 0;
+}
+
+#ifdef CONFIG_ESS_BULK
+static int cmd_bench_bulk(const struct shell *shell, size_t argc,
+			  char **argv)
+{
+	struct bulk_stats stats;
+
+	bulk_get_stats(&stats);
+
+	/* The transfers are started by the central, this reports the results
+	 * measured on this side of the link
+	 */
+	shell_print(shell, "throughput test: %u bytes in %u ms, %u bytes/s",
+		    stats.bytes, stats.duration_ms,
+		    (stats.duration_ms == 0 ?
+			     0 :
+			     (uint32_t)(((uint64_t)stats.bytes * MSEC_PER_SEC) /
+					stats.duration_ms)));
+	shell_print(shell,
+		    "live samples: %u sent, %u dropped, latency min %u ms, "
+		    "mean %u ms, max %u ms",
+		    stats.samples, stats.samples_dropped, stats.latency_min_ms,
+		    (stats.samples == 0 ?
+			     0 :
+			     (uint32_t)(stats.latency_total_ms / stats.samples)),
+		    stats.latency_max_ms);
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_DISPLAY
+static int cmd_bench_display(const struct shell *shell, size_t argc,
+			     char **argv)
+{
+	struct lcd_stats stats;
+	uint32_t uptime_ms = k_uptime_get_32();
+
+	lcd_get_stats(&stats);
+
+	shell_print(shell,
+		    "display: %u wakeups in %u ms (%u per s), idle %u ms "
+		    "(%u%%), busy %u us",
+		    stats.wakeups, uptime_ms,
+		    (uint32_t)(((uint64_t)stats.wakeups * MSEC_PER_SEC) /
+			       MAX(uptime_ms, 1)),
+		    stats.idle_ms,
+		    (uint32_t)(((uint64_t)stats.idle_ms * 100) /
+			       MAX(uptime_ms, 1)),
+		    stats.busy_us);
+
+#ifdef CONFIG_ESS_DISPLAY_FLUSH
+	struct lcd_flush_stats flush_stats;
+
+	lcd_flush_get_stats(&flush_stats);
+
+	/* Bus time which is not waited for was overlapped with rendering */
+	shell_print(shell,
+		    "flush: %u stripes, SPI busy %u us (%u us/stripe), "
+		    "render waited %u us",
+		    flush_stats.stripes, flush_stats.bus_us,
+		    flush_stats.bus_us / MAX(flush_stats.stripes, 1),
+		    flush_stats.wait_us);
+#endif
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_ESS_TRACE
+static int cmd_bench_trace(const struct shell *shell, size_t argc,
+			   char **argv)
+{
+	struct trace_stage_stats stats;
+	enum trace_stage stage;
+	size_t last;
+	size_t i;
+
+	if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+		trace_reset();
+		return 0;
+	}
+
+	shell_print(shell, "%-16s %8s %10s %10s  %s", "stage", "count",
+		    "mean us", "max us", "histogram (<1, <2, <4 ... us)");
+
+	for (stage = 0; stage < TRACE_STAGE_COUNT; ++stage) {
+		trace_get_stage(stage, &stats);
+
+		shell_fprintf(shell, SHELL_NORMAL, "%-16s %8u %10u %10u ",
+			      trace_stage_name(stage), stats.count,
+			      (stats.count == 0 ?
+				       0 :
+				       (uint32_t)(stats.total_us /
+						  stats.count)),
+			      stats.max_us);
+
+		/* Trailing empty buckets are left out */
+		for (last = ARRAY_SIZE(stats.buckets); last > 0; --last) {
+			if (stats.buckets[last - 1] != 0) {
+				break;
+			}
+		}
+		for (i = 0; i < last; ++i) {
+			shell_fprintf(shell, SHELL_NORMAL, " %u",
+				      stats.buckets[i]);
+		}
+		shell_fprintf(shell, SHELL_NORMAL, "\n");
+	}
+
+	return 0;
+}
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+	sub_bench,
+	SHELL_CMD(all, NULL,
+		  "Runs the dewpoint, conversion, derived, filter and chart "
+		  "benchmarks and fails on a regression",
+		  cmd_bench_all),
+	SHELL_CMD(dewpoint, NULL,
+		  "Dew point accuracy versus cycles over the sensor range",
+		  cmd_bench_dewpoint),
+	SHELL_CMD(conversion, NULL,
+		  "Sensor value conversion accuracy versus cycles, fixed "
+		  "point and float",
+		  cmd_bench_conversion),
+	SHELL_CMD(derived, NULL,
+		  "Cycles per sample of each derived metric and all of them "
+		  "together",
+		  cmd_bench_derived),
+	SHELL_COND_CMD(CONFIG_ESS_FILTER, filter, NULL,
+		       "Cycles per sample and spike rejection of the reading "
+		       "filter",
+		       cmd_bench_filter),
+	SHELL_COND_CMD(CONFIG_DISPLAY, chart, NULL,
+		       "Cycles per sample to add a day of samples to the "
+		       "chart zoom levels",
+		       cmd_bench_chart),
+	SHELL_COND_CMD(CONFIG_ESS_BULK, bulk, NULL,
+		       "Results of the last L2CAP bulk channel transfers",
+		       cmd_bench_bulk),
+	SHELL_COND_CMD(CONFIG_DISPLAY, display, NULL,
+		       "Display loop wakeups, idle time and flush overlap",
+		       cmd_bench_display),
+	SHELL_COND_CMD(CONFIG_ESS_TRACE, trace, NULL,
+		       "Sample pipeline stage latencies, \"reset\" clears them",
+		       cmd_bench_trace),
+	SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(bench, &sub_bench, "ESS demo benchmarks", NULL);
@@ -0,0 +1,599 @@
+/**
+ * @file bulk.c
+ * @brief LE L2CAP connection oriented channel for bulk transfer of the
+ * sample history, live samples and throughput measurements
+ *
+ * The central sends commands as SDUs, every SDU sent back starts with a
+ * type byte. See docs/ble.md for the protocol.
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <string.h>
+#include <logging/log.h>
+#include <sys/byteorder.h>
+#include <net/buf.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/l2cap.h>
+
+#include "bulk.h"
+#include "acquisition.h"
+#include "conn_policy.h"
+#ifdef CONFIG_ESS_HISTORY
+#include "history.h"
+#endif
+
+LOG_MODULE_REGISTER(bulk);
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define BULK_RETRY_MS 10
+#define BULK_COMMAND_QUEUE_SIZE 2
+#define BULK_COMMAND_MAX_SIZE 9
+#define BULK_TYPE_SIZE 1
+
+enum bulk_opcode {
+	BULK_OPCODE_READ_RANGE = 0x01,
+	BULK_OPCODE_LIVE = 0x02,
+	BULK_OPCODE_THROUGHPUT = 0x03,
+};
+
+enum bulk_type {
+	BULK_TYPE_HISTORY_BLOCK = 0x10,
+	BULK_TYPE_SAMPLE = 0x11,
+	BULK_TYPE_TEST_DATA = 0x12,
+	BULK_TYPE_RESPONSE = 0x80,
+};
+
+enum bulk_status {
+	BULK_STATUS_SUCCESS = 0x01,
+	BULK_STATUS_NOT_SUPPORTED = 0x02,
+	BULK_STATUS_INVALID = 0x03,
+	BULK_STATUS_FAILED = 0x04,
+};
+
+/* Sequence, timestamp, temperature, humidity, pressure, dew point */
+#define SAMPLE_RECORD_SIZE 22
+
+struct bulk_command {
+	uint8_t size;
+	uint8_t data[BULK_COMMAND_MAX_SIZE];
+};
+
+struct bulk_transfer {
+	uint8_t opcode;
+	uint32_t count;
+	uint32_t remaining;
+	int64_t start;
+#ifdef CONFIG_ESS_HISTORY
+	struct history_cursor cursor;
+#endif
+};
+
+struct bulk_response {
+	bool pending;
+	uint8_t opcode;
+	uint8_t status;
+	uint32_t count;
+	uint32_t duration_ms;
+};
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static int bulk_accept(struct bt_conn *conn, struct bt_l2cap_chan **chan);
+static void bulk_connected(struct bt_l2cap_chan *chan);
+static void bulk_disconnected(struct bt_l2cap_chan *chan);
+static int bulk_recv(struct bt_l2cap_chan *chan, struct net_buf *buf);
+static void bulk_sent(struct bt_l2cap_chan *chan);
+static void bulk_retry_handler(struct k_timer *timer);
+static struct net_buf *alloc_sdu(uint8_t type);
+static int send_sdu(struct net_buf *buf, int64_t sample_timestamp);
+static void send_response(uint8_t opcode, uint8_t status, uint32_t count,
+			  uint32_t duration_ms);
+static bool flush_response(void);
+static void start_transfer(const struct bulk_command *command);
+static bool continue_transfer(void);
+static bool transfer_in_flight(void);
+static void send_live_samples(void);
+static void count_dropped_sample(void);
+static void update_policy(void);
+static void bulk_work_handler(struct k_work *work);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+NET_BUF_POOL_FIXED_DEFINE(bulk_tx_pool, CONFIG_ESS_BULK_TX_BUFS,
+			  BT_L2CAP_SDU_BUF_SIZE(CONFIG_ESS_BULK_MTU), NULL);
+
+K_MSGQ_DEFINE(bulk_commands, sizeof(struct bulk_command),
+	      BULK_COMMAND_QUEUE_SIZE, 4);
+K_WORK_DEFINE(bulk_work, bulk_work_handler);
+K_TIMER_DEFINE(bulk_retry_timer, bulk_retry_handler, NULL);
+
+static const struct bt_l2cap_chan_ops bulk_chan_ops = {
+	.connected = bulk_connected,
+	.disconnected = bulk_disconnected,
+	.recv = bulk_recv,
+	.sent = bulk_sent,
+};
+
+static struct bt_l2cap_le_chan bulk_chan = {
+	.chan.ops = &bulk_chan_ops,
+	.rx.mtu = CONFIG_ESS_BULK_MTU,
+};
+
+static struct bt_l2cap_server bulk_server = {
+	.psm = CONFIG_ESS_BULK_PSM,
+	.sec_level = BT_SECURITY_L1,
+	.accept = bulk_accept,
+};
+
+static struct sample_ring_reader bulk_reader;
+static struct acquisition_consumer bulk_consumer = {
+	.work = &bulk_work,
+};
+
+/* Set from the Bluetooth thread, everything else is only accessed from the
+ * system workqueue
+ */
+static atomic_t bulk_chan_connected;
+static atomic_t bulk_live;
+
+/* Set whilst the fast connection parameters are held for a transfer or
+ * live samples
+ */
+static bool bulk_policy_held;
+
+static struct bulk_transfer bulk_transfer;
+static struct bulk_response bulk_response;
+
+/* Updated from the Bluetooth thread and the system workqueue, read by the
+ * shell
+ */
+static struct bulk_stats bulk_stats;
+static struct k_spinlock bulk_stats_lock;
+
+/* Timestamps of the live samples in flight, in the order they were sent, 0
+ * for other SDUs
+ */
+static int64_t bulk_in_flight[CONFIG_ESS_BULK_TX_BUFS];
+static uint32_t bulk_in_flight_head;
+static uint32_t bulk_in_flight_count;
+K_MUTEX_DEFINE(bulk_in_flight_mutex);
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static int bulk_accept(struct bt_conn *conn, struct bt_l2cap_chan **chan)
+{
+	if (atomic_get(&bulk_chan_connected)) {
+		return -ENOMEM;
+	}
+
+	*chan = &bulk_chan.chan;
+
+	return 0;
+}
+
+static void bulk_connected(struct bt_l2cap_chan *chan)
+{
+	LOG_INF("Bulk channel connected, TX MTU %u", bulk_chan.tx.mtu);
+
+	k_mutex_lock(&bulk_in_flight_mutex, K_FOREVER);
+	bulk_in_flight_count = 0;
+	k_mutex_unlock(&bulk_in_flight_mutex);
+
+	atomic_set(&bulk_chan_connected, 1);
+}
+
+static void bulk_disconnected(struct bt_l2cap_chan *chan)
+{
+	LOG_INF("Bulk channel disconnected");
+
+	atomic_clear(&bulk_chan_connected);
+	atomic_clear(&bulk_live);
+	k_work_submit(&bulk_work);
+}
+
+static int bulk_recv(struct bt_l2cap_chan *chan, struct net_buf *buf)
+{
+	struct bulk_command command;
+
+	if (buf->len == 0 || buf->len > sizeof(command.data)) {
+		return 0;
+	}
+
+	command.size = buf->len;
+	memcpy(command.data, buf->data, buf->len);
+
+	if (command.data[0] == BULK_OPCODE_LIVE) {
+		/* Handled here so that it takes effect during a transfer */
+		atomic_set(&bulk_live, (command.size > 1 && command.data[1]));
+	} else if (k_msgq_put(&bulk_commands, &command, K_NO_WAIT) != 0) {
+		LOG_WRN("Bulk command dropped");
+	}
+
+	k_work_submit(&bulk_work);
+
+	return 0;
+}
+
+static void bulk_sent(struct bt_l2cap_chan *chan)
+{
+	int64_t timestamp = 0;
+	uint32_t latency;
+	k_spinlock_key_t key;
+
+	k_mutex_lock(&bulk_in_flight_mutex, K_FOREVER);
+	if (bulk_in_flight_count > 0) {
+		timestamp = bulk_in_flight[(bulk_in_flight_head -
+					    bulk_in_flight_count) %
+					   CONFIG_ESS_BULK_TX_BUFS];
+		--bulk_in_flight_count;
+	}
+	k_mutex_unlock(&bulk_in_flight_mutex);
+
+	/* Time from the sensor read to the SDU being sent over the air */
+	if (timestamp != 0) {
+		latency = (uint32_t)(k_uptime_get() - timestamp);
+		key = k_spin_lock(&bulk_stats_lock);
+		if (bulk_stats.samples == 0 ||
+		    latency < bulk_stats.latency_min_ms) {
+			bulk_stats.latency_min_ms = latency;
+		}
+		bulk_stats.latency_max_ms =
+			MAX(bulk_stats.latency_max_ms, latency);
+		bulk_stats.latency_total_ms += latency;
+		++bulk_stats.samples;
+		k_spin_unlock(&bulk_stats_lock, key);
+	}
+
+	k_work_submit(&bulk_work);
+}
+
+static void bulk_retry_handler(struct k_timer *timer)
+{
+	k_work_submit(&bulk_work);
+}
+
+static struct net_buf *alloc_sdu(uint8_t type)
+{
+	struct net_buf *buf;
+
+	buf = net_buf_alloc(&bulk_tx_pool, K_NO_WAIT);
+	if (buf != NULL) {
+		net_buf_reserve(buf, BT_L2CAP_SDU_CHAN_SEND_RESERVE);
+		net_buf_add_u8(buf, type);
+	}
+
+	return buf;
+}
+
+static int send_sdu(struct net_buf *buf, int64_t sample_timestamp)
+{
+	int rc;
+
+	k_mutex_lock(&bulk_in_flight_mutex, K_FOREVER);
+	bulk_in_flight[bulk_in_flight_head % CONFIG_ESS_BULK_TX_BUFS] =
+		sample_timestamp;
+	++bulk_in_flight_head;
+	++bulk_in_flight_count;
+	k_mutex_unlock(&bulk_in_flight_mutex);
+
+	rc = bt_l2cap_chan_send(&bulk_chan.chan, buf);
+	if (rc < 0) {
+		k_mutex_lock(&bulk_in_flight_mutex, K_FOREVER);
+		--bulk_in_flight_head;
+		--bulk_in_flight_count;
+		k_mutex_unlock(&bulk_in_flight_mutex);
+		net_buf_unref(buf);
+		return rc;
+	}
+
+	return 0;
+}
+
+/* Only one response is outstanding at a time, the next command is not
+ * started until it has been sent
+ */
+static void send_response(uint8_t opcode, uint8_t status, uint32_t count,
+			  uint32_t duration_ms)
+{
+	bulk_response.pending = true;
+	bulk_response.opcode = opcode;
+	bulk_response.status = status;
+	bulk_response.count = count;
+	bulk_response.duration_ms = duration_ms;
+
+	(void)flush_response();
+}
+
+/* Returns false whilst the response is waiting for a buffer */
+static bool flush_response(void)
+{
+	struct net_buf *buf;
+
+	if (!bulk_response.pending) {
+		return true;
+	}
+
+	buf = alloc_sdu(BULK_TYPE_RESPONSE);
+	if (buf == NULL) {
+		return false;
+	}
+
+	net_buf_add_u8(buf, bulk_response.opcode);
+	net_buf_add_u8(buf, bulk_response.status);
+	net_buf_add_le32(buf, bulk_response.count);
+	net_buf_add_le32(buf, bulk_response.duration_ms);
+
+	bulk_response.pending = false;
+	(void)send_sdu(buf, 0);
+
+	return true;
+}
+
+static void start_transfer(const struct bulk_command *command)
+{
+	memset(&bulk_transfer, 0, sizeof(bulk_transfer));
+	bulk_transfer.opcode = command->data[0];
+	bulk_transfer.start = k_uptime_get();
+
+	switch (command->data[0]) {
+#ifdef CONFIG_ESS_HISTORY
+	case BULK_OPCODE_READ_RANGE:
+		if (command->size != 9) {
+			break;
+		}
+		if (MIN(bulk_chan.tx.mtu, CONFIG_ESS_BULK_MTU) <
+		    BULK_TYPE_SIZE + CONFIG_ESS_HISTORY_BLOCK_SIZE) {
+			/* Blocks are sent whole, one per SDU */
+			send_response(bulk_transfer.opcode, BULK_STATUS_FAILED,
+				      0, 0);
+			bulk_transfer.opcode = 0;
+			return;
+		}
+		history_cursor_init(&bulk_transfer.cursor,
+				    sys_get_le32(&command->data[1]),
+				    sys_get_le32(&command->data[5]));
+		return;
+#endif
+	case BULK_OPCODE_THROUGHPUT:
+		if (command->size != 5) {
+			break;
+		}
+		bulk_transfer.remaining = sys_get_le32(&command->data[1]);
+		return;
+	default:
+		send_response(bulk_transfer.opcode, BULK_STATUS_NOT_SUPPORTED,
+			      0, 0);
+		bulk_transfer.opcode = 0;
+		return;
+	}
+
+	send_response(bulk_transfer.opcode, BULK_STATUS_INVALID, 0, 0);
+	bulk_transfer.opcode = 0;
+}
+
+static bool transfer_in_flight(void)
+{
+	uint32_t count;
+
+	k_mutex_lock(&bulk_in_flight_mutex, K_FOREVER);
+	count = bulk_in_flight_count;
+	k_mutex_unlock(&bulk_in_flight_mutex);
+
+	return (count > 0);
+}
+
+static bool continue_transfer(void)
+{
+	struct net_buf *buf;
+	uint32_t duration_ms;
+	size_t size;
+	uint16_t mtu = MIN(bulk_chan.tx.mtu, CONFIG_ESS_BULK_MTU);
+	bool finished = false;
+	k_spinlock_key_t key;
+
+	buf = alloc_sdu(bulk_transfer.opcode == BULK_OPCODE_THROUGHPUT ?
+				BULK_TYPE_TEST_DATA :
+				BULK_TYPE_HISTORY_BLOCK);
+	if (buf == NULL) {
+		return false;
+	}
+
+	if (bulk_transfer.opcode == BULK_OPCODE_THROUGHPUT) {
+		size = MIN(bulk_transfer.remaining, mtu - BULK_TYPE_SIZE);
+		memset(net_buf_add(buf, size), (uint8_t)bulk_transfer.count,
+		       size);
+		bulk_transfer.remaining -= size;
+		finished = (size == 0);
+#ifdef CONFIG_ESS_HISTORY
+	} else {
+		size = history_read_block(&bulk_transfer.cursor,
+					  net_buf_tail(buf),
+					  net_buf_tailroom(buf));
+		net_buf_add(buf, size);
+		finished = (size == 0);
+#endif
+	}
+
+	if (finished) {
+		net_buf_unref(buf);
+
+		/* The duration includes sending the last SDU */
+		if (transfer_in_flight()) {
+			return false;
+		}
+
+		duration_ms = (uint32_t)(k_uptime_get() - bulk_transfer.start);
+		if (bulk_transfer.opcode == BULK_OPCODE_THROUGHPUT) {
+			key = k_spin_lock(&bulk_stats_lock);
+			bulk_stats.bytes = bulk_transfer.count;
+			bulk_stats.duration_ms = duration_ms;
+			k_spin_unlock(&bulk_stats_lock, key);
+			LOG_INF("Sent %u bytes in %u ms", bulk_transfer.count,
+				duration_ms);
+		}
+		send_response(bulk_transfer.opcode, BULK_STATUS_SUCCESS,
+			      bulk_transfer.count, duration_ms);
+		bulk_transfer.opcode = 0;
+		return false;
+	}
+
+	if (send_sdu(buf, 0) != 0) {
+		send_response(bulk_transfer.opcode, BULK_STATUS_FAILED,
+			      bulk_transfer.count, 0);
+		bulk_transfer.opcode = 0;
+		return false;
+	}
+
+	/* Throughput counts payload bytes, history counts blocks */
+	bulk_transfer.count +=
+		(bulk_transfer.opcode == BULK_OPCODE_THROUGHPUT ? size : 1);
+
+	return true;
+}
+
+static void send_live_samples(void)
+{
+	struct ess_sample sample;
+	struct net_buf *buf;
+
+	while (sample_ring_read(&bulk_reader, &sample) == 0) {
+		if (!atomic_get(&bulk_live)) {
+			continue;
+		}
+
+		buf = alloc_sdu(BULK_TYPE_SAMPLE);
+		if (buf == NULL) {
+			count_dropped_sample();
+			continue;
+		}
+
+		net_buf_add_le32(buf, sample.sequence);
+		net_buf_add_le64(buf, sample.timestamp);
+		net_buf_add_le16(buf, sample.temperature);
+		net_buf_add_le16(buf, sample.humidity);
+		net_buf_add_le32(buf, sample.pressure);
+		net_buf_add_le16(buf,
+				 sample.derived[DERIVED_METRIC_DEW_POINT]);
+
+		if (send_sdu(buf, sample.timestamp) != 0) {
+			count_dropped_sample();
+		}
+	}
+}
+
+static void count_dropped_sample(void)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&bulk_stats_lock);
+	++bulk_stats.samples_dropped;
+	k_spin_unlock(&bulk_stats_lock, key);
+}
+
+static void update_policy(void)
+{
+	bool active = (atomic_get(&bulk_chan_connected) &&
+		       (bulk_transfer.opcode != 0 || atomic_get(&bulk_live)));
+
+	if (active && !bulk_policy_held) {
+		conn_policy_bulk_begin(bulk_chan.chan.conn);
+	} else if (!active && bulk_policy_held &&
+		   atomic_get(&bulk_chan_connected)) {
+		conn_policy_bulk_end(bulk_chan.chan.conn);
+	}
+
+	/* After a disconnection the policy has already dropped the
+	 * connection
+	 */
+	bulk_policy_held = active;
+}
+
+static void bulk_work_handler(struct k_work *work)
+{
+	struct bulk_command command;
+
+	/* Samples are read even when live streaming is off so that streaming
+	 * starts from the next sample when it is turned on
+	 */
+	send_live_samples();
+
+	if (!atomic_get(&bulk_chan_connected)) {
+		bulk_transfer.opcode = 0;
+		bulk_response.pending = false;
+		k_msgq_purge(&bulk_commands);
+		update_policy();
+		return;
+	}
+
+	/* A response which found no buffer is sent before anything else, in
+	 * the same way as the transfers back off
+	 */
+	if (!flush_response()) {
+		k_timer_start(&bulk_retry_timer, K_MSEC(BULK_RETRY_MS),
+			      K_NO_WAIT);
+		return;
+	}
+
+	if (bulk_transfer.opcode == 0 &&
+	    k_msgq_get(&bulk_commands, &command, K_NO_WAIT) == 0) {
+		start_transfer(&command);
+	}
+
+	update_policy();
+
+	/* Sends until the buffers run out, the transfer is then resumed as
+	 * SDUs are sent (or after a short delay) so that other work items are
+	 * not held up
+	 */
+	while (bulk_transfer.opcode != 0) {
+		if (!continue_transfer()) {
+			if (bulk_transfer.opcode != 0) {
+				k_timer_start(&bulk_retry_timer,
+					      K_MSEC(BULK_RETRY_MS), K_NO_WAIT);
+				return;
+			}
+			update_policy();
+			break;
+		}
+	}
+
+	if (bulk_response.pending) {
+		k_timer_start(&bulk_retry_timer, K_MSEC(BULK_RETRY_MS),
+			      K_NO_WAIT);
+	} else if (k_msgq_num_used_get(&bulk_commands) > 0) {
+		k_work_submit(&bulk_work);
+	}
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+int bulk_init(void)
+{
+	sample_ring_reader_init(&bulk_reader);
+	acquisition_register_consumer(&bulk_consumer);
+
+	return bt_l2cap_server_register(&bulk_server);
+}
+
+void bulk_get_stats(struct bulk_stats *stats)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&bulk_stats_lock);
+	*stats = bulk_stats;
+	k_spin_unlock(&bulk_stats_lock, key);
+}
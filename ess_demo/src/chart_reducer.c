@@ -0,0 +1,152 @@
+/**
+ * @file chart_reducer.c
+ * @brief Incremental min/max downsampling of samples to a fixed number of
+ * chart points covering a time window
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+#include "chart_reducer.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+BUILD_ASSERT((CHART_REDUCER_POINTS % 2) == 0,
+	     "Chart points must be even, two are drawn per bucket");
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static void close_bucket(struct chart_reducer_level *level);
+static void add_to_bucket(struct chart_reducer_level *level,
+			  const int16_t *values);
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static void close_bucket(struct chart_reducer_level *level)
+{
+	uint16_t next = (level->head + 1) % level->point_count;
+	int16_t first, second;
+	size_t i;
+
+	for (i = 0; i < CHART_REDUCER_SERIES; ++i) {
+		if (level->count == 0) {
+			/* Nothing was sampled, the line is held level */
+			first = (level->primed ? level->last[i] : level->blank);
+			second = first;
+		} else if (level->max_first[i]) {
+			first = level->max[i];
+			second = level->min[i];
+		} else {
+			first = level->min[i];
+			second = level->max[i];
+		}
+
+		/* The extremes are drawn in the order they occurred, so the
+		 * line keeps the shape of the original samples
+		 */
+		level->points[i][level->head] = first;
+		level->points[i][next] = second;
+	}
+
+	level->head = (next + 1) % level->point_count;
+	level->count = 0;
+}
+
+static void add_to_bucket(struct chart_reducer_level *level,
+			  const int16_t *values)
+{
+	size_t i;
+
+	for (i = 0; i < CHART_REDUCER_SERIES; ++i) {
+		if (level->count == 0 || values[i] < level->min[i]) {
+			level->min[i] = values[i];
+			level->max_first[i] = (level->count != 0);
+		}
+		if (level->count == 0 || values[i] > level->max[i]) {
+			level->max[i] = values[i];
+			level->max_first[i] = (level->count == 0);
+		}
+		level->last[i] = values[i];
+	}
+
+	++level->count;
+	level->primed = true;
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void chart_reducer_init(struct chart_reducer_level *level, uint32_t window_ms,
+			uint32_t min_bucket_ms, int16_t blank)
+{
+	uint32_t buckets = CHART_REDUCER_BUCKETS;
+
+	/* Buckets shorter than the sample period would be drawn without a
+	 * sample of their own, fewer points are used instead
+	 */
+	if (min_bucket_ms > 0) {
+		buckets = MAX(MIN(window_ms / min_bucket_ms,
+				  CHART_REDUCER_BUCKETS),
+			      1);
+	}
+
+	level->bucket_ms = MAX(window_ms / buckets, 1);
+	level->point_count = (uint16_t)(buckets * 2);
+	level->blank = blank;
+	chart_reducer_clear(level);
+}
+
+void chart_reducer_clear(struct chart_reducer_level *level)
+{
+	size_t i, j;
+
+	for (i = 0; i < CHART_REDUCER_SERIES; ++i) {
+		for (j = 0; j < CHART_REDUCER_POINTS; ++j) {
+			level->points[i][j] = level->blank;
+		}
+	}
+
+	level->bucket_end = 0;
+	level->primed = false;
+	level->count = 0;
+	level->head = 0;
+}
+
+uint16_t chart_reducer_add(struct chart_reducer_level *level, int64_t time,
+			   const int16_t *values)
+{
+	uint16_t written = 0;
+	int64_t buckets;
+
+	if (level->bucket_end != 0 && time >= level->bucket_end) {
+		/* Buckets skipped by a gap in the samples are filled, but at
+		 * most one window's worth as older points are overwritten
+		 */
+		buckets = (time - level->bucket_end) / level->bucket_ms + 1;
+		buckets = MIN(buckets, level->point_count / 2);
+
+		while (buckets-- > 0) {
+			close_bucket(level);
+			written += 2;
+		}
+	}
+
+	/* Buckets are aligned to multiples of their length in uptime */
+	if (level->bucket_end == 0 || written > 0) {
+		level->bucket_end =
+			(time / level->bucket_ms + 1) * level->bucket_ms;
+	}
+
+	add_to_bucket(level, values);
+
+	return written;
+}
@@ -0,0 +1,297 @@
+/**
+ * @file conn_policy.c
+ * @brief Connection parameter policy, requests short intervals whilst bulk
+ * data is being transferred and long intervals with peripheral latency
+ * whilst only periodic updates are sent
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <string.h>
+#include <logging/log.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+
+#include "conn_policy.h"
+#include "ess_service.h"
+#include "sample_scheduler.h"
+
+LOG_MODULE_REGISTER(conn_policy);
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+struct conn_policy_state {
+	struct bt_conn *conn;
+	struct conn_policy_params params;
+	/* Number of bulk transfers in progress */
+	uint8_t bulk_users;
+	/* Subscribed whilst samples are taken at a high rate */
+	bool streaming;
+	int64_t last_bulk;
+};
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static struct conn_policy_state *find_state(struct bt_conn *conn);
+static void request_profile(struct conn_policy_state *state,
+			    enum conn_policy_profile profile);
+static void connected(struct bt_conn *conn, uint8_t err);
+static void disconnected(struct bt_conn *conn, uint8_t reason);
+static void le_param_updated(struct bt_conn *conn, uint16_t interval,
+			     uint16_t latency, uint16_t timeout);
+static void policy_timer_handler(struct k_timer *timer);
+static void policy_work_handler(struct k_work *work);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+K_MUTEX_DEFINE(conn_policy_mutex);
+K_WORK_DEFINE(conn_policy_work, policy_work_handler);
+K_TIMER_DEFINE(conn_policy_timer, policy_timer_handler, NULL);
+
+static struct conn_policy_state conn_policy_states[CONFIG_BT_MAX_CONN];
+
+static struct bt_conn_cb conn_policy_callbacks = {
+	.connected = connected,
+	.disconnected = disconnected,
+	.le_param_updated = le_param_updated,
+};
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static struct conn_policy_state *find_state(struct bt_conn *conn)
+{
+	struct conn_policy_state *state;
+
+	if (conn == NULL) {
+		return NULL;
+	}
+
+	state = &conn_policy_states[bt_conn_index(conn)];
+
+	return (state->conn == conn ? state : NULL);
+}
+
+static void request_profile(struct conn_policy_state *state,
+			    enum conn_policy_profile profile)
+{
+	static const struct bt_le_conn_param fast_param =
+		BT_LE_CONN_PARAM_INIT(CONFIG_ESS_CONN_FAST_INTERVAL_MIN,
+				      CONFIG_ESS_CONN_FAST_INTERVAL_MAX,
+				      CONFIG_ESS_CONN_FAST_LATENCY,
+				      CONFIG_ESS_CONN_FAST_TIMEOUT);
+	static const struct bt_le_conn_param slow_param =
+		BT_LE_CONN_PARAM_INIT(CONFIG_ESS_CONN_SLOW_INTERVAL_MIN,
+				      CONFIG_ESS_CONN_SLOW_INTERVAL_MAX,
+				      CONFIG_ESS_CONN_SLOW_LATENCY,
+				      CONFIG_ESS_CONN_SLOW_TIMEOUT);
+	int rc;
+
+	if (state->params.profile == profile) {
+		return;
+	}
+
+	rc = bt_conn_le_param_update(state->conn,
+				     (profile == CONN_POLICY_PROFILE_FAST ?
+					      &fast_param :
+					      &slow_param));
+	if (rc == 0) {
+		state->params.profile = profile;
+		LOG_DBG("Requested %s parameters",
+			(profile == CONN_POLICY_PROFILE_FAST ? "fast" : "slow"));
+	} else {
+		LOG_WRN("Connection parameter update failed (err %d)", rc);
+	}
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	struct conn_policy_state *state;
+	struct bt_conn_info info;
+
+	if (err || bt_conn_get_info(conn, &info) != 0) {
+		return;
+	}
+
+	k_mutex_lock(&conn_policy_mutex, K_FOREVER);
+
+	state = &conn_policy_states[bt_conn_index(conn)];
+	memset(state, 0, sizeof(*state));
+	state->conn = conn;
+	state->params.interval = info.le.interval;
+	state->params.latency = info.le.latency;
+	state->params.timeout = info.le.timeout;
+
+	/* The central usually starts fast for service discovery, so the slow
+	 * parameters are only requested once that has had time to finish
+	 */
+	state->last_bulk = k_uptime_get();
+
+	k_mutex_unlock(&conn_policy_mutex);
+
+	k_timer_start(&conn_policy_timer, K_MSEC(CONFIG_ESS_CONN_SLOW_DELAY_MS),
+		      K_NO_WAIT);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	struct conn_policy_state *state;
+
+	k_mutex_lock(&conn_policy_mutex, K_FOREVER);
+
+	state = find_state(conn);
+	if (state != NULL) {
+		state->conn = NULL;
+	}
+
+	k_mutex_unlock(&conn_policy_mutex);
+}
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval,
+			     uint16_t latency, uint16_t timeout)
+{
+	struct conn_policy_state *state;
+
+	LOG_INF("Connection parameters interval %u, latency %u, timeout %u",
+		interval, latency, timeout);
+
+	k_mutex_lock(&conn_policy_mutex, K_FOREVER);
+
+	state = find_state(conn);
+	if (state != NULL) {
+		state->params.interval = interval;
+		state->params.latency = latency;
+		state->params.timeout = timeout;
+		++state->params.updates;
+	}
+
+	k_mutex_unlock(&conn_policy_mutex);
+}
+
+static void policy_timer_handler(struct k_timer *timer)
+{
+	k_work_submit(&conn_policy_work);
+}
+
+static void policy_work_handler(struct k_work *work)
+{
+	struct conn_policy_state *state;
+	int64_t now = k_uptime_get();
+	int64_t wait = INT64_MAX;
+	int64_t idle;
+	bool high_rate = (sample_scheduler_get_period() <=
+			  CONFIG_ESS_CONN_STREAM_PERIOD_MS);
+	bool streaming;
+	size_t i;
+
+	k_mutex_lock(&conn_policy_mutex, K_FOREVER);
+
+	for (i = 0; i < ARRAY_SIZE(conn_policy_states); ++i) {
+		state = &conn_policy_states[i];
+		if (state->conn == NULL) {
+			continue;
+		}
+
+		/* Notifications at a high sample rate are held to the fast
+		 * parameters like a transfer, and the slow delay runs from
+		 * when the stream ends
+		 */
+		streaming = (high_rate &&
+			     ess_service_is_subscribed(state->conn));
+		if (state->streaming && !streaming) {
+			state->last_bulk = now;
+		}
+		state->streaming = streaming;
+
+		idle = now - state->last_bulk;
+		if (state->bulk_users > 0 || state->streaming) {
+			request_profile(state, CONN_POLICY_PROFILE_FAST);
+		} else if (idle >= CONFIG_ESS_CONN_SLOW_DELAY_MS) {
+			request_profile(state, CONN_POLICY_PROFILE_SLOW);
+		} else {
+			/* Short gaps between transfers stay fast */
+			wait = MIN(wait, CONFIG_ESS_CONN_SLOW_DELAY_MS - idle);
+		}
+	}
+
+	k_mutex_unlock(&conn_policy_mutex);
+
+	/* Woken for the connection which becomes idle first */
+	if (wait != INT64_MAX) {
+		k_timer_start(&conn_policy_timer, K_MSEC(wait), K_NO_WAIT);
+	}
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void conn_policy_init(void)
+{
+	bt_conn_cb_register(&conn_policy_callbacks);
+}
+
+void conn_policy_bulk_begin(struct bt_conn *conn)
+{
+	struct conn_policy_state *state;
+
+	k_mutex_lock(&conn_policy_mutex, K_FOREVER);
+
+	state = find_state(conn);
+	if (state != NULL) {
+		++state->bulk_users;
+	}
+
+	k_mutex_unlock(&conn_policy_mutex);
+
+	k_work_submit(&conn_policy_work);
+}
+
+void conn_policy_bulk_end(struct bt_conn *conn)
+{
+	struct conn_policy_state *state;
+
+	k_mutex_lock(&conn_policy_mutex, K_FOREVER);
+
+	state = find_state(conn);
+	if (state != NULL && state->bulk_users > 0) {
+		--state->bulk_users;
+		state->last_bulk = k_uptime_get();
+	}
+
+	k_mutex_unlock(&conn_policy_mutex);
+
+	k_work_submit(&conn_policy_work);
+}
+
+void conn_policy_update(void)
+{
+	k_work_submit(&conn_policy_work);
+}
+
+int conn_policy_get_params(struct bt_conn *conn,
+			   struct conn_policy_params *params)
+{
+	struct conn_policy_state *state;
+	int rc = -ENOTCONN;
+
+	k_mutex_lock(&conn_policy_mutex, K_FOREVER);
+
+	state = find_state(conn);
+	if (state != NULL) {
+		*params = state->params;
+		rc = 0;
+	}
+
+	k_mutex_unlock(&conn_policy_mutex);
+
+	return rc;
+}
@@ -0,0 +1,511 @@
+/**
+ * @file derived.c
+ * @brief Metrics derived from the sensor readings, such as the dew point,
+ * which are calculated once per sample for all consumers
+ *
+ * Each metric is a kernel in the derived_kernels table which declares the
+ * sensor readings it needs. Terms used by several kernels, such as the
+ * Magnus gamma, are calculated on first use and shared by the rest.
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <string.h>
+
+#include "derived.h"
+#include "sample.h"
+#include "dewpoint.h"
+#include "fixed_math.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define DERIVED_INPUT_TEMPERATURE BIT(0)
+#define DERIVED_INPUT_HUMIDITY BIT(1)
+#define DERIVED_INPUT_PRESSURE BIT(2)
+#define DERIVED_INPUT_GAS BIT(3)
+
+#define DERIVED_TERM_GAMMA BIT(0)
+#define DERIVED_TERM_VAPOUR_PRESSURE BIT(1)
+
+/* Saturation vapour pressure at 0 C is 611.2 Pa, which is folded into the
+ * exponent to keep the Q16.16 resolution at low humidities
+ */
+#define LN_611_2_Q16 420441
+#define DECI_MULTIPLIER 10
+
+/* Absolute humidity = e / (Rv * T), 216679 is 100000 / Rv scaled for e in
+ * 0.1 Pa and T in 0.01 K to give 0.01 g/m3
+ */
+#define ABSOLUTE_HUMIDITY_FACTOR 216679
+#define ABSOLUTE_HUMIDITY_DIVIDER 100
+#define KELVIN_OFFSET_X100 27315
+
+/* Rothfusz regression with celsius coefficients for temperature and
+ * humidity in 0.1 units, scaled by HEAT_INDEX_SCALE to give 0.01 C
+ */
+#define HEAT_INDEX_C1 -8784694755560LL
+#define HEAT_INDEX_C2 161139411000LL
+#define HEAT_INDEX_C3 233854883889LL
+#define HEAT_INDEX_C4 -1461160500LL
+#define HEAT_INDEX_C5 -123080940LL
+#define HEAT_INDEX_C6 -164248278LL
+#define HEAT_INDEX_C7 2211732LL
+#define HEAT_INDEX_C8 725460LL
+#define HEAT_INDEX_C9 -358LL
+#define HEAT_INDEX_SCALE 10000000000LL
+/* Simple NWS formula, 1.1 * T - 3.944 + 0.0261 * RH, scaled by 1000000 */
+#define HEAT_INDEX_SIMPLE_T 1100000LL
+#define HEAT_INDEX_SIMPLE_RH 26111LL
+#define HEAT_INDEX_SIMPLE_OFFSET -394444444LL
+#define HEAT_INDEX_SIMPLE_SCALE 1000000LL
+/* The regression is used when the simple formula averaged with the
+ * temperature is at least 80 F, which is compared as the sum of the two
+ */
+#define HEAT_INDEX_REGRESSION_MIN 5333
+
+/* Altitude = 44330.8 * (1 - (P / P0) ^ 0.190263) */
+#define ALTITUDE_SCALE_X100 4433080LL
+#define ALTITUDE_EXPONENT_Q16 12469
+#define SEA_LEVEL_PRESSURE                                                     \
+	(CONFIG_ESS_DERIVED_SEA_LEVEL_PRESSURE_PA * DECI_MULTIPLIER)
+
+#define TREND_SLOT_MS                                                          \
+	(CONFIG_ESS_DERIVED_TREND_WINDOW_MIN * SEC_PER_MIN * MSEC_PER_SEC /   \
+	 DERIVED_TREND_SLOTS)
+#define TREND_HOUR_MS (60 * SEC_PER_MIN * MSEC_PER_SEC)
+
+/* The gas score is out of 7500 and the humidity score out of 2500, giving
+ * an air quality out of 10000 which is scaled to an index from 0 to 500
+ */
+#define IAQ_GAS_WEIGHT 7500
+#define IAQ_HUMIDITY_WEIGHT 2500
+#define IAQ_HUMIDITY_IDEAL 4000
+#define IAQ_HUMIDITY_MAX 10000
+#define IAQ_QUALITY_MAX (IAQ_GAS_WEIGHT + IAQ_HUMIDITY_WEIGHT)
+#define IAQ_QUALITY_DIVIDER 20
+/* After the burn in the baseline follows lower readings by 1/4096 of the
+ * difference per gas measurement, so it adapts to a new room over several
+ * hours
+ */
+#define IAQ_BASELINE_SHIFT 12
+
+/* Intermediate terms of the sample being evaluated */
+struct derived_terms {
+	const struct ess_sample *sample;
+	/* DERIVED_TERM_ values which have been calculated */
+	uint32_t valid;
+	/* Magnus gamma in Q16.16 */
+	int32_t gamma;
+	/* Water vapour pressure in pascals (Pa) in 0.1 units */
+	uint32_t vapour_pressure;
+};
+
+struct derived_kernel {
+	const char *name;
+	/* DERIVED_INPUT_ values the metric is calculated from */
+	uint32_t inputs;
+	/* Calculates the value, returns -EAGAIN if the history is not long
+	 * enough yet
+	 */
+	int (*evaluate)(struct derived_terms *terms,
+			const struct derived_state *state, int32_t *value);
+	/* Optional, updates the history of a stateful metric */
+	void (*track)(struct derived_state *state,
+		      const struct ess_sample *sample);
+};
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static int32_t term_gamma(struct derived_terms *terms);
+static uint32_t term_vapour_pressure(struct derived_terms *terms);
+static uint32_t sample_inputs(const struct ess_sample *sample);
+static int evaluate_dew_point(struct derived_terms *terms,
+			      const struct derived_state *state,
+			      int32_t *value);
+static int evaluate_absolute_humidity(struct derived_terms *terms,
+				      const struct derived_state *state,
+				      int32_t *value);
+static int evaluate_heat_index(struct derived_terms *terms,
+			       const struct derived_state *state,
+			       int32_t *value);
+static int evaluate_altitude(struct derived_terms *terms,
+			     const struct derived_state *state,
+			     int32_t *value);
+static int evaluate_pressure_trend(struct derived_terms *terms,
+				   const struct derived_state *state,
+				   int32_t *value);
+static void track_pressure_trend(struct derived_state *state,
+				 const struct ess_sample *sample);
+static int evaluate_iaq(struct derived_terms *terms,
+			const struct derived_state *state, int32_t *value);
+static void track_iaq(struct derived_state *state,
+		      const struct ess_sample *sample);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static const struct derived_kernel derived_kernels[] = {
+	[DERIVED_METRIC_DEW_POINT] = {
+		.name = "dew point",
+		.inputs = DERIVED_INPUT_TEMPERATURE | DERIVED_INPUT_HUMIDITY,
+		.evaluate = evaluate_dew_point,
+	},
+	[DERIVED_METRIC_ABSOLUTE_HUMIDITY] = {
+		.name = "absolute humidity",
+		.inputs = DERIVED_INPUT_TEMPERATURE | DERIVED_INPUT_HUMIDITY,
+		.evaluate = evaluate_absolute_humidity,
+	},
+	[DERIVED_METRIC_HEAT_INDEX] = {
+		.name = "heat index",
+		.inputs = DERIVED_INPUT_TEMPERATURE | DERIVED_INPUT_HUMIDITY,
+		.evaluate = evaluate_heat_index,
+	},
+	[DERIVED_METRIC_ALTITUDE] = {
+		.name = "altitude",
+		.inputs = DERIVED_INPUT_PRESSURE,
+		.evaluate = evaluate_altitude,
+	},
+	[DERIVED_METRIC_PRESSURE_TREND] = {
+		.name = "pressure trend",
+		.inputs = DERIVED_INPUT_PRESSURE,
+		.evaluate = evaluate_pressure_trend,
+		.track = track_pressure_trend,
+	},
+	[DERIVED_METRIC_IAQ] = {
+		.name = "iaq",
+		.inputs = DERIVED_INPUT_HUMIDITY | DERIVED_INPUT_GAS,
+		.evaluate = evaluate_iaq,
+		.track = track_iaq,
+	},
+};
+BUILD_ASSERT(ARRAY_SIZE(derived_kernels) == DERIVED_METRIC_COUNT);
+
+/* Number of consumers demanding each metric */
+static atomic_t derived_demand_counts[DERIVED_METRIC_COUNT];
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static int32_t term_gamma(struct derived_terms *terms)
+{
+	const struct ess_sample *sample = terms->sample;
+
+	if ((terms->valid & DERIVED_TERM_GAMMA) == 0) {
+		terms->gamma = calculate_magnus_gamma(sample->temperature,
+						      sample->humidity);
+		terms->valid |= DERIVED_TERM_GAMMA;
+	}
+
+	return terms->gamma;
+}
+
+static uint32_t term_vapour_pressure(struct derived_terms *terms)
+{
+	uint32_t pressure_q16;
+
+	if ((terms->valid & DERIVED_TERM_VAPOUR_PRESSURE) == 0) {
+		/* e = 611.2 Pa * exp(gamma) */
+		pressure_q16 = fixed_exp_q16(term_gamma(terms) + LN_611_2_Q16);
+		terms->vapour_pressure =
+			(uint32_t)(((uint64_t)pressure_q16 * DECI_MULTIPLIER) >>
+				   16);
+		terms->valid |= DERIVED_TERM_VAPOUR_PRESSURE;
+	}
+
+	return terms->vapour_pressure;
+}
+
+static uint32_t sample_inputs(const struct ess_sample *sample)
+{
+	uint32_t inputs = DERIVED_INPUT_TEMPERATURE | DERIVED_INPUT_HUMIDITY |
+			  DERIVED_INPUT_PRESSURE;
+
+	if (sample->gas_resistance != 0) {
+		inputs |= DERIVED_INPUT_GAS;
+	}
+
+	return inputs;
+}
+
+static int evaluate_dew_point(struct derived_terms *terms,
+			      const struct derived_state *state,
+			      int32_t *value)
+{
+	*value = calculate_dew_point_gamma(term_gamma(terms));
+
+	return 0;
+}
+
+static int evaluate_absolute_humidity(struct derived_terms *terms,
+				      const struct derived_state *state,
+				      int32_t *value)
+{
+	uint32_t kelvin = KELVIN_OFFSET_X100 + terms->sample->temperature;
+
+	*value = (int32_t)(((uint64_t)term_vapour_pressure(terms) *
+			    ABSOLUTE_HUMIDITY_FACTOR) /
+			   (kelvin * ABSOLUTE_HUMIDITY_DIVIDER));
+
+	return 0;
+}
+
+static int evaluate_heat_index(struct derived_terms *terms,
+			       const struct derived_state *state,
+			       int32_t *value)
+{
+	int64_t t = terms->sample->temperature;
+	int64_t r = terms->sample->humidity;
+	int64_t index;
+
+	index = (HEAT_INDEX_SIMPLE_T * t + HEAT_INDEX_SIMPLE_RH * r +
+		 HEAT_INDEX_SIMPLE_OFFSET) /
+		HEAT_INDEX_SIMPLE_SCALE;
+
+	if (index + t >= HEAT_INDEX_REGRESSION_MIN) {
+		/* The regression terms are small enough for 64 bits with the
+		 * readings in 0.1 units, the NWS adjustments for very low and
+		 * very high humidity are not applied
+		 */
+		t /= DECI_MULTIPLIER;
+		r /= DECI_MULTIPLIER;
+		index = HEAT_INDEX_C1 + HEAT_INDEX_C2 * t + HEAT_INDEX_C3 * r +
+			HEAT_INDEX_C4 * t * r + HEAT_INDEX_C5 * t * t +
+			HEAT_INDEX_C6 * r * r + HEAT_INDEX_C7 * t * t * r +
+			HEAT_INDEX_C8 * t * r * r +
+			HEAT_INDEX_C9 * t * t * r * r;
+		index /= HEAT_INDEX_SCALE;
+	}
+
+	*value = (int32_t)index;
+
+	return 0;
+}
+
+static int evaluate_altitude(struct derived_terms *terms,
+			     const struct derived_state *state,
+			     int32_t *value)
+{
+	int32_t ratio_ln;
+	uint32_t ratio;
+
+	if (terms->sample->pressure == 0) {
+		return -EDOM;
+	}
+
+	/* (P / P0) ^ 0.190263 = exp(0.190263 * (ln(P) - ln(P0))) */
+	ratio_ln = fixed_ln_q16(terms->sample->pressure) -
+		   fixed_ln_q16(SEA_LEVEL_PRESSURE);
+	ratio = fixed_exp_q16(
+		(int32_t)(((int64_t)ratio_ln * ALTITUDE_EXPONENT_Q16) >> 16));
+
+	*value = (int32_t)((ALTITUDE_SCALE_X100 *
+			    ((int64_t)FIXED_Q16_ONE - ratio)) >>
+			   16);
+
+	return 0;
+}
+
+static int evaluate_pressure_trend(struct derived_terms *terms,
+				   const struct derived_state *state,
+				   int32_t *value)
+{
+	size_t oldest;
+	int64_t span;
+
+	if (state->trend_count == 0) {
+		return -EAGAIN;
+	}
+
+	oldest = (state->trend_head + DERIVED_TREND_SLOTS -
+		  state->trend_count) %
+		 DERIVED_TREND_SLOTS;
+	span = terms->sample->timestamp - state->trend_timestamp[oldest];
+	if (span < TREND_SLOT_MS) {
+		return -EAGAIN;
+	}
+
+	*value = (int32_t)((((int64_t)terms->sample->pressure -
+			     state->trend_pressure[oldest]) *
+			    TREND_HOUR_MS) /
+			   span);
+
+	return 0;
+}
+
+static void track_pressure_trend(struct derived_state *state,
+				 const struct ess_sample *sample)
+{
+	size_t newest;
+
+	if (state->trend_count > 0) {
+		newest = (state->trend_head + DERIVED_TREND_SLOTS - 1) %
+			 DERIVED_TREND_SLOTS;
+		if (sample->timestamp - state->trend_timestamp[newest] <
+		    TREND_SLOT_MS) {
+			return;
+		}
+	}
+
+	state->trend_timestamp[state->trend_head] = sample->timestamp;
+	state->trend_pressure[state->trend_head] = sample->pressure;
+	state->trend_head = (state->trend_head + 1) % DERIVED_TREND_SLOTS;
+	state->trend_count = MIN(state->trend_count + 1, DERIVED_TREND_SLOTS);
+}
+
+static int evaluate_iaq(struct derived_terms *terms,
+			const struct derived_state *state, int32_t *value)
+{
+	uint32_t humidity = MIN(terms->sample->humidity, IAQ_HUMIDITY_MAX);
+	uint32_t humidity_score;
+	uint32_t gas_score;
+
+	if (state->gas_samples < CONFIG_ESS_DERIVED_IAQ_BURN_IN_SAMPLES) {
+		return -EAGAIN;
+	}
+
+	/* The humidity score is highest at the ideal humidity and falls
+	 * linearly to 0 at 0 % and 100 %
+	 */
+	if (humidity > IAQ_HUMIDITY_IDEAL) {
+		humidity_score = (IAQ_HUMIDITY_MAX - humidity) *
+				 IAQ_HUMIDITY_WEIGHT /
+				 (IAQ_HUMIDITY_MAX - IAQ_HUMIDITY_IDEAL);
+	} else {
+		humidity_score =
+			humidity * IAQ_HUMIDITY_WEIGHT / IAQ_HUMIDITY_IDEAL;
+	}
+
+	/* Volatile organic compounds lower the gas resistance below that of
+	 * clean air
+	 */
+	gas_score = (uint32_t)MIN(((uint64_t)terms->sample->gas_resistance *
+				   IAQ_GAS_WEIGHT) /
+					  state->gas_baseline,
+				  IAQ_GAS_WEIGHT);
+
+	*value = (int32_t)((IAQ_QUALITY_MAX - humidity_score - gas_score) /
+			   IAQ_QUALITY_DIVIDER);
+
+	return 0;
+}
+
+static void track_iaq(struct derived_state *state,
+		      const struct ess_sample *sample)
+{
+	uint32_t gas = sample->gas_resistance;
+
+	/* Each measurement is tracked once however many samples carry it,
+	 * so the burn in and baseline follow the gas measurement rate
+	 */
+	if (gas == 0 || sample->gas_sequence == state->gas_sequence) {
+		return;
+	}
+	state->gas_sequence = sample->gas_sequence;
+
+	/* The resistance rises whilst the heater burns in, so the baseline is
+	 * the highest reading until then and afterwards slowly follows lower
+	 * readings so that it adapts to the room
+	 */
+	if (gas > state->gas_baseline) {
+		state->gas_baseline = gas;
+	} else if (state->gas_samples >=
+		   CONFIG_ESS_DERIVED_IAQ_BURN_IN_SAMPLES) {
+		state->gas_baseline -=
+			(state->gas_baseline - gas) >> IAQ_BASELINE_SHIFT;
+	}
+
+	if (state->gas_samples < CONFIG_ESS_DERIVED_IAQ_BURN_IN_SAMPLES) {
+		++state->gas_samples;
+	}
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void derived_state_init(struct derived_state *state)
+{
+	memset(state, 0, sizeof(*state));
+}
+
+uint32_t derived_evaluate(struct derived_state *state, uint32_t metrics,
+			  struct ess_sample *sample)
+{
+	struct derived_terms terms = {
+		.sample = sample,
+	};
+	uint32_t inputs = sample_inputs(sample);
+	const struct derived_kernel *kernel;
+	uint32_t valid = 0;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(derived_kernels); ++i) {
+		kernel = &derived_kernels[i];
+		sample->derived[i] = 0;
+
+		if ((kernel->inputs & inputs) != kernel->inputs) {
+			continue;
+		}
+
+		if (kernel->track != NULL) {
+			kernel->track(state, sample);
+		}
+
+		if ((metrics & BIT(i)) != 0 &&
+		    kernel->evaluate(&terms, state, &sample->derived[i]) == 0) {
+			valid |= BIT(i);
+		}
+	}
+
+	sample->derived_valid = valid;
+
+	return valid;
+}
+
+void derived_demand(uint32_t metrics)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(derived_demand_counts); ++i) {
+		if ((metrics & BIT(i)) != 0) {
+			atomic_inc(&derived_demand_counts[i]);
+		}
+	}
+}
+
+void derived_release(uint32_t metrics)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(derived_demand_counts); ++i) {
+		if ((metrics & BIT(i)) != 0) {
+			atomic_dec(&derived_demand_counts[i]);
+		}
+	}
+}
+
+uint32_t derived_get_demand(void)
+{
+	uint32_t metrics = 0;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(derived_demand_counts); ++i) {
+		if (atomic_get(&derived_demand_counts[i]) > 0) {
+			metrics |= BIT(i);
+		}
+	}
+
+	return metrics;
+}
+
+const char *derived_metric_name(enum derived_metric metric)
+{
+	return derived_kernels[metric].name;
+}
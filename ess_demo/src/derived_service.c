@@ -0,0 +1,292 @@
+/**
+ * @file derived_service.c
+ * @brief Vendor specific service notifying the derived metrics selected by
+ * each connection
+ *
+ * Each connection selects the metrics it wants by writing a bit mask of
+ * enum derived_metric values, all metrics are selected on connection. The
+ * metrics selected by subscribed connections are demanded from the derived
+ * metrics engine, so metrics nobody is subscribed to are not calculated.
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <logging/log.h>
+#include <sys/byteorder.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/uuid.h>
+#include <bluetooth/gatt.h>
+
+#include "derived_service.h"
+#include "derived.h"
+#include "acquisition.h"
+
+LOG_MODULE_REGISTER(derived_service);
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define ATT_NOTIFY_HEADER_SIZE 3
+
+/* Bit mask of the included metrics followed by their int32 values */
+#define METRICS_HEADER_SIZE sizeof(uint32_t)
+#define METRICS_MAX_SIZE                                                       \
+	(METRICS_HEADER_SIZE + DERIVED_METRIC_COUNT * sizeof(int32_t))
+
+struct derived_connection {
+	struct bt_conn *conn;
+	/* Metrics selected by the central */
+	uint32_t selection;
+	/* Metrics this connection currently demands from the engine */
+	uint32_t demanded;
+};
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static ssize_t read_metrics(struct bt_conn *conn,
+			    const struct bt_gatt_attr *attr, void *buf,
+			    uint16_t len, uint16_t offset);
+static ssize_t write_metrics(struct bt_conn *conn,
+			     const struct bt_gatt_attr *attr, const void *buf,
+			     uint16_t len, uint16_t offset, uint8_t flags);
+static void ccc_changed(const struct bt_gatt_attr *attr, uint16_t value);
+static struct derived_connection *find_connection(struct bt_conn *conn);
+static void update_demand(struct bt_conn *conn, void *data);
+static size_t encode_metrics(uint8_t *data, size_t size, uint32_t selection,
+			     const struct ess_sample *sample);
+static void connected(struct bt_conn *conn, uint8_t err);
+static void disconnected(struct bt_conn *conn, uint8_t reason);
+static void notify_connection(struct bt_conn *conn, void *data);
+static void derived_notify_handler(struct k_work *work);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+K_WORK_DEFINE(derived_notify_work, derived_notify_handler);
+
+static struct sample_ring_reader derived_reader;
+static struct acquisition_consumer derived_consumer = {
+	.work = &derived_notify_work,
+};
+
+/* Newest sample, only written from the system workqueue */
+static struct ess_sample derived_sample;
+
+static const struct bt_gatt_attr *metrics_attr;
+
+static struct derived_connection derived_connections[CONFIG_BT_MAX_CONN];
+
+static struct bt_conn_cb derived_conn_callbacks = {
+	.connected = connected,
+	.disconnected = disconnected,
+};
+
+BT_GATT_SERVICE_DEFINE(
+	derived_svc, BT_GATT_PRIMARY_SERVICE(BT_UUID_DERIVED_SERVICE),
+	BT_GATT_CHARACTERISTIC(BT_UUID_DERIVED_METRICS,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE |
+				       BT_GATT_CHRC_NOTIFY,
+			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+			       read_metrics, write_metrics, NULL),
+	BT_GATT_CCC(ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE), );
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static ssize_t read_metrics(struct bt_conn *conn,
+			    const struct bt_gatt_attr *attr, void *buf,
+			    uint16_t len, uint16_t offset)
+{
+	struct derived_connection *connection = find_connection(conn);
+	uint8_t value[METRICS_MAX_SIZE];
+	size_t size;
+
+	if (connection == NULL) {
+		return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+	}
+
+	/* Metrics are only calculated whilst a connection is subscribed to
+	 * them, others are left out of the mask
+	 */
+	size = encode_metrics(value, sizeof(value), connection->selection,
+			      &derived_sample);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, value, size);
+}
+
+static ssize_t write_metrics(struct bt_conn *conn,
+			     const struct bt_gatt_attr *attr, const void *buf,
+			     uint16_t len, uint16_t offset, uint8_t flags)
+{
+	struct derived_connection *connection = find_connection(conn);
+	uint32_t selection;
+
+	if (offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	} else if (len != sizeof(uint32_t)) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	} else if (connection == NULL) {
+		return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+	}
+
+	selection = sys_get_le32(buf);
+	if ((selection & ~DERIVED_METRICS_ALL) != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+
+	connection->selection = selection;
+	update_demand(conn, NULL);
+
+	LOG_DBG("Connection %u selected metrics 0x%02x", bt_conn_index(conn),
+		selection);
+
+	return len;
+}
+
+static void ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	/* The callback does not say which connection changed it */
+	bt_conn_foreach(BT_CONN_TYPE_LE, update_demand, NULL);
+}
+
+static struct derived_connection *find_connection(struct bt_conn *conn)
+{
+	struct derived_connection *connection;
+
+	if (conn == NULL) {
+		return NULL;
+	}
+
+	connection = &derived_connections[bt_conn_index(conn)];
+
+	return (connection->conn == conn ? connection : NULL);
+}
+
+static void update_demand(struct bt_conn *conn, void *data)
+{
+	struct derived_connection *connection = find_connection(conn);
+	uint32_t wanted = 0;
+
+	if (connection == NULL) {
+		return;
+	}
+
+	if (bt_gatt_is_subscribed(conn, metrics_attr, BT_GATT_CCC_NOTIFY)) {
+		wanted = connection->selection;
+	}
+
+	derived_demand(wanted & ~connection->demanded);
+	derived_release(connection->demanded & ~wanted);
+	connection->demanded = wanted;
+}
+
+static size_t encode_metrics(uint8_t *data, size_t size, uint32_t selection,
+			     const struct ess_sample *sample)
+{
+	uint32_t included = 0;
+	size_t length = METRICS_HEADER_SIZE;
+	size_t i;
+
+	/* Metrics which do not fit in the ATT MTU are left out */
+	for (i = 0; i < DERIVED_METRIC_COUNT; ++i) {
+		if ((selection & sample->derived_valid & BIT(i)) == 0) {
+			continue;
+		} else if (length + sizeof(int32_t) > size) {
+			break;
+		}
+
+		sys_put_le32((uint32_t)sample->derived[i], &data[length]);
+		length += sizeof(int32_t);
+		included |= BIT(i);
+	}
+
+	sys_put_le32(included, data);
+
+	return length;
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	struct derived_connection *connection;
+
+	if (err) {
+		return;
+	}
+
+	connection = &derived_connections[bt_conn_index(conn)];
+	connection->conn = conn;
+	connection->selection = DERIVED_METRICS_ALL;
+	connection->demanded = 0;
+
+	/* Bonded centrals may already be subscribed */
+	update_demand(conn, NULL);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	struct derived_connection *connection = find_connection(conn);
+
+	if (connection != NULL) {
+		derived_release(connection->demanded);
+		connection->demanded = 0;
+		connection->conn = NULL;
+	}
+}
+
+static void notify_connection(struct bt_conn *conn, void *data)
+{
+	struct derived_connection *connection = find_connection(conn);
+	uint8_t value[METRICS_MAX_SIZE];
+	size_t size;
+	int rc;
+
+	if (connection == NULL || connection->demanded == 0) {
+		return;
+	}
+
+	size = MIN(sizeof(value),
+		   (size_t)(bt_gatt_get_mtu(conn) - ATT_NOTIFY_HEADER_SIZE));
+	size = encode_metrics(value, size, connection->demanded,
+			      &derived_sample);
+
+	rc = bt_gatt_notify(conn, metrics_attr, value, size);
+	if (rc != 0) {
+		LOG_DBG("Derived metrics notification failed (err %d)", rc);
+	}
+}
+
+static void derived_notify_handler(struct k_work *work)
+{
+	bool updated = false;
+
+	while (sample_ring_read(&derived_reader, &derived_sample) == 0) {
+		updated = true;
+	}
+
+	if (updated) {
+		bt_conn_foreach(BT_CONN_TYPE_LE, notify_connection, NULL);
+	}
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void derived_service_init(void)
+{
+	metrics_attr = bt_gatt_find_by_uuid(derived_svc.attrs,
+					    derived_svc.attr_count,
+					    BT_UUID_DERIVED_METRICS);
+
+	bt_conn_cb_register(&derived_conn_callbacks);
+
+	sample_ring_reader_init(&derived_reader);
+	acquisition_register_consumer(&derived_consumer);
+}
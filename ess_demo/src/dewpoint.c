@@ -8,18 +8,60 @@
 /******************************************************************************/
 /* Includes                                                                   */
 /******************************************************************************/
-#include <math.h>
 #include "dewpoint.h"
-#include "sensor.h"
+#include "fixed_math.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+/* Fixed point values are Q16.16 */
+#define MAGNUS_B_Q16 1154744 /* 17.62 */
+#define MAGNUS_B_X100 1762
+#define MAGNUS_C_X100 24312
+#define LN_10000_Q16 603609 /* Humidity is in 0.01 % units */
+#define HUMIDITY_MIN 1
+#define HUMIDITY_MAX 10000
+#define CENTI_MULTIPLIER 100
 
 /******************************************************************************/
 /* Global Function Definitions                                                */
 /******************************************************************************/
-int8_t calculate_dew_point(float fTemp, float fHum)
+int32_t calculate_magnus_gamma(int16_t temperature, uint16_t humidity)
 {
-	float hTmp =
-		(log10(fHum) - 2) / 0.4343 + (17.62 * fTemp) / (243.12 + fTemp);
-	hTmp = 243.12 * hTmp / (17.62 - hTmp);
+	int32_t gamma;
+
+	humidity = CLAMP(humidity, HUMIDITY_MIN, HUMIDITY_MAX);
+
+	/* gamma = ln(RH) + (b * T) / (c + T), the 0.01 scaling of the
+	 * temperature cancels out in the second term
+	 */
+	gamma = fixed_ln_q16(humidity) - LN_10000_Q16;
+	gamma += (int32_t)(((int64_t)MAGNUS_B_X100 * temperature *
+			    FIXED_Q16_ONE) /
+			   ((MAGNUS_C_X100 + temperature) * CENTI_MULTIPLIER));
+
+	return gamma;
+}
 
-	return (int8_t)hTmp;
+int16_t calculate_dew_point_gamma(int32_t gamma)
+{
+	int64_t numerator;
+	int32_t denominator;
+
+	/* Dew point = (c * gamma) / (b - gamma), rounded to nearest */
+	numerator = (int64_t)MAGNUS_C_X100 * gamma;
+	denominator = MAGNUS_B_Q16 - gamma;
+	if (numerator < 0) {
+		numerator -= denominator / 2;
+	} else {
+		numerator += denominator / 2;
+	}
+
+	return (int16_t)(numerator / denominator);
+}
+
+int16_t calculate_dew_point_fixed(int16_t temperature, uint16_t humidity)
+{
+	return calculate_dew_point_gamma(
+		calculate_magnus_gamma(temperature, humidity));
 }
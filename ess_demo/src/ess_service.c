@@ -0,0 +1,711 @@
+/**
+ * @file ess_service.c
+ * @brief Environmental Sensing Service with batched notifications
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <string.h>
+#include <logging/log.h>
+#include <sys/byteorder.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/uuid.h>
+#include <bluetooth/gatt.h>
+
+#include "ess_service.h"
+#include "ess_trigger.h"
+#include "sample_scheduler.h"
+#include "conn_policy.h"
+#include "derived.h"
+#include "filter.h"
+
+LOG_MODULE_REGISTER(ess_service);
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define DEW_POINT_DIVIDER 100
+
+/* Application specific ATT errors from the ESS specification */
+#define ESS_ERR_CONDITION_NOT_SUPPORTED 0x81
+
+/* Interval, latency, timeout, profile, number of updates */
+#define CONN_PARAMS_SIZE 9
+
+/* Median window, moving average shift and rate limit of a channel, writes
+ * are prefixed with the enum filter_channel value
+ */
+#define FILTER_CONFIG_SIZE 6
+#define FILTER_CONFIG_WRITE_SIZE (1 + FILTER_CONFIG_SIZE)
+
+/* ES Measurement descriptor values */
+#define ES_MEASUREMENT_SAMPLING_INSTANTANEOUS 0x01
+#define ES_MEASUREMENT_APPLICATION_AIR 0x01
+#define ES_MEASUREMENT_UNCERTAINTY_UNKNOWN 0xff
+
+struct ess_packed_measurement {
+	int16_t temperature;
+	uint16_t humidity;
+	uint32_t pressure;
+	int8_t dew_point;
+} __packed;
+
+struct es_measurement {
+	uint16_t flags;
+	uint8_t sampling_function;
+	uint8_t measurement_period[3];
+	uint8_t update_interval[3];
+	uint8_t application;
+	uint8_t uncertainty;
+} __packed;
+
+struct ess_characteristic {
+	const struct bt_uuid *uuid;
+	const void *value;
+	uint8_t size;
+	bool is_signed;
+	const struct bt_gatt_attr *attr;
+	/* Current value in the units of the characteristic */
+	int32_t current;
+};
+
+enum ess_characteristic_index {
+	ESS_CHARACTERISTIC_TEMPERATURE = 0,
+	ESS_CHARACTERISTIC_HUMIDITY,
+	ESS_CHARACTERISTIC_PRESSURE,
+	ESS_CHARACTERISTIC_DEW_POINT,
+#ifdef CONFIG_ESS_SENSOR_GAS
+	ESS_CHARACTERISTIC_GAS_RESISTANCE,
+#endif
+
+	ESS_CHARACTERISTIC_COUNT
+};
+
+/* Trigger settings are held per connection, so that each central receives
+ * updates at its own interval from the same samples
+ */
+struct ess_connection {
+	struct bt_conn *conn;
+	struct ess_trigger triggers[ESS_CHARACTERISTIC_COUNT];
+	struct ess_trigger_state states[ESS_CHARACTERISTIC_COUNT];
+};
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static ssize_t read_value(struct bt_conn *conn,
+			  const struct bt_gatt_attr *attr, void *buf,
+			  uint16_t len, uint16_t offset);
+static ssize_t read_packed(struct bt_conn *conn,
+			   const struct bt_gatt_attr *attr, void *buf,
+			   uint16_t len, uint16_t offset);
+static ssize_t read_es_measurement(struct bt_conn *conn,
+				   const struct bt_gatt_attr *attr, void *buf,
+				   uint16_t len, uint16_t offset);
+static ssize_t read_trigger(struct bt_conn *conn,
+			    const struct bt_gatt_attr *attr, void *buf,
+			    uint16_t len, uint16_t offset);
+static ssize_t write_trigger(struct bt_conn *conn,
+			     const struct bt_gatt_attr *attr, const void *buf,
+			     uint16_t len, uint16_t offset, uint8_t flags);
+static ssize_t read_sample_period(struct bt_conn *conn,
+				  const struct bt_gatt_attr *attr, void *buf,
+				  uint16_t len, uint16_t offset);
+static ssize_t write_sample_period(struct bt_conn *conn,
+				   const struct bt_gatt_attr *attr,
+				   const void *buf, uint16_t len,
+				   uint16_t offset, uint8_t flags);
+static ssize_t read_conn_params(struct bt_conn *conn,
+				const struct bt_gatt_attr *attr, void *buf,
+				uint16_t len, uint16_t offset);
+#ifdef CONFIG_ESS_FILTER
+static ssize_t read_filter_config(struct bt_conn *conn,
+				  const struct bt_gatt_attr *attr, void *buf,
+				  uint16_t len, uint16_t offset);
+static ssize_t write_filter_config(struct bt_conn *conn,
+				   const struct bt_gatt_attr *attr,
+				   const void *buf, uint16_t len,
+				   uint16_t offset, uint8_t flags);
+#endif
+static void ccc_changed(const struct bt_gatt_attr *attr, uint16_t value);
+static struct ess_connection *find_connection(struct bt_conn *conn);
+static size_t characteristic_index(const struct bt_gatt_attr *attr);
+static void connected(struct bt_conn *conn, uint8_t err);
+static void disconnected(struct bt_conn *conn, uint8_t reason);
+static void count_subscriber(struct bt_conn *conn, void *data);
+static void notify_connection(struct bt_conn *conn, void *data);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static int16_t temperature_value;
+static uint16_t humidity_value;
+static uint32_t pressure_value;
+static int8_t dew_point_value;
+#ifdef CONFIG_ESS_SENSOR_GAS
+static uint32_t gas_resistance_value;
+#endif
+static struct ess_packed_measurement packed_value;
+static struct es_measurement es_measurement_value = {
+	.sampling_function = ES_MEASUREMENT_SAMPLING_INSTANTANEOUS,
+	.application = ES_MEASUREMENT_APPLICATION_AIR,
+	.uncertainty = ES_MEASUREMENT_UNCERTAINTY_UNKNOWN,
+};
+
+static struct ess_characteristic ess_characteristics[] = {
+	[ESS_CHARACTERISTIC_TEMPERATURE] = {
+		.uuid = BT_UUID_TEMPERATURE,
+		.value = &temperature_value,
+		.size = sizeof(temperature_value),
+		.is_signed = true,
+	},
+	[ESS_CHARACTERISTIC_HUMIDITY] = {
+		.uuid = BT_UUID_HUMIDITY,
+		.value = &humidity_value,
+		.size = sizeof(humidity_value),
+		.is_signed = false,
+	},
+	[ESS_CHARACTERISTIC_PRESSURE] = {
+		.uuid = BT_UUID_PRESSURE,
+		.value = &pressure_value,
+		.size = sizeof(pressure_value),
+		.is_signed = false,
+	},
+	[ESS_CHARACTERISTIC_DEW_POINT] = {
+		.uuid = BT_UUID_DEW_POINT,
+		.value = &dew_point_value,
+		.size = sizeof(dew_point_value),
+		.is_signed = true,
+	},
+#ifdef CONFIG_ESS_SENSOR_GAS
+	[ESS_CHARACTERISTIC_GAS_RESISTANCE] = {
+		.uuid = BT_UUID_ESS_GAS_RESISTANCE,
+		.value = &gas_resistance_value,
+		.size = sizeof(gas_resistance_value),
+		.is_signed = false,
+	},
+#endif
+};
+BUILD_ASSERT(ARRAY_SIZE(ess_characteristics) == ESS_CHARACTERISTIC_COUNT);
+
+static const struct bt_gatt_attr *packed_attr;
+
+/* Changed by the connection callbacks and trigger writes on the Bluetooth
+ * thread whilst the system workqueue evaluates the triggers
+ */
+static struct ess_connection ess_connections[CONFIG_BT_MAX_CONN];
+static struct k_spinlock ess_connections_lock;
+
+static struct bt_conn_cb ess_conn_callbacks = {
+	.connected = connected,
+	.disconnected = disconnected,
+};
+
+#define ESS_CHARACTERISTIC_ATTRS(_uuid, _index)                                \
+	BT_GATT_CHARACTERISTIC(_uuid, BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY, \
+			       BT_GATT_PERM_READ, read_value, NULL,            \
+			       &ess_characteristics[_index]),                  \
+		BT_GATT_CCC(ccc_changed,                                       \
+			    BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),           \
+		BT_GATT_DESCRIPTOR(BT_UUID_ES_MEASUREMENT, BT_GATT_PERM_READ,  \
+				   read_es_measurement, NULL, NULL),           \
+		BT_GATT_DESCRIPTOR(BT_UUID_ES_TRIGGER_SETTING,                 \
+				   BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,     \
+				   read_trigger, write_trigger,                \
+				   &ess_characteristics[_index])
+
+/* Expands to nothing without a gas sensor, including the separator */
+#ifdef CONFIG_ESS_SENSOR_GAS
+#define ESS_GAS_RESISTANCE_ATTRS                                               \
+	ESS_CHARACTERISTIC_ATTRS(BT_UUID_ESS_GAS_RESISTANCE,                   \
+				 ESS_CHARACTERISTIC_GAS_RESISTANCE),
+#else
+#define ESS_GAS_RESISTANCE_ATTRS
+#endif
+
+#ifdef CONFIG_ESS_FILTER
+#define ESS_FILTER_CONFIG_ATTRS                                                \
+	BT_GATT_CHARACTERISTIC(BT_UUID_ESS_FILTER_CONFIG,                      \
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,         \
+			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,         \
+			       read_filter_config, write_filter_config, NULL),
+#else
+#define ESS_FILTER_CONFIG_ATTRS
+#endif
+
+BT_GATT_SERVICE_DEFINE(
+	ess_svc, BT_GATT_PRIMARY_SERVICE(BT_UUID_ESS),
+	ESS_CHARACTERISTIC_ATTRS(BT_UUID_TEMPERATURE,
+				 ESS_CHARACTERISTIC_TEMPERATURE),
+	ESS_CHARACTERISTIC_ATTRS(BT_UUID_HUMIDITY, ESS_CHARACTERISTIC_HUMIDITY),
+	ESS_CHARACTERISTIC_ATTRS(BT_UUID_PRESSURE, ESS_CHARACTERISTIC_PRESSURE),
+	ESS_CHARACTERISTIC_ATTRS(BT_UUID_DEW_POINT,
+				 ESS_CHARACTERISTIC_DEW_POINT),
+	ESS_GAS_RESISTANCE_ATTRS
+	BT_GATT_CHARACTERISTIC(BT_UUID_ESS_PACKED,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+			       BT_GATT_PERM_READ, read_packed, NULL,
+			       &packed_value),
+	BT_GATT_CCC(ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+	BT_GATT_CHARACTERISTIC(BT_UUID_ESS_SAMPLE_PERIOD,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+			       read_sample_period, write_sample_period, NULL),
+	ESS_FILTER_CONFIG_ATTRS
+	BT_GATT_CHARACTERISTIC(BT_UUID_ESS_CONN_PARAMS, BT_GATT_CHRC_READ,
+			       BT_GATT_PERM_READ, read_conn_params, NULL,
+			       NULL), );
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static ssize_t read_value(struct bt_conn *conn,
+			  const struct bt_gatt_attr *attr, void *buf,
+			  uint16_t len, uint16_t offset)
+{
+	const struct ess_characteristic *characteristic = attr->user_data;
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset,
+				 characteristic->value, characteristic->size);
+}
+
+static ssize_t read_packed(struct bt_conn *conn,
+			   const struct bt_gatt_attr *attr, void *buf,
+			   uint16_t len, uint16_t offset)
+{
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &packed_value,
+				 sizeof(packed_value));
+}
+
+static ssize_t read_es_measurement(struct bt_conn *conn,
+				   const struct bt_gatt_attr *attr, void *buf,
+				   uint16_t len, uint16_t offset)
+{
+	return bt_gatt_attr_read(conn, attr, buf, len, offset,
+				 &es_measurement_value,
+				 sizeof(es_measurement_value));
+}
+
+static ssize_t read_trigger(struct bt_conn *conn,
+			    const struct bt_gatt_attr *attr, void *buf,
+			    uint16_t len, uint16_t offset)
+{
+	struct ess_connection *connection;
+	struct ess_trigger trigger;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&ess_connections_lock);
+	connection = find_connection(conn);
+	if (connection != NULL) {
+		trigger = connection->triggers[characteristic_index(attr)];
+	}
+	k_spin_unlock(&ess_connections_lock, key);
+
+	if (connection == NULL) {
+		return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+	}
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, trigger.raw,
+				 trigger.raw_size);
+}
+
+static ssize_t write_trigger(struct bt_conn *conn,
+			     const struct bt_gatt_attr *attr, const void *buf,
+			     uint16_t len, uint16_t offset, uint8_t flags)
+{
+	const struct ess_characteristic *characteristic = attr->user_data;
+	struct ess_connection *connection;
+	size_t index = characteristic_index(attr);
+	struct ess_trigger trigger;
+	k_spinlock_key_t key;
+	int rc;
+
+	if (offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+
+	/* Parsed aside so that a rejected value leaves the trigger as it
+	 * was
+	 */
+	rc = ess_trigger_parse(&trigger, buf, len, characteristic->size,
+			       characteristic->is_signed);
+	if (rc == -ENOTSUP) {
+		return BT_GATT_ERR(ESS_ERR_CONDITION_NOT_SUPPORTED);
+	} else if (rc != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	key = k_spin_lock(&ess_connections_lock);
+	connection = find_connection(conn);
+	if (connection != NULL) {
+		connection->triggers[index] = trigger;
+		/* Evaluate the new trigger from scratch on the next sample */
+		connection->states[index].notified = false;
+	}
+	k_spin_unlock(&ess_connections_lock, key);
+
+	if (connection == NULL) {
+		return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+	}
+
+	LOG_DBG("Trigger %u of connection %u set to condition %d, operand %d",
+		(uint32_t)index, bt_conn_index(conn), trigger.condition,
+		trigger.operand);
+
+	return len;
+}
+
+static ssize_t read_sample_period(struct bt_conn *conn,
+				  const struct bt_gatt_attr *attr, void *buf,
+				  uint16_t len, uint16_t offset)
+{
+	uint32_t value = sys_cpu_to_le32(sample_scheduler_get_period());
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &value,
+				 sizeof(value));
+}
+
+static ssize_t write_sample_period(struct bt_conn *conn,
+				   const struct bt_gatt_attr *attr,
+				   const void *buf, uint16_t len,
+				   uint16_t offset, uint8_t flags)
+{
+	if (offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	} else if (len != sizeof(uint32_t)) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	if (sample_scheduler_set_override(sys_get_le32(buf)) != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+
+	return len;
+}
+
+static ssize_t read_conn_params(struct bt_conn *conn,
+				const struct bt_gatt_attr *attr, void *buf,
+				uint16_t len, uint16_t offset)
+{
+	struct conn_policy_params params;
+	uint8_t value[CONN_PARAMS_SIZE];
+
+	if (conn_policy_get_params(conn, &params) != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+	}
+
+	sys_put_le16(params.interval, &value[0]);
+	sys_put_le16(params.latency, &value[2]);
+	sys_put_le16(params.timeout, &value[4]);
+	value[6] = params.profile;
+	sys_put_le16(params.updates, &value[7]);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, value,
+				 sizeof(value));
+}
+
+#ifdef CONFIG_ESS_FILTER
+static ssize_t read_filter_config(struct bt_conn *conn,
+				  const struct bt_gatt_attr *attr, void *buf,
+				  uint16_t len, uint16_t offset)
+{
+	uint8_t value[FILTER_CHANNEL_COUNT * FILTER_CONFIG_SIZE];
+	struct filter_config config;
+	uint8_t *entry = value;
+	size_t i;
+
+	for (i = 0; i < FILTER_CHANNEL_COUNT; ++i) {
+		filter_get_config(i, &config);
+		entry[0] = config.median_window;
+		entry[1] = config.ema_shift;
+		sys_put_le32(config.max_rate, &entry[2]);
+		entry += FILTER_CONFIG_SIZE;
+	}
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, value,
+				 sizeof(value));
+}
+
+static ssize_t write_filter_config(struct bt_conn *conn,
+				   const struct bt_gatt_attr *attr,
+				   const void *buf, uint16_t len,
+				   uint16_t offset, uint8_t flags)
+{
+	const uint8_t *value = buf;
+	struct filter_config config;
+
+	if (offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	} else if (len != FILTER_CONFIG_WRITE_SIZE) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	config.median_window = value[1];
+	config.ema_shift = value[2];
+	config.max_rate = sys_get_le32(&value[3]);
+
+	if (filter_configure(value[0], &config) != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+
+	LOG_DBG("Filter %s set to median %u, shift %u, rate %u",
+		filter_channel_name(value[0]), config.median_window,
+		config.ema_shift, config.max_rate);
+
+	return len;
+}
+#endif
+
+static void ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	sample_scheduler_update();
+	conn_policy_update();
+}
+
+/* Called with ess_connections_lock held */
+static struct ess_connection *find_connection(struct bt_conn *conn)
+{
+	struct ess_connection *connection;
+
+	if (conn == NULL) {
+		return NULL;
+	}
+
+	connection = &ess_connections[bt_conn_index(conn)];
+
+	return (connection->conn == conn ? connection : NULL);
+}
+
+static size_t characteristic_index(const struct bt_gatt_attr *attr)
+{
+	const struct ess_characteristic *characteristic = attr->user_data;
+
+	return characteristic - ess_characteristics;
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	struct ess_connection *connection;
+	k_spinlock_key_t key;
+	size_t i;
+
+	if (err) {
+		return;
+	}
+
+	/* New centrals start with the default trigger settings, the
+	 * settings of other connections are left as they are
+	 */
+	key = k_spin_lock(&ess_connections_lock);
+	connection = &ess_connections[bt_conn_index(conn)];
+	memset(connection, 0, sizeof(*connection));
+	for (i = 0; i < ARRAY_SIZE(ess_characteristics); ++i) {
+		ess_trigger_set(&connection->triggers[i],
+				ESS_TRIGGER_FIXED_INTERVAL,
+				CONFIG_ESS_TRIGGER_DEFAULT_INTERVAL_S,
+				ess_characteristics[i].size);
+	}
+	connection->conn = conn;
+	k_spin_unlock(&ess_connections_lock, key);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	struct ess_connection *connection;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&ess_connections_lock);
+	connection = find_connection(conn);
+	if (connection != NULL) {
+		connection->conn = NULL;
+	}
+	k_spin_unlock(&ess_connections_lock, key);
+}
+
+static void count_subscriber(struct bt_conn *conn, void *data)
+{
+	uint32_t *count = data;
+
+	if (ess_service_is_subscribed(conn)) {
+		++*count;
+	}
+}
+
+static void notify_connection(struct bt_conn *conn, void *data)
+{
+	struct bt_gatt_notify_params params[ESS_CHARACTERISTIC_COUNT];
+	struct ess_connection *connection;
+	const struct ess_characteristic *characteristic;
+	bool triggered[ESS_CHARACTERISTIC_COUNT];
+	bool any_triggered = false;
+	int64_t *now = data;
+	uint16_t count = 0;
+	k_spinlock_key_t key;
+	size_t i;
+	int rc;
+
+	/* Triggers are evaluated against what this central was last sent,
+	 * so one sample fans out to each connection at its own interval.
+	 * The lock is released before notifying, which can block
+	 */
+	key = k_spin_lock(&ess_connections_lock);
+	connection = find_connection(conn);
+	if (connection == NULL) {
+		k_spin_unlock(&ess_connections_lock, key);
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(ess_characteristics); ++i) {
+		characteristic = &ess_characteristics[i];
+		triggered[i] = ess_trigger_evaluate(&connection->triggers[i],
+						    &connection->states[i],
+						    characteristic->current,
+						    *now);
+		if (triggered[i]) {
+			ess_trigger_notified(&connection->states[i],
+					     characteristic->current, *now);
+			any_triggered = true;
+		}
+	}
+	k_spin_unlock(&ess_connections_lock, key);
+
+	if (bt_gatt_is_subscribed(conn, packed_attr, BT_GATT_CCC_NOTIFY)) {
+		if (!any_triggered) {
+			return;
+		}
+
+		/* The central has opted in to batched updates, all readings
+		 * are sent in one notification instead of one per
+		 * characteristic
+		 */
+		rc = bt_gatt_notify(conn, packed_attr, &packed_value,
+				    sizeof(packed_value));
+		if (rc != 0) {
+			LOG_DBG("Packed notification failed (err %d)", rc);
+		}
+		return;
+	}
+
+	memset(params, 0, sizeof(params));
+	for (i = 0; i < ARRAY_SIZE(ess_characteristics); ++i) {
+		if (triggered[i] &&
+		    bt_gatt_is_subscribed(conn, ess_characteristics[i].attr,
+					  BT_GATT_CCC_NOTIFY)) {
+			params[count].attr = ess_characteristics[i].attr;
+			params[count].data = ess_characteristics[i].value;
+			params[count].len = ess_characteristics[i].size;
+			++count;
+		}
+	}
+
+	if (count > 0) {
+		/* Sent as a single multiple handle value notification if the
+		 * central supports it, otherwise the stack falls back to
+		 * separate notifications
+		 */
+		rc = bt_gatt_notify_multiple(conn, count, params);
+		if (rc != 0) {
+			LOG_DBG("Notification failed (err %d)", rc);
+		}
+	}
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void ess_service_init(void)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(ess_characteristics); ++i) {
+		ess_characteristics[i].attr =
+			bt_gatt_find_by_uuid(ess_svc.attrs, ess_svc.attr_count,
+					     ess_characteristics[i].uuid);
+	}
+
+	packed_attr = bt_gatt_find_by_uuid(ess_svc.attrs, ess_svc.attr_count,
+					   BT_UUID_ESS_PACKED);
+
+	/* The dew point characteristic can be read at any time and is also
+	 * carried by the chart, beacons and bulk channel, so it is always
+	 * calculated
+	 */
+	derived_demand(BIT(DERIVED_METRIC_DEW_POINT));
+
+	bt_conn_cb_register(&ess_conn_callbacks);
+}
+
+uint32_t ess_service_subscriber_count(void)
+{
+	uint32_t count = 0;
+
+	bt_conn_foreach(BT_CONN_TYPE_LE, count_subscriber, &count);
+
+	return count;
+}
+
+bool ess_service_is_subscribed(struct bt_conn *conn)
+{
+	size_t i;
+
+	if (bt_gatt_is_subscribed(conn, packed_attr, BT_GATT_CCC_NOTIFY)) {
+		return true;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(ess_characteristics); ++i) {
+		if (bt_gatt_is_subscribed(conn, ess_characteristics[i].attr,
+					  BT_GATT_CCC_NOTIFY)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ess_service_set_update_interval(uint32_t seconds)
+{
+	sys_put_le24(seconds, es_measurement_value.update_interval);
+}
+
+void ess_service_update(const struct ess_sample *sample)
+{
+	int64_t now = k_uptime_get();
+
+	temperature_value = sys_cpu_to_le16(sample->temperature);
+	humidity_value = sys_cpu_to_le16(sample->humidity);
+	pressure_value = sys_cpu_to_le32(sample->pressure);
+	dew_point_value = (int8_t)(sample->derived[DERIVED_METRIC_DEW_POINT] /
+				   DEW_POINT_DIVIDER);
+
+	packed_value.temperature = temperature_value;
+	packed_value.humidity = humidity_value;
+	packed_value.pressure = pressure_value;
+	packed_value.dew_point = dew_point_value;
+
+	ess_characteristics[ESS_CHARACTERISTIC_TEMPERATURE].current =
+		sample->temperature;
+	ess_characteristics[ESS_CHARACTERISTIC_HUMIDITY].current =
+		sample->humidity;
+	ess_characteristics[ESS_CHARACTERISTIC_PRESSURE].current =
+		sample->pressure;
+	ess_characteristics[ESS_CHARACTERISTIC_DEW_POINT].current =
+		dew_point_value;
+#ifdef CONFIG_ESS_SENSOR_GAS
+	gas_resistance_value = sys_cpu_to_le32(sample->gas_resistance);
+	ess_characteristics[ESS_CHARACTERISTIC_GAS_RESISTANCE].current =
+		sample->gas_resistance;
+#endif
+
+	/* Only characteristics whose trigger condition is met for a
+	 * connection are notified to it, the packed characteristic is
+	 * notified if any of them are
+	 */
+	bt_conn_foreach(BT_CONN_TYPE_LE, notify_connection, &now);
+}
@@ -0,0 +1,192 @@
+/**
+ * @file ess_trigger.c
+ * @brief ESS Trigger Setting descriptor parsing and evaluation
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/byteorder.h>
+
+#include "ess_trigger.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define CONDITION_SIZE 1
+#define INTERVAL_SIZE 3
+#define MS_PER_SECOND 1000
+/* Samples are not taken at exact intervals, so intervals are rounded to the
+ * nearest second when evaluated
+ */
+#define INTERVAL_TOLERANCE_MS (MS_PER_SECOND / 2)
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static int32_t decode_value(const uint8_t *data, uint8_t size,
+			    bool value_signed);
+static void encode_raw(struct ess_trigger *trigger, uint8_t operand_size);
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static int32_t decode_value(const uint8_t *data, uint8_t size,
+			    bool value_signed)
+{
+	switch (size) {
+	case sizeof(uint8_t):
+		return (value_signed ? (int8_t)data[0] : data[0]);
+	case sizeof(uint16_t):
+		return (value_signed ? (int16_t)sys_get_le16(data) :
+				       sys_get_le16(data));
+	case INTERVAL_SIZE:
+		return sys_get_le24(data);
+	default:
+		return (int32_t)sys_get_le32(data);
+	}
+}
+
+static void encode_raw(struct ess_trigger *trigger, uint8_t operand_size)
+{
+	uint8_t operand[sizeof(uint32_t)];
+
+	sys_put_le32((uint32_t)trigger->operand, operand);
+	trigger->raw[0] = trigger->condition;
+	memcpy(&trigger->raw[CONDITION_SIZE], operand, operand_size);
+	trigger->raw_size = CONDITION_SIZE + operand_size;
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+int ess_trigger_parse(struct ess_trigger *trigger, const uint8_t *data,
+		      uint16_t size, uint8_t value_size, bool value_signed)
+{
+	uint8_t condition;
+	uint16_t operand_size;
+	int32_t operand = 0;
+
+	if (size < CONDITION_SIZE) {
+		return -EINVAL;
+	}
+
+	condition = data[0];
+	operand_size = size - CONDITION_SIZE;
+
+	switch (condition) {
+	case ESS_TRIGGER_INACTIVE:
+		if (operand_size != 0) {
+			return -EINVAL;
+		}
+		break;
+	case ESS_TRIGGER_FIXED_INTERVAL:
+	case ESS_TRIGGER_MIN_INTERVAL:
+		if (operand_size != INTERVAL_SIZE) {
+			return -EINVAL;
+		}
+		operand = decode_value(&data[CONDITION_SIZE], INTERVAL_SIZE,
+				       false);
+		break;
+	case ESS_TRIGGER_VALUE_CHANGED:
+		if (operand_size != 0 && operand_size != value_size) {
+			return -EINVAL;
+		}
+		if (operand_size != 0) {
+			operand = decode_value(&data[CONDITION_SIZE],
+					       value_size, false);
+		}
+		break;
+	case ESS_TRIGGER_LESS_THAN:
+	case ESS_TRIGGER_LESS_THAN_OR_EQUAL:
+	case ESS_TRIGGER_GREATER_THAN:
+	case ESS_TRIGGER_GREATER_THAN_OR_EQUAL:
+	case ESS_TRIGGER_EQUAL:
+	case ESS_TRIGGER_NOT_EQUAL:
+		if (operand_size != value_size) {
+			return -EINVAL;
+		}
+		operand = decode_value(&data[CONDITION_SIZE], value_size,
+				       value_signed);
+		break;
+	default:
+		return -ENOTSUP;
+	}
+
+	trigger->condition = condition;
+	trigger->operand = operand;
+	memcpy(trigger->raw, data, size);
+	trigger->raw_size = size;
+
+	return 0;
+}
+
+void ess_trigger_set(struct ess_trigger *trigger,
+		     enum ess_trigger_condition condition, int32_t operand,
+		     uint8_t value_size)
+{
+	trigger->condition = condition;
+	trigger->operand = operand;
+
+	switch (condition) {
+	case ESS_TRIGGER_INACTIVE:
+		encode_raw(trigger, 0);
+		break;
+	case ESS_TRIGGER_FIXED_INTERVAL:
+	case ESS_TRIGGER_MIN_INTERVAL:
+		encode_raw(trigger, INTERVAL_SIZE);
+		break;
+	case ESS_TRIGGER_VALUE_CHANGED:
+		encode_raw(trigger, (operand == 0 ? 0 : value_size));
+		break;
+	default:
+		encode_raw(trigger, value_size);
+		break;
+	}
+}
+
+bool ess_trigger_evaluate(const struct ess_trigger *trigger,
+			  const struct ess_trigger_state *state, int32_t value,
+			  int64_t now)
+{
+	switch (trigger->condition) {
+	case ESS_TRIGGER_FIXED_INTERVAL:
+	case ESS_TRIGGER_MIN_INTERVAL:
+		return (!state->notified ||
+			(now - state->time + INTERVAL_TOLERANCE_MS) >=
+				((int64_t)trigger->operand * MS_PER_SECOND));
+	case ESS_TRIGGER_VALUE_CHANGED:
+		return (!state->notified ||
+			abs(value - state->value) > trigger->operand);
+	case ESS_TRIGGER_LESS_THAN:
+		return (value < trigger->operand);
+	case ESS_TRIGGER_LESS_THAN_OR_EQUAL:
+		return (value <= trigger->operand);
+	case ESS_TRIGGER_GREATER_THAN:
+		return (value > trigger->operand);
+	case ESS_TRIGGER_GREATER_THAN_OR_EQUAL:
+		return (value >= trigger->operand);
+	case ESS_TRIGGER_EQUAL:
+		return (value == trigger->operand);
+	case ESS_TRIGGER_NOT_EQUAL:
+		return (value != trigger->operand);
+	case ESS_TRIGGER_INACTIVE:
+	default:
+		return false;
+	}
+}
+
+void ess_trigger_notified(struct ess_trigger_state *state, int32_t value,
+			  int64_t now)
+{
+	state->notified = true;
+	state->value = value;
+	state->time = now;
+}
@@ -0,0 +1,284 @@
+/**
+ * @file filter.c
+ * @brief Streaming noise filter which rejects outliers from the sensor
+ * readings before they are published
+ *
+ * A single bad sensor read would otherwise be notified, charted and
+ * logged, and trip the thresholds of the ES Trigger Settings and the
+ * adaptive sample period. Each reading first passes through a median of
+ * the newest readings, which removes isolated spikes, then a limit on the
+ * rate of change, which bounds longer bursts, and finally an exponential
+ * moving average, which smooths the sensor noise.
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <string.h>
+
+#include "filter.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define RATE_PERIOD_MS (SEC_PER_MIN * MSEC_PER_SEC)
+
+/* Index of the reading a number of samples before the one at head */
+#define WINDOW_INDEX(head, back)                                               \
+	(((head) + FILTER_MEDIAN_WINDOW_MAX - (back)) %                        \
+	 FILTER_MEDIAN_WINDOW_MAX)
+
+#define EMA_ONE ((int32_t)BIT(FILTER_EMA_FRACTION_BITS))
+#define EMA_ROUNDING (EMA_ONE / 2)
+
+#define IS_MEDIAN_WINDOW_VALID(window)                                         \
+	((window) >= 1 && (window) <= FILTER_MEDIAN_WINDOW_MAX &&              \
+	 ((window) % 2) == 1)
+
+BUILD_ASSERT(IS_MEDIAN_WINDOW_VALID(
+		     CONFIG_ESS_FILTER_TEMPERATURE_MEDIAN_WINDOW),
+	     "Temperature median window must be odd");
+BUILD_ASSERT(IS_MEDIAN_WINDOW_VALID(CONFIG_ESS_FILTER_HUMIDITY_MEDIAN_WINDOW),
+	     "Humidity median window must be odd");
+BUILD_ASSERT(IS_MEDIAN_WINDOW_VALID(CONFIG_ESS_FILTER_PRESSURE_MEDIAN_WINDOW),
+	     "Pressure median window must be odd");
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static int32_t median_of_3(int32_t a, int32_t b, int32_t c);
+static int32_t median_of_5(int32_t a, int32_t b, int32_t c, int32_t d,
+			   int32_t e);
+static int32_t filter_median(struct filter_channel_state *channel,
+			     uint8_t window, int32_t reading);
+static int32_t filter_rate(struct filter_channel_state *channel,
+			   uint32_t max_rate, int64_t elapsed_ms,
+			   int32_t reading);
+static int32_t filter_average(struct filter_channel_state *channel,
+			      uint8_t shift, int32_t reading);
+static int32_t get_reading(const struct ess_sample *sample,
+			   enum filter_channel channel);
+static void set_reading(struct ess_sample *sample,
+			enum filter_channel channel, int32_t value);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+K_MUTEX_DEFINE(filter_config_mutex);
+
+static struct filter_config filter_configs[FILTER_CHANNEL_COUNT] = {
+	[FILTER_CHANNEL_TEMPERATURE] = {
+		.median_window = CONFIG_ESS_FILTER_TEMPERATURE_MEDIAN_WINDOW,
+		.ema_shift = CONFIG_ESS_FILTER_TEMPERATURE_EMA_SHIFT,
+		.max_rate = CONFIG_ESS_FILTER_TEMPERATURE_MAX_RATE,
+	},
+	[FILTER_CHANNEL_HUMIDITY] = {
+		.median_window = CONFIG_ESS_FILTER_HUMIDITY_MEDIAN_WINDOW,
+		.ema_shift = CONFIG_ESS_FILTER_HUMIDITY_EMA_SHIFT,
+		.max_rate = CONFIG_ESS_FILTER_HUMIDITY_MAX_RATE,
+	},
+	[FILTER_CHANNEL_PRESSURE] = {
+		.median_window = CONFIG_ESS_FILTER_PRESSURE_MEDIAN_WINDOW,
+		.ema_shift = CONFIG_ESS_FILTER_PRESSURE_EMA_SHIFT,
+		.max_rate = CONFIG_ESS_FILTER_PRESSURE_MAX_RATE,
+	},
+};
+
+static const char *const filter_channel_names[FILTER_CHANNEL_COUNT] = {
+	"temperature",
+	"humidity",
+	"pressure",
+};
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static int32_t median_of_3(int32_t a, int32_t b, int32_t c)
+{
+	return MAX(MIN(a, b), MIN(MAX(a, b), c));
+}
+
+static int32_t median_of_5(int32_t a, int32_t b, int32_t c, int32_t d,
+			   int32_t e)
+{
+	/* The larger of the two pair minima and the smaller of the two pair
+	 * maxima leave out the two smallest and two largest of a to d, the
+	 * median is between them and e
+	 */
+	return median_of_3(e, MAX(MIN(a, b), MIN(c, d)),
+			   MIN(MAX(a, b), MAX(c, d)));
+}
+
+static int32_t filter_median(struct filter_channel_state *channel,
+			     uint8_t window, int32_t reading)
+{
+	int32_t *values = channel->window;
+	uint8_t head;
+
+	/* The newest readings are always kept, so the window can change
+	 * without refilling it
+	 */
+	head = channel->head;
+	values[head] = reading;
+	channel->head = (head + 1) % FILTER_MEDIAN_WINDOW_MAX;
+
+	if (window == 3) {
+		/* The two readings before the newest one */
+		return median_of_3(values[head], values[WINDOW_INDEX(head, 1)],
+				   values[WINDOW_INDEX(head, 2)]);
+	} else if (window == FILTER_MEDIAN_WINDOW_MAX) {
+		return median_of_5(values[0], values[1], values[2], values[3],
+				   values[4]);
+	}
+
+	return reading;
+}
+
+static int32_t filter_rate(struct filter_channel_state *channel,
+			   uint32_t max_rate, int64_t elapsed_ms,
+			   int32_t reading)
+{
+	int64_t step;
+
+	if (max_rate != 0) {
+		/* Rounded up, so that a slow rate still allows some change
+		 * between closely spaced samples
+		 */
+		step = ceiling_fraction((int64_t)max_rate * elapsed_ms,
+					RATE_PERIOD_MS);
+		step = MIN(step, INT32_MAX);
+		reading = CLAMP(reading, channel->limited - step,
+				channel->limited + step);
+	}
+
+	channel->limited = reading;
+
+	return reading;
+}
+
+static int32_t filter_average(struct filter_channel_state *channel,
+			      uint8_t shift, int32_t reading)
+{
+	int32_t target = reading * EMA_ONE;
+
+	/* The average moves 1 / 2^shift of the way to the new reading */
+	channel->average += (target - channel->average) >> shift;
+
+	return (channel->average + EMA_ROUNDING) >> FILTER_EMA_FRACTION_BITS;
+}
+
+static int32_t get_reading(const struct ess_sample *sample,
+			   enum filter_channel channel)
+{
+	switch (channel) {
+	case FILTER_CHANNEL_TEMPERATURE:
+		return sample->temperature;
+	case FILTER_CHANNEL_HUMIDITY:
+		return sample->humidity;
+	default:
+		return (int32_t)sample->pressure;
+	}
+}
+
+static void set_reading(struct ess_sample *sample,
+			enum filter_channel channel, int32_t value)
+{
+	/* Every stage outputs a value between readings it was given, so the
+	 * value is in the range of the reading
+	 */
+	switch (channel) {
+	case FILTER_CHANNEL_TEMPERATURE:
+		sample->temperature = (int16_t)value;
+		break;
+	case FILTER_CHANNEL_HUMIDITY:
+		sample->humidity = (uint16_t)value;
+		break;
+	default:
+		sample->pressure = (uint32_t)value;
+		break;
+	}
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void filter_state_init(struct filter_state *state)
+{
+	memset(state, 0, sizeof(*state));
+}
+
+void filter_apply(struct filter_state *state, struct ess_sample *sample)
+{
+	struct filter_config configs[FILTER_CHANNEL_COUNT];
+	struct filter_channel_state *channel;
+	int64_t elapsed_ms;
+	int32_t reading;
+	size_t i;
+	size_t j;
+
+	k_mutex_lock(&filter_config_mutex, K_FOREVER);
+	memcpy(configs, filter_configs, sizeof(configs));
+	k_mutex_unlock(&filter_config_mutex);
+
+	elapsed_ms = MAX(sample->timestamp - state->timestamp, 0);
+	state->timestamp = sample->timestamp;
+
+	for (i = 0; i < FILTER_CHANNEL_COUNT; ++i) {
+		channel = &state->channels[i];
+		reading = get_reading(sample, i);
+
+		if (!state->primed) {
+			/* Every stage starts from the first reading */
+			for (j = 0; j < FILTER_MEDIAN_WINDOW_MAX; ++j) {
+				channel->window[j] = reading;
+			}
+			channel->limited = reading;
+			channel->average = reading * EMA_ONE;
+		}
+
+		reading = filter_median(channel, configs[i].median_window,
+					reading);
+		reading = filter_rate(channel, configs[i].max_rate, elapsed_ms,
+				      reading);
+		reading = filter_average(channel, configs[i].ema_shift,
+					 reading);
+
+		set_reading(sample, i, reading);
+	}
+
+	state->primed = true;
+}
+
+int filter_configure(enum filter_channel channel,
+		     const struct filter_config *config)
+{
+	if (channel >= FILTER_CHANNEL_COUNT ||
+	    !IS_MEDIAN_WINDOW_VALID(config->median_window) ||
+	    config->ema_shift > FILTER_EMA_SHIFT_MAX) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&filter_config_mutex, K_FOREVER);
+	filter_configs[channel] = *config;
+	k_mutex_unlock(&filter_config_mutex);
+
+	return 0;
+}
+
+void filter_get_config(enum filter_channel channel,
+		       struct filter_config *config)
+{
+	k_mutex_lock(&filter_config_mutex, K_FOREVER);
+	*config = filter_configs[channel];
+	k_mutex_unlock(&filter_config_mutex);
+}
+
+const char *filter_channel_name(enum filter_channel channel)
+{
+	return filter_channel_names[channel];
+}
@@ -0,0 +1,118 @@
+/**
+ * @file fixed_math.c
+ * @brief Q16.16 fixed point logarithm and exponential shared by the dew
+ * point and derived metric calculations
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+#include "fixed_math.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define LN_2_Q16 45426
+#define LOG2_E_Q16 94548 /* 1 / ln(2) */
+
+#define LN_TABLE_BITS 5
+#define LN_TABLE_MASK (BIT(LN_TABLE_BITS) - 1)
+
+#define EXP_TABLE_BITS 5
+#define EXP_FRACTION_BITS 16
+#define EXP_INDEX_SHIFT (EXP_FRACTION_BITS - EXP_TABLE_BITS)
+#define EXP_FRACTION_MASK (BIT(EXP_FRACTION_BITS) - 1)
+#define EXP_REMAINDER_MASK (BIT(EXP_INDEX_SHIFT) - 1)
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+/* ln(1 + i / 32) for i = 0..32 in Q16.16 */
+static const uint16_t ln_table[BIT(LN_TABLE_BITS) + 1] = {
+	0,     2017,  3973,  5873,  7719,  9515,  11262, 12965, 14624,
+	16242, 17821, 19364, 20870, 22343, 23783, 25193, 26573, 27924,
+	29248, 30546, 31818, 33067, 34292, 35494, 36675, 37835, 38975,
+	40095, 41196, 42280, 43345, 44394, 45426
+};
+
+/* 2^(i / 32) for i = 0..32 in Q16.16 */
+static const uint32_t exp2_table[BIT(EXP_TABLE_BITS) + 1] = {
+	65536,	66971,	68438,	69936,	71468,	73032,	74632,
+	76266,	77936,	79642,	81386,	83169,	84990,	86851,
+	88752,	90696,	92682,	94711,	96785,	98905,	101070,
+	103283, 105545, 107856, 110218, 112631, 115098, 117618,
+	120194, 122825, 125515, 128263, 131072
+};
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+int32_t fixed_ln_q16(uint32_t value)
+{
+	/* ln(x) = n * ln(2) + ln(1 + f) where n is the position of the most
+	 * significant bit and f the remaining mantissa, ln(1 + f) is linearly
+	 * interpolated from the table using the bits below the top
+	 * LN_TABLE_BITS bits of the mantissa
+	 */
+	uint32_t msb = find_msb_set(value) - 1;
+	uint32_t index, remainder, shift;
+	int32_t result;
+
+	if (msb < LN_TABLE_BITS) {
+		index = (value << (LN_TABLE_BITS - msb)) & LN_TABLE_MASK;
+		remainder = 0;
+		shift = 0;
+	} else {
+		shift = msb - LN_TABLE_BITS;
+		index = (value >> shift) & LN_TABLE_MASK;
+		remainder = value & (BIT(shift) - 1);
+	}
+
+	result = (int32_t)(msb * LN_2_Q16) + ln_table[index];
+	if (remainder != 0) {
+		/* The remainder has up to 31 - LN_TABLE_BITS bits, so the
+		 * product does not fit in 32 bits for large values
+		 */
+		result += (int32_t)(((int64_t)(ln_table[index + 1] -
+					       ln_table[index]) *
+				     remainder) >>
+				    shift);
+	}
+
+	return result;
+}
+
+uint32_t fixed_exp_q16(int32_t x)
+{
+	/* exp(x) = 2^(x / ln(2)) = 2^n * 2^f where n is the integer part and
+	 * f the fraction, 2^f is linearly interpolated from the table
+	 */
+	int32_t y;
+	int32_t n;
+	uint32_t fraction, index, remainder, mantissa;
+
+	x = MIN(x, FIXED_EXP_Q16_MAX);
+	y = (int32_t)(((int64_t)x * LOG2_E_Q16) >> EXP_FRACTION_BITS);
+	n = y >> EXP_FRACTION_BITS;
+	fraction = (uint32_t)y & EXP_FRACTION_MASK;
+
+	index = fraction >> EXP_INDEX_SHIFT;
+	remainder = fraction & EXP_REMAINDER_MASK;
+	mantissa = exp2_table[index] +
+		   (((exp2_table[index + 1] - exp2_table[index]) * remainder) >>
+		    EXP_INDEX_SHIFT);
+
+	if (n >= 0) {
+		return mantissa << n;
+	} else if (n <= -(int32_t)(EXP_FRACTION_BITS + 2)) {
+		return 0;
+	}
+
+	return mantissa >> -n;
+}
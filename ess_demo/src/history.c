@@ -0,0 +1,374 @@
+/**
+ * @file history.c
+ * @brief Compressed sample history, kept in a RAM ring of blocks with
+ * optional spillover of the oldest blocks to flash
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <string.h>
+#include <logging/log.h>
+#include <sys/byteorder.h>
+#ifdef CONFIG_ESS_HISTORY_FCB
+#include <storage/flash_map.h>
+#endif
+
+#include "history.h"
+#include "acquisition.h"
+
+LOG_MODULE_REGISTER(history);
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define BLOCK_DATA_SIZE                                                        \
+	(CONFIG_ESS_HISTORY_BLOCK_SIZE - HISTORY_BLOCK_HEADER_SIZE)
+
+/* Largest record: a keyframe with a 64 bit timestamp */
+#define VARINT_MAX_SIZE_32 5
+#define VARINT_MAX_SIZE_64 10
+#define RECORD_MAX_SIZE (VARINT_MAX_SIZE_32 * 4 + VARINT_MAX_SIZE_64)
+
+#define VARINT_CONTINUATION 0x80
+#define VARINT_SHIFT 7
+
+#define HISTORY_FCB_MAGIC 0x45535348 /* "ESSH" */
+#define HISTORY_FCB_VERSION 1
+
+BUILD_ASSERT(BLOCK_DATA_SIZE >= RECORD_MAX_SIZE,
+	     "History blocks are too small to hold a record");
+
+struct history_block {
+	uint32_t first_sequence;
+	uint32_t last_sequence;
+	uint16_t size;
+	uint16_t count;
+	uint8_t data[BLOCK_DATA_SIZE];
+};
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static uint8_t *put_varint(uint8_t *data, uint64_t value);
+static uint64_t zigzag(int64_t value);
+static size_t encode_record(uint8_t *data, const struct ess_sample *sample,
+			    const struct ess_sample *previous);
+static size_t serialise_block(const struct history_block *block,
+			      uint8_t *data);
+static bool block_in_range(uint32_t first_sequence, uint32_t last_sequence,
+			   const struct history_cursor *cursor);
+static uint32_t oldest_block(void);
+static void open_block(void);
+static void append_sample(const struct ess_sample *sample);
+static void history_update_handler(struct k_work *work);
+#ifdef CONFIG_ESS_HISTORY_FCB
+static int flash_init(void);
+static void spill_block(const struct history_block *block);
+#endif
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+K_WORK_DEFINE(history_update, history_update_handler);
+
+static struct sample_ring_reader history_reader;
+static struct acquisition_consumer history_consumer = {
+	.work = &history_update,
+};
+
+static struct history_block history_blocks[CONFIG_ESS_HISTORY_BLOCKS];
+/* Number of the block being written, blocks are numbered from 0 */
+static uint32_t history_head;
+static struct ess_sample history_previous;
+
+#ifdef CONFIG_ESS_HISTORY_FCB
+static struct fcb history_fcb;
+static struct flash_sector history_sectors[CONFIG_ESS_HISTORY_FCB_SECTORS];
+static bool history_fcb_ready;
+static uint8_t spill_buffer[CONFIG_ESS_HISTORY_BLOCK_SIZE];
+#endif
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static uint8_t *put_varint(uint8_t *data, uint64_t value)
+{
+	while (value >= VARINT_CONTINUATION) {
+		*data++ = (uint8_t)value | VARINT_CONTINUATION;
+		value >>= VARINT_SHIFT;
+	}
+	*data++ = (uint8_t)value;
+
+	return data;
+}
+
+static uint64_t zigzag(int64_t value)
+{
+	/* Small negative values encode to small positive values */
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static size_t encode_record(uint8_t *data, const struct ess_sample *sample,
+			    const struct ess_sample *previous)
+{
+	uint8_t *end = data;
+
+	if (previous == NULL) {
+		end = put_varint(end, sample->sequence);
+		end = put_varint(end, (uint64_t)sample->timestamp);
+		end = put_varint(end, zigzag(sample->temperature));
+		end = put_varint(end, sample->humidity);
+		end = put_varint(end, sample->pressure);
+	} else {
+		end = put_varint(end, sample->sequence - previous->sequence);
+		end = put_varint(end, (uint64_t)(sample->timestamp -
+						 previous->timestamp));
+		end = put_varint(end, zigzag((int64_t)sample->temperature -
+					     previous->temperature));
+		end = put_varint(end, zigzag((int64_t)sample->humidity -
+					     previous->humidity));
+		end = put_varint(end, zigzag((int64_t)sample->pressure -
+					     previous->pressure));
+	}
+
+	return end - data;
+}
+
+static size_t serialise_block(const struct history_block *block,
+			      uint8_t *data)
+{
+	size_t size = HISTORY_BLOCK_HEADER_SIZE + block->size;
+
+	sys_put_le32(block->first_sequence, &data[0]);
+	sys_put_le32(block->last_sequence, &data[4]);
+	sys_put_le16(size, &data[8]);
+	sys_put_le16(block->count, &data[10]);
+	memcpy(&data[HISTORY_BLOCK_HEADER_SIZE], block->data, block->size);
+
+	return size;
+}
+
+static bool block_in_range(uint32_t first_sequence, uint32_t last_sequence,
+			   const struct history_cursor *cursor)
+{
+	return (last_sequence >= cursor->first_sequence &&
+		first_sequence <= cursor->last_sequence);
+}
+
+static uint32_t oldest_block(void)
+{
+	return (history_head >= CONFIG_ESS_HISTORY_BLOCKS ?
+			history_head - CONFIG_ESS_HISTORY_BLOCKS + 1 :
+			0);
+}
+
+static void open_block(void)
+{
+	struct history_block *block;
+
+	++history_head;
+	block = &history_blocks[history_head % CONFIG_ESS_HISTORY_BLOCKS];
+
+#ifdef CONFIG_ESS_HISTORY_FCB
+	/* The block being replaced is the oldest in RAM */
+	if (block->count != 0) {
+		spill_block(block);
+	}
+#endif
+
+	block->size = 0;
+	block->count = 0;
+}
+
+static void append_sample(const struct ess_sample *sample)
+{
+	struct history_block *block =
+		&history_blocks[history_head % CONFIG_ESS_HISTORY_BLOCKS];
+	uint8_t record[RECORD_MAX_SIZE];
+	size_t size;
+
+	size = encode_record(record, sample,
+			     (block->count == 0) ? NULL : &history_previous);
+
+	/* Each block starts with a keyframe so it can be decoded on its own */
+	if (block->size + size > BLOCK_DATA_SIZE) {
+		open_block();
+		block = &history_blocks[history_head %
+					CONFIG_ESS_HISTORY_BLOCKS];
+		size = encode_record(record, sample, NULL);
+	}
+
+	if (block->count == 0) {
+		block->first_sequence = sample->sequence;
+	}
+	memcpy(&block->data[block->size], record, size);
+	block->size += size;
+	block->last_sequence = sample->sequence;
+	++block->count;
+
+	history_previous = *sample;
+}
+
+static void history_update_handler(struct k_work *work)
+{
+	struct ess_sample sample;
+
+	/* Unlike the display and notifications every sample is kept */
+	while (sample_ring_read(&history_reader, &sample) == 0) {
+		append_sample(&sample);
+	}
+
+	if (history_reader.dropped != 0) {
+		LOG_WRN("%u samples missed", history_reader.dropped);
+		history_reader.dropped = 0;
+	}
+}
+
+#ifdef CONFIG_ESS_HISTORY_FCB
+static int flash_init(void)
+{
+	uint32_t count = ARRAY_SIZE(history_sectors);
+	int rc;
+
+	rc = flash_area_get_sectors(FLASH_AREA_ID(storage), &count,
+				    history_sectors);
+	if (rc != 0 && rc != -ENOMEM) {
+		return rc;
+	}
+
+	history_fcb.f_magic = HISTORY_FCB_MAGIC;
+	history_fcb.f_version = HISTORY_FCB_VERSION;
+	history_fcb.f_sectors = history_sectors;
+	history_fcb.f_sector_cnt = count;
+	history_fcb.f_scratch_cnt = 0;
+
+	rc = fcb_init(FLASH_AREA_ID(storage), &history_fcb);
+	if (rc == 0) {
+		rc = fcb_clear(&history_fcb);
+	}
+
+	return rc;
+}
+
+static void spill_block(const struct history_block *block)
+{
+	struct fcb_entry entry;
+	size_t size;
+	int rc;
+
+	if (!history_fcb_ready) {
+		return;
+	}
+
+	size = serialise_block(block, spill_buffer);
+
+	rc = fcb_append(&history_fcb, size, &entry);
+	if (rc == -ENOSPC) {
+		/* Flash is full, the oldest sector is discarded */
+		rc = fcb_rotate(&history_fcb);
+		if (rc == 0) {
+			rc = fcb_append(&history_fcb, size, &entry);
+		}
+	}
+	if (rc == 0) {
+		rc = flash_area_write(history_fcb.fap,
+				      FCB_ENTRY_FA_DATA_OFF(entry),
+				      spill_buffer, size);
+	}
+	if (rc == 0) {
+		rc = fcb_append_finish(&history_fcb, &entry);
+	}
+
+	if (rc != 0) {
+		LOG_ERR("Block spill to flash failed (err %d)", rc);
+	}
+}
+#endif
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void history_init(void)
+{
+#ifdef CONFIG_ESS_HISTORY_FCB
+	int rc = flash_init();
+
+	if (rc == 0) {
+		history_fcb_ready = true;
+	} else {
+		LOG_ERR("Flash history unavailable (err %d)", rc);
+	}
+#endif
+
+	sample_ring_reader_init(&history_reader);
+	acquisition_register_consumer(&history_consumer);
+}
+
+void history_cursor_init(struct history_cursor *cursor,
+			 uint32_t first_sequence, uint32_t last_sequence)
+{
+	memset(cursor, 0, sizeof(*cursor));
+	cursor->first_sequence = first_sequence;
+	cursor->last_sequence = last_sequence;
+	cursor->block = oldest_block();
+#ifdef CONFIG_ESS_HISTORY_FCB
+	cursor->in_flash = history_fcb_ready;
+#endif
+}
+
+size_t history_read_block(struct history_cursor *cursor, uint8_t *data,
+			  size_t size)
+{
+	const struct history_block *block;
+
+	__ASSERT(size >= CONFIG_ESS_HISTORY_BLOCK_SIZE,
+		 "History block buffer too small");
+
+#ifdef CONFIG_ESS_HISTORY_FCB
+	while (cursor->in_flash) {
+		if (fcb_getnext(&history_fcb, &cursor->flash_entry) != 0) {
+			cursor->in_flash = false;
+			break;
+		}
+
+		if (cursor->flash_entry.fe_data_len > size ||
+		    flash_area_read(history_fcb.fap,
+				    FCB_ENTRY_FA_DATA_OFF(cursor->flash_entry),
+				    data, cursor->flash_entry.fe_data_len) != 0) {
+			continue;
+		}
+
+		if (block_in_range(sys_get_le32(&data[0]),
+				   sys_get_le32(&data[4]), cursor)) {
+			return cursor->flash_entry.fe_data_len;
+		}
+	}
+#endif
+
+	/* Blocks replaced whilst reading have moved to flash (or been
+	 * discarded) after it was read, so are skipped
+	 */
+	if (cursor->block < oldest_block()) {
+		cursor->block = oldest_block();
+	}
+
+	while (cursor->block <= history_head) {
+		block = &history_blocks[cursor->block %
+					CONFIG_ESS_HISTORY_BLOCKS];
+		++cursor->block;
+
+		if (block->count != 0 &&
+		    block_in_range(block->first_sequence, block->last_sequence,
+				   cursor)) {
+			return serialise_block(block, data);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,292 @@
+/**
+ * @file history_service.c
+ * @brief Vendor specific service which streams ranges of the sample history
+ *
+ * A range is requested by writing to the control point, the history blocks
+ * holding it are then streamed as notifications of the data characteristic,
+ * each filled up to the ATT MTU, followed by a response notification of the
+ * control point.
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <string.h>
+#include <logging/log.h>
+#include <sys/byteorder.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/uuid.h>
+#include <bluetooth/gatt.h>
+
+#include "history_service.h"
+#include "history.h"
+#include "conn_policy.h"
+
+LOG_MODULE_REGISTER(history_service);
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define ATT_NOTIFY_HEADER_SIZE 3
+#define STREAM_RETRY_MS 10
+#define CHUNK_SIZE (CONFIG_BT_L2CAP_TX_MTU - ATT_NOTIFY_HEADER_SIZE)
+
+enum history_opcode {
+	HISTORY_OPCODE_READ_RANGE = 0x01,
+	HISTORY_OPCODE_ABORT = 0x02,
+	HISTORY_OPCODE_RESPONSE = 0x80,
+};
+
+enum history_status {
+	HISTORY_STATUS_SUCCESS = 0x01,
+	HISTORY_STATUS_ABORTED = 0x02,
+	HISTORY_STATUS_FAILED = 0x03,
+};
+
+/* Opcode, first sequence number, last sequence number */
+#define READ_RANGE_SIZE 9
+#define ABORT_SIZE 1
+/* Response opcode, request opcode, status, number of blocks */
+#define RESPONSE_SIZE 7
+
+struct history_stream {
+	struct bt_conn *conn;
+	struct history_cursor cursor;
+	uint8_t block[CONFIG_ESS_HISTORY_BLOCK_SIZE];
+	size_t block_size;
+	size_t block_offset;
+	uint8_t chunk[CHUNK_SIZE];
+	uint16_t chunk_size;
+	uint32_t blocks;
+};
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static ssize_t write_control_point(struct bt_conn *conn,
+				   const struct bt_gatt_attr *attr,
+				   const void *buf, uint16_t len,
+				   uint16_t offset, uint8_t flags);
+static void fill_chunk(uint16_t size);
+static void finish_stream(uint8_t status);
+static void stream_sent(struct bt_conn *conn, void *user_data);
+static void stream_retry_handler(struct k_timer *timer);
+static void stream_handler(struct k_work *work);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+K_WORK_DEFINE(history_stream_work, stream_handler);
+K_TIMER_DEFINE(history_stream_retry_timer, stream_retry_handler, NULL);
+
+/* Set from the Bluetooth thread when a stream is requested, the stream
+ * itself is only accessed from the system workqueue whilst set
+ */
+static atomic_t stream_busy;
+static atomic_t stream_abort;
+static struct history_stream stream;
+
+static const struct bt_gatt_attr *control_point_attr;
+static const struct bt_gatt_attr *data_attr;
+
+BT_GATT_SERVICE_DEFINE(
+	history_svc, BT_GATT_PRIMARY_SERVICE(BT_UUID_HISTORY_SERVICE),
+	BT_GATT_CHARACTERISTIC(BT_UUID_HISTORY_CONTROL_POINT,
+			       BT_GATT_CHRC_WRITE | BT_GATT_CHRC_NOTIFY,
+			       BT_GATT_PERM_WRITE, NULL, write_control_point,
+			       NULL),
+	BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+	BT_GATT_CHARACTERISTIC(BT_UUID_HISTORY_DATA, BT_GATT_CHRC_NOTIFY,
+			       BT_GATT_PERM_NONE, NULL, NULL, NULL),
+	BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE), );
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static ssize_t write_control_point(struct bt_conn *conn,
+				   const struct bt_gatt_attr *attr,
+				   const void *buf, uint16_t len,
+				   uint16_t offset, uint8_t flags)
+{
+	const uint8_t *data = buf;
+
+	if (offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	} else if (len < ABORT_SIZE) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	switch (data[0]) {
+	case HISTORY_OPCODE_READ_RANGE:
+		if (len != READ_RANGE_SIZE) {
+			return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+		}
+		if (!bt_gatt_is_subscribed(conn, control_point_attr,
+					   BT_GATT_CCC_NOTIFY) ||
+		    !bt_gatt_is_subscribed(conn, data_attr,
+					   BT_GATT_CCC_NOTIFY)) {
+			return BT_GATT_ERR(BT_ATT_ERR_CCC_IMPROPER_CONF);
+		}
+		if (!atomic_cas(&stream_busy, 0, 1)) {
+			return BT_GATT_ERR(BT_ATT_ERR_PROCEDURE_IN_PROGRESS);
+		}
+
+		stream.conn = bt_conn_ref(conn);
+		history_cursor_init(&stream.cursor, sys_get_le32(&data[1]),
+				    sys_get_le32(&data[5]));
+		stream.block_size = 0;
+		stream.block_offset = 0;
+		stream.chunk_size = 0;
+		stream.blocks = 0;
+		atomic_clear(&stream_abort);
+		conn_policy_bulk_begin(conn);
+		k_work_submit(&history_stream_work);
+		break;
+	case HISTORY_OPCODE_ABORT:
+		if (len != ABORT_SIZE) {
+			return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+		}
+		/* Only the central which started the stream can abort it */
+		if (atomic_get(&stream_busy) && stream.conn == conn) {
+			atomic_set(&stream_abort, 1);
+		}
+		break;
+	default:
+		return BT_GATT_ERR(BT_ATT_ERR_NOT_SUPPORTED);
+	}
+
+	return len;
+}
+
+static void fill_chunk(uint16_t size)
+{
+	size_t copy;
+
+	/* Blocks are packed back to back so that every notification but the
+	 * last is full
+	 */
+	while (stream.chunk_size < size) {
+		if (stream.block_offset == stream.block_size) {
+			stream.block_size = history_read_block(
+				&stream.cursor, stream.block,
+				sizeof(stream.block));
+			stream.block_offset = 0;
+			if (stream.block_size == 0) {
+				return;
+			}
+			++stream.blocks;
+		}
+
+		copy = MIN(size - stream.chunk_size,
+			   stream.block_size - stream.block_offset);
+		memcpy(&stream.chunk[stream.chunk_size],
+		       &stream.block[stream.block_offset], copy);
+		stream.chunk_size += copy;
+		stream.block_offset += copy;
+	}
+}
+
+static void finish_stream(uint8_t status)
+{
+	uint8_t response[RESPONSE_SIZE];
+	int rc;
+
+	response[0] = HISTORY_OPCODE_RESPONSE;
+	response[1] = HISTORY_OPCODE_READ_RANGE;
+	response[2] = status;
+	sys_put_le32(stream.blocks, &response[3]);
+
+	rc = bt_gatt_notify(stream.conn, control_point_attr, response,
+			    sizeof(response));
+	if (rc != 0) {
+		LOG_DBG("Response notification failed (err %d)", rc);
+	}
+
+	LOG_DBG("History stream finished, %u blocks, status %u",
+		stream.blocks, status);
+
+	conn_policy_bulk_end(stream.conn);
+	bt_conn_unref(stream.conn);
+	stream.conn = NULL;
+	atomic_clear(&stream_busy);
+}
+
+static void stream_sent(struct bt_conn *conn, void *user_data)
+{
+	k_work_submit(&history_stream_work);
+}
+
+static void stream_retry_handler(struct k_timer *timer)
+{
+	k_work_submit(&history_stream_work);
+}
+
+static void stream_handler(struct k_work *work)
+{
+	struct bt_gatt_notify_params params;
+	uint16_t size;
+	int rc;
+
+	if (!atomic_get(&stream_busy)) {
+		return;
+	}
+
+	size = MIN(bt_gatt_get_mtu(stream.conn) - ATT_NOTIFY_HEADER_SIZE,
+		   sizeof(stream.chunk));
+
+	/* Sends until the stack runs out of buffers, the stream is then
+	 * resumed as notifications complete (or after a short delay if the
+	 * buffers are held by other notifications) so that other work items
+	 * are not held up
+	 */
+	while (true) {
+		if (atomic_get(&stream_abort)) {
+			finish_stream(HISTORY_STATUS_ABORTED);
+			return;
+		}
+
+		fill_chunk(size);
+		if (stream.chunk_size == 0) {
+			finish_stream(HISTORY_STATUS_SUCCESS);
+			return;
+		}
+
+		memset(&params, 0, sizeof(params));
+		params.attr = data_attr;
+		params.data = stream.chunk;
+		params.len = stream.chunk_size;
+		params.func = stream_sent;
+
+		rc = bt_gatt_notify_cb(stream.conn, &params);
+		if (rc == -ENOMEM) {
+			k_timer_start(&history_stream_retry_timer,
+				      K_MSEC(STREAM_RETRY_MS), K_NO_WAIT);
+			return;
+		} else if (rc != 0) {
+			LOG_ERR("History notification failed (err %d)", rc);
+			finish_stream(HISTORY_STATUS_FAILED);
+			return;
+		}
+
+		stream.chunk_size = 0;
+	}
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void history_service_init(void)
+{
+	control_point_attr =
+		bt_gatt_find_by_uuid(history_svc.attrs, history_svc.attr_count,
+				     BT_UUID_HISTORY_CONTROL_POINT);
+	data_attr = bt_gatt_find_by_uuid(history_svc.attrs,
+					 history_svc.attr_count,
+					 BT_UUID_HISTORY_DATA);
+}
@@ -10,6 +10,7 @@
 /******************************************************************************/
 /* Includes                                                                   */
 /******************************************************************************/
+#include <string.h>
 #include <logging/log.h>
 #include <drivers/display.h>
 #include <bluetooth/bluetooth.h>
@@ -21,6 +22,15 @@
 #include <bluetooth/addr.h>
 
 #include "lcd.h"
+#include "acquisition.h"
+#include "chart_reducer.h"
+#include "trace.h"
+#ifdef CONFIG_ESS_DISPLAY_TOUCH
+#include "lcd_touch.h"
+#endif
+#ifdef CONFIG_ESS_DISPLAY_FLUSH
+#include "lcd_flush.h"
+#endif
 
 #ifdef CONFIG_DISPLAY
 
@@ -29,9 +39,19 @@ LOG_MODULE_REGISTER(lcd);
 /******************************************************************************/
 /* Local Constant, Macro and Type Definitions                                 */
 /******************************************************************************/
-#define CHART_NUMBER_OF_POINTS 7
-#define CONNECTION_STRING_MAX_SIZE 96
-#define DISPLAY_INPUT_PERIOD_MS 10
+#define CONNECTION_STRING_HEADER_SIZE 64
+#define CONNECTION_STRING_ADDRESS_SIZE 36
+#define CONNECTION_STRING_MAX_SIZE                                             \
+	(CONNECTION_STRING_HEADER_SIZE +                                       \
+	 (CONNECTION_STRING_ADDRESS_SIZE * CONFIG_BT_MAX_CONN))
+#define ADVERTISING_STRING_MAX_SIZE (CONNECTION_STRING_HEADER_SIZE +          \
+				     CONFIG_BT_DEVICE_NAME_MAX)
+#define UPTIME_STRING_PREFIX "Up "
+#define UPTIME_STRING_SUFFIX " seconds"
+#define UPTIME_STRING_DIGITS_MAX 10
+#define UPTIME_STRING_MAX_SIZE                                                 \
+	(sizeof(UPTIME_STRING_PREFIX) - 1 + UPTIME_STRING_DIGITS_MAX +         \
+	 sizeof(UPTIME_STRING_SUFFIX))
 #define DISPLAY_SCREEN_UPDATE_PERIOD_MS 1000
 #define BLE_ADDRESS_COUNT 1
 #define MS_PER_SECOND 1000
@@ -47,8 +67,11 @@ LOG_MODULE_REGISTER(lcd);
 #define CHART_PADDING_LEFT 50
 #define CHART_PADDING_RIGHT 56
 #define CONTAINER_PADDING 5
-#define PRESSURE_TO_Y_AXIS_DIVISION 100.0
-#define PRESSURE_TO_Y_AXIS_SUBTRACTION 980.0
+#define TEMPERATURE_TO_Y_AXIS_DIVISION 100
+#define HUMIDITY_TO_Y_AXIS_DIVISION 100
+#define PRESSURE_TO_Y_AXIS_DIVISION 1000
+#define PRESSURE_TO_Y_AXIS_SUBTRACTION 980
+#define DEW_POINT_TO_Y_AXIS_DIVISION 100
 #define BLE_ADDRESS_OUTPUT_A 5
 #define BLE_ADDRESS_OUTPUT_B 4
 #define BLE_ADDRESS_OUTPUT_C 3
@@ -56,16 +79,45 @@ LOG_MODULE_REGISTER(lcd);
 #define BLE_ADDRESS_OUTPUT_E 1
 #define BLE_ADDRESS_OUTPUT_F 0
 
+struct remote_device {
+	bool connected;
+	uint8_t type;
+	uint8_t address[sizeof(bt_addr_t)];
+};
+
+enum chart_trace_index {
+	CHART_TRACE_TEMPERATURE = 0,
+	CHART_TRACE_HUMIDITY,
+	CHART_TRACE_PRESSURE,
+	CHART_TRACE_DEW_POINT,
+
+	CHART_TRACE_COUNT
+};
+
+BUILD_ASSERT(CHART_TRACE_COUNT == CHART_REDUCER_SERIES);
+BUILD_ASSERT(sizeof(lv_coord_t) == sizeof(int16_t),
+	     "LVGL draws the reduced points directly");
+
+struct chart_trace {
+	lv_chart_series_t *series;
+	lv_obj_t *checkbox;
+	bool shown;
+};
+
+enum chart_zoom_index {
+	CHART_ZOOM_MINUTE = 0,
+	CHART_ZOOM_HOUR,
+	CHART_ZOOM_DAY,
+
+	CHART_ZOOM_COUNT
+};
+
 /******************************************************************************/
 /* Local Data Definitions                                                     */
 /******************************************************************************/
 static bool lcd_present = false;
 
 static lv_obj_t *ui_chart;
-static lv_chart_series_t *chart_series_temperature;
-static lv_chart_series_t *chart_series_humidity;
-static lv_chart_series_t *chart_series_pressure;
-static lv_chart_series_t *chart_series_dew_point;
 static lv_obj_t *ui_container_main;
 static lv_obj_t *ui_container_graph;
 static lv_obj_t *ui_container_selections;
@@ -75,78 +127,208 @@ static lv_obj_t *ui_check_pressure;
 static lv_obj_t *ui_check_dew_point;
 static lv_obj_t *ui_button_clear;
 static lv_obj_t *ui_text_clear;
+static lv_obj_t *ui_button_zoom;
+static lv_obj_t *ui_text_zoom;
+static lv_obj_t *ui_text_uptime;
 static lv_obj_t *ui_text_status;
 
+/* The labels reference these buffers directly (static text), so updating
+ * them does not allocate from the LVGL heap
+ */
 static char display_string_buffer[CONNECTION_STRING_MAX_SIZE];
+static char display_uptime_buffer[UPTIME_STRING_MAX_SIZE];
+
+/* The local name and identity address do not change once Bluetooth is
+ * enabled, so the advertising text is only formatted once
+ */
+static char display_advertising_buffer[ADVERTISING_STRING_MAX_SIZE];
+static uint32_t display_uptime_seconds = UINT32_MAX;
+
+static struct chart_trace chart_traces[CHART_TRACE_COUNT];
+
+/* Every zoom level is reduced as samples arrive, so switching between them
+ * only changes which points LVGL draws. The head of a level's ring is also
+ * the start point LVGL uses for the circular chart
+ */
+static struct chart_reducer_level chart_levels[CHART_ZOOM_COUNT];
+static enum chart_zoom_index chart_zoom;
+
+static const uint32_t chart_zoom_windows_ms[CHART_ZOOM_COUNT] = {
+	[CHART_ZOOM_MINUTE] = 60 * MSEC_PER_SEC,
+	[CHART_ZOOM_HOUR] = 60 * 60 * MSEC_PER_SEC,
+	[CHART_ZOOM_DAY] = 24 * 60 * 60 * MSEC_PER_SEC,
+};
+
+static const char *const chart_zoom_names[CHART_ZOOM_COUNT] = {
+	[CHART_ZOOM_MINUTE] = "1 min",
+	[CHART_ZOOM_HOUR] = "1 h",
+	[CHART_ZOOM_DAY] = "24 h",
+};
+
+/* Shown in place of hidden series */
+static lv_coord_t chart_blank_points[CONFIG_ESS_DISPLAY_CHART_POINTS];
+static struct sample_ring_reader chart_reader;
+
+/* Indexed by the connection index */
+static struct remote_device remote_devices[CONFIG_BT_MAX_CONN];
+
+/* Set when the status text must be rebuilt on the next display update, this
+ * is only needed when a connection is made or lost
+ */
+static atomic_t display_text_changed;
 
-static int16_t chart_data_buffer_temperature[CHART_NUMBER_OF_POINTS];
-static int16_t chart_data_buffer_humidity[CHART_NUMBER_OF_POINTS];
-static int16_t chart_data_buffer_pressure[CHART_NUMBER_OF_POINTS];
-static int16_t chart_data_buffer_dew_point[CHART_NUMBER_OF_POINTS];
-static uint8_t chart_readings = 0;
+/* Time of the next uptime label update */
+static int64_t display_text_next;
 
-static bool remote_device_connected = false;
-static uint8_t remote_device_type;
-static uint8_t remote_device_address[sizeof(bt_addr_t)];
+/* LVGL tasks which run periodically even when there is nothing to do, they
+ * are turned off whilst the display is idle
+ */
+static lv_task_t *display_refresh_task;
+static lv_task_prio_t display_refresh_prio;
+static bool display_suspended;
+static int64_t display_suspended_at;
 
-static uint16_t display_update_count = 0;
+static struct lcd_stats display_stats;
 
 /******************************************************************************/
 /* Local Function Prototypes                                                  */
 /******************************************************************************/
+static lv_coord_t chart_value(enum chart_trace_index index,
+			      const struct ess_sample *sample);
+static void chart_fill(lv_coord_t *points);
+static void chart_show(struct chart_trace *trace, bool shown);
+static void chart_draw(uint16_t first, uint16_t count);
+static void zoom_event_handler(lv_obj_t *obj, lv_event_t event);
 static void checkbox_event_handler(lv_obj_t *obj, lv_event_t event);
 static void button_event_handler(lv_obj_t *obj, lv_event_t event);
+static size_t format_decimal(char *buffer, uint32_t value);
+static void update_lcd_uptime(uint32_t seconds);
+static void format_advertising_text(void);
+static void display_wakeup(void);
+static bool display_is_idle(void);
+static void display_tasks_resume(void);
+static void display_tasks_suspend(void);
 static void ess_lcd_display_update_handler(struct k_work *work);
 static void ess_lcd_display_update_timer_handler(struct k_timer *dummy);
+static void ess_lcd_graph_update_handler(struct k_work *work);
 
 K_WORK_DEFINE(ess_lcd_display_update, ess_lcd_display_update_handler);
+K_WORK_DEFINE(ess_lcd_graph_update, ess_lcd_graph_update_handler);
 K_TIMER_DEFINE(ess_lcd_display_update_timer,
 	       ess_lcd_display_update_timer_handler, NULL);
 
+static struct acquisition_consumer chart_consumer = {
+	.work = &ess_lcd_graph_update,
+};
+
 /******************************************************************************/
 /* Local Function Definitions                                                 */
 /******************************************************************************/
-static void checkbox_event_handler(lv_obj_t *obj, lv_event_t event)
+static lv_coord_t chart_value(enum chart_trace_index index,
+			      const struct ess_sample *sample)
 {
-	/* Only process events where a checkbox has been ticked or unticked */
-	if (event == LV_EVENT_VALUE_CHANGED) {
-		lv_chart_series_t *series = NULL;
-		int16_t *chart_data = NULL;
-
-		if (obj == ui_check_temperature) {
-			series = chart_series_temperature;
-			chart_data = chart_data_buffer_temperature;
-		} else if (obj == ui_check_humidity) {
-			series = chart_series_humidity;
-			chart_data = chart_data_buffer_humidity;
-		} else if (obj == ui_check_pressure) {
-			series = chart_series_pressure;
-			chart_data = chart_data_buffer_pressure;
-		} else if (obj == ui_check_dew_point) {
-			series = chart_series_dew_point;
-			chart_data = chart_data_buffer_dew_point;
+	/* Scales a sample value to the chart Y axis of the series */
+	switch (index) {
+	case CHART_TRACE_TEMPERATURE:
+		return sample->temperature / TEMPERATURE_TO_Y_AXIS_DIVISION;
+	case CHART_TRACE_HUMIDITY:
+		return sample->humidity / HUMIDITY_TO_Y_AXIS_DIVISION;
+	case CHART_TRACE_PRESSURE:
+		return (lv_coord_t)(sample->pressure /
+				    PRESSURE_TO_Y_AXIS_DIVISION) -
+		       PRESSURE_TO_Y_AXIS_SUBTRACTION;
+	case CHART_TRACE_DEW_POINT:
+	default:
+		return sample->derived[DERIVED_METRIC_DEW_POINT] /
+		       DEW_POINT_TO_Y_AXIS_DIVISION;
+	}
+}
+
+static void chart_fill(lv_coord_t *points)
+{
+	size_t i;
+
+	for (i = 0; i < CONFIG_ESS_DISPLAY_CHART_POINTS; ++i) {
+		points[i] = LV_CHART_POINT_DEF;
+	}
+}
+
+static void chart_show(struct chart_trace *trace, bool shown)
+{
+	/* LVGL draws from whichever array is assigned, so hiding or showing
+	 * a series only swaps the array, no points are copied or replayed
+	 */
+	struct chart_reducer_level *level = &chart_levels[chart_zoom];
+	size_t index = trace - chart_traces;
+
+	trace->shown = shown;
+	lv_chart_set_ext_array(ui_chart, trace->series,
+			       (shown ? level->points[index] :
+					chart_blank_points),
+			       level->point_count);
+	lv_chart_set_x_start_point(ui_chart, trace->series, level->head);
+}
+
+static void chart_draw(uint16_t first, uint16_t count)
+{
+	struct chart_reducer_level *level = &chart_levels[chart_zoom];
+	uint16_t point;
+	size_t i;
+
+	if (count >= level->point_count) {
+		/* The whole ring has been rewritten, moving the start point
+		 * does not invalidate the chart so it is redrawn explicitly
+		 */
+		for (i = 0; i < ARRAY_SIZE(chart_traces); ++i) {
+			lv_chart_set_x_start_point(ui_chart,
+						   chart_traces[i].series,
+						   level->head);
 		}
+		lv_chart_refresh(ui_chart);
+		return;
+	}
 
-		if (series != NULL) {
-			if (lv_checkbox_is_checked(obj)) {
-				/* Checkbox was ticked, add the data to the
-				 * graph
-				 */
-				uint8_t i =
-					CHART_NUMBER_OF_POINTS - chart_readings;
-				while (i < CHART_NUMBER_OF_POINTS) {
-					lv_chart_set_next(ui_chart, series,
-							  chart_data[i]);
-					++i;
-				}
-			} else {
-				/* Checkbox was unticked, clear the series
-				 * data
-				 */
-				lv_chart_clear_series(ui_chart, series);
+	/* The points are already in the ring, passing them through LVGL
+	 * advances the start point and invalidates only the lines around them
+	 */
+	for (point = first; count > 0; --count) {
+		for (i = 0; i < ARRAY_SIZE(chart_traces); ++i) {
+			if (chart_traces[i].shown) {
+				lv_chart_set_next(ui_chart,
+						  chart_traces[i].series,
+						  level->points[i][point]);
 			}
+		}
+		point = (point + 1) % level->point_count;
+	}
+}
+
+static void zoom_event_handler(lv_obj_t *obj, lv_event_t event)
+{
+	size_t i;
+
+	/* Each press moves to the next longer window, wrapping around */
+	if (event == LV_EVENT_CLICKED) {
+		chart_zoom = (chart_zoom + 1) % CHART_ZOOM_COUNT;
+		lv_label_set_text(ui_text_zoom, chart_zoom_names[chart_zoom]);
 
-			lv_chart_refresh(ui_chart);
+		for (i = 0; i < ARRAY_SIZE(chart_traces); ++i) {
+			chart_show(&chart_traces[i], chart_traces[i].shown);
+		}
+	}
+}
+
+static void checkbox_event_handler(lv_obj_t *obj, lv_event_t event)
+{
+	size_t i;
+
+	/* Only process events where a checkbox has been ticked or unticked */
+	if (event == LV_EVENT_VALUE_CHANGED) {
+		for (i = 0; i < ARRAY_SIZE(chart_traces); ++i) {
+			if (chart_traces[i].checkbox == obj) {
+				chart_show(&chart_traces[i],
+					   lv_checkbox_is_checked(obj));
+			}
 		}
 	}
 }
@@ -155,38 +337,183 @@ static void button_event_handler(lv_obj_t *obj, lv_event_t event)
 {
 	/* Only process events where a button has been pressed */
 	if (event == LV_EVENT_CLICKED) {
-		/* Clear all the buffered data and remove the data from the
-		 * graph
+		/* Remove all the data from the graph, including hidden
+		 * series
 		 */
-		memset(chart_data_buffer_temperature, 0,
-		       CHART_NUMBER_OF_POINTS);
-		memset(chart_data_buffer_humidity, 0, CHART_NUMBER_OF_POINTS);
-		memset(chart_data_buffer_pressure, 0, CHART_NUMBER_OF_POINTS);
-		memset(chart_data_buffer_dew_point, 0, CHART_NUMBER_OF_POINTS);
-		chart_readings = 0;
-
-		lv_chart_clear_series(ui_chart, chart_series_temperature);
-		lv_chart_clear_series(ui_chart, chart_series_humidity);
-		lv_chart_clear_series(ui_chart, chart_series_pressure);
-		lv_chart_clear_series(ui_chart, chart_series_dew_point);
+		size_t i;
+
+		for (i = 0; i < ARRAY_SIZE(chart_levels); ++i) {
+			chart_reducer_clear(&chart_levels[i]);
+		}
+		for (i = 0; i < ARRAY_SIZE(chart_traces); ++i) {
+			lv_chart_set_x_start_point(ui_chart,
+						   chart_traces[i].series, 0);
+		}
 
 		lv_chart_refresh(ui_chart);
 	}
 }
 
+static size_t format_decimal(char *buffer, uint32_t value)
+{
+	char digits[UPTIME_STRING_DIGITS_MAX];
+	size_t count = 0;
+	size_t i;
+
+	do {
+		digits[count++] = '0' + (value % 10);
+		value /= 10;
+	} while (value > 0);
+
+	for (i = 0; i < count; ++i) {
+		buffer[i] = digits[count - i - 1];
+	}
+
+	return count;
+}
+
+static void update_lcd_uptime(uint32_t seconds)
+{
+	size_t length = sizeof(UPTIME_STRING_PREFIX) - 1;
+
+	/* The timer can fire slightly early, in which case the label would
+	 * be invalidated for the same text
+	 */
+	if (seconds == display_uptime_seconds) {
+		return;
+	}
+	display_uptime_seconds = seconds;
+
+	memcpy(display_uptime_buffer, UPTIME_STRING_PREFIX, length);
+	length += format_decimal(&display_uptime_buffer[length], seconds);
+	memcpy(&display_uptime_buffer[length], UPTIME_STRING_SUFFIX,
+	       sizeof(UPTIME_STRING_SUFFIX));
+
+	lv_label_set_text_static(ui_text_uptime, display_uptime_buffer);
+}
+
+static void format_advertising_text(void)
+{
+	bt_addr_le_t ble_address_local;
+	size_t ble_address_count = BLE_ADDRESS_COUNT;
+
+	/* Output the device name being advertised and the BLE address of the
+	 * advert
+	 */
+	bt_id_get(&ble_address_local, &ble_address_count);
+	snprintf(display_advertising_buffer,
+		 sizeof(display_advertising_buffer),
+		 "Advertising\nName: %s\n"
+		 "Address: %02x %02x%02x%02x%02x%02x%02x",
+		 bt_get_name(), ble_address_local.type,
+		 ble_address_local.a.val[BLE_ADDRESS_OUTPUT_A],
+		 ble_address_local.a.val[BLE_ADDRESS_OUTPUT_B],
+		 ble_address_local.a.val[BLE_ADDRESS_OUTPUT_C],
+		 ble_address_local.a.val[BLE_ADDRESS_OUTPUT_D],
+		 ble_address_local.a.val[BLE_ADDRESS_OUTPUT_E],
+		 ble_address_local.a.val[BLE_ADDRESS_OUTPUT_F]);
+}
+
+static void display_wakeup(void)
+{
+	/* Called for touch events, new samples and connection changes */
+	k_work_submit(&ess_lcd_display_update);
+}
+
+static bool display_is_idle(void)
+{
+	lv_disp_t *disp = lv_disp_get_default();
+
+#ifdef CONFIG_ESS_DISPLAY_TOUCH
+	if (lcd_touch_is_active()) {
+		return false;
+	}
+#endif
+
+	/* Nothing left to draw and no style transitions running */
+	return (disp->inv_p == 0 && lv_anim_count_running() == 0);
+}
+
+static void display_tasks_resume(void)
+{
+	lv_indev_t *indev = NULL;
+
+	if (!display_suspended) {
+		return;
+	}
+
+	display_stats.idle_ms +=
+		(uint32_t)(k_uptime_get() - display_suspended_at);
+	display_suspended = false;
+
+	lv_task_set_prio(display_refresh_task, display_refresh_prio);
+	lv_task_ready(display_refresh_task);
+
+	while ((indev = lv_indev_get_next(indev)) != NULL) {
+		lv_task_set_prio(indev->driver.read_task, LV_TASK_PRIO_HIGH);
+		lv_task_ready(indev->driver.read_task);
+	}
+}
+
+static void display_tasks_suspend(void)
+{
+	lv_indev_t *indev = NULL;
+
+	if (display_suspended) {
+		return;
+	}
+
+	display_suspended_at = k_uptime_get();
+	display_suspended = true;
+
+	lv_task_set_prio(display_refresh_task, LV_TASK_PRIO_OFF);
+
+	while ((indev = lv_indev_get_next(indev)) != NULL) {
+		lv_task_set_prio(indev->driver.read_task, LV_TASK_PRIO_OFF);
+	}
+}
+
 static void ess_lcd_display_update_handler(struct k_work *work)
 {
-	/* Triggers every 10ms to handle display updating and input handling */
-	++display_update_count;
+	uint32_t start = k_cycle_get_32();
+	int64_t now = k_uptime_get();
+	uint32_t trace_start;
+	uint32_t wait;
+
+	++display_stats.wakeups;
+
+	/* Only the uptime changes once a second, the rest of the status text
+	 * is rebuilt when a connection is made or lost
+	 */
+	if (now >= display_text_next) {
+		update_lcd_uptime((uint32_t)(now / MS_PER_SECOND));
+		display_text_next = now + DISPLAY_SCREEN_UPDATE_PERIOD_MS;
+	}
 
-	if (display_update_count >=
-	    (DISPLAY_SCREEN_UPDATE_PERIOD_MS / DISPLAY_INPUT_PERIOD_MS)) {
-		/* Only update text roughly once a second */
+	if (atomic_cas(&display_text_changed, 1, 0)) {
 		update_lcd_text();
-		display_update_count = 0;
 	}
 
-	lv_task_handler();
+	display_tasks_resume();
+	trace_start = trace_begin();
+	wait = lv_task_handler();
+
+	/* Once everything has been drawn and input has been released, the
+	 * refresh and input tasks are turned off so that the only deadlines
+	 * left are those of LVGL tasks with real work (e.g. animations)
+	 */
+	if (display_is_idle()) {
+		display_tasks_suspend();
+		wait = lv_task_handler();
+	}
+	trace_end(TRACE_STAGE_LCD_TASKS, trace_start);
+
+	now = k_uptime_get();
+	wait = MIN(wait, (uint32_t)MAX(display_text_next - now, 0));
+	k_timer_start(&ess_lcd_display_update_timer, K_MSEC(wait), K_NO_WAIT);
+
+	display_stats.busy_us +=
+		(uint32_t)k_cyc_to_us_floor64(k_cycle_get_32() - start);
 }
 
 static void ess_lcd_display_update_timer_handler(struct k_timer *dummy)
@@ -194,12 +521,27 @@ static void ess_lcd_display_update_timer_handler(struct k_timer *dummy)
 	k_work_submit(&ess_lcd_display_update);
 }
 
+static void ess_lcd_graph_update_handler(struct k_work *work)
+{
+	struct ess_sample sample;
+	uint32_t start;
+
+	while (sample_ring_read(&chart_reader, &sample) == 0) {
+		start = trace_begin();
+		update_lcd_graph(&sample);
+		trace_end(TRACE_STAGE_LCD_GRAPH, start);
+	}
+
+	display_wakeup();
+}
+
 /******************************************************************************/
 /* Global Function Definitions                                                */
 /******************************************************************************/
 void setup_lcd(bool error, char *error_string)
 {
 	const struct device *display_dev;
+	size_t i;
 
 	display_dev = device_get_binding(CONFIG_LVGL_DISPLAY_DEV_NAME);
 
@@ -236,12 +578,6 @@ void setup_lcd(bool error, char *error_string)
 		return;
 	}
 
-	/* Reset buffered data */
-	memset(chart_data_buffer_temperature, 0, CHART_NUMBER_OF_POINTS);
-	memset(chart_data_buffer_humidity, 0, CHART_NUMBER_OF_POINTS);
-	memset(chart_data_buffer_pressure, 0, CHART_NUMBER_OF_POINTS);
-	memset(chart_data_buffer_dew_point, 0, CHART_NUMBER_OF_POINTS);
-
 	/* Create all the UI objects and set the style information. Containers
 	 * are used to group objects and position them correctly. The main UI
 	 * has a container into which all the objects are placed, there is a
@@ -298,10 +634,14 @@ void setup_lcd(bool error, char *error_string)
 	lv_obj_align(ui_chart, NULL, LV_ALIGN_IN_TOP_MID, 0, 0);
 	lv_chart_set_type(ui_chart, LV_CHART_TYPE_LINE);
 
-	lv_chart_set_point_count(ui_chart, CHART_NUMBER_OF_POINTS);
+	lv_chart_set_point_count(ui_chart, CONFIG_ESS_DISPLAY_CHART_POINTS);
+
+	/* New points overwrite the oldest in place, so only the lines either
+	 * side of the new point are invalidated instead of the whole chart
+	 * being shifted and redrawn
+	 */
+	lv_chart_set_update_mode(ui_chart, LV_CHART_UPDATE_MODE_CIRCULAR);
 
-	lv_chart_set_x_tick_texts(ui_chart, "old\nnew", 1,
-				  LV_CHART_AXIS_DRAW_LAST_TICK);
 	lv_chart_set_y_tick_texts(ui_chart, "100\n80\n60\n40\n20\n0\n-20", 1,
 				  LV_CHART_AXIS_DRAW_LAST_TICK);
 
@@ -319,10 +659,14 @@ void setup_lcd(bool error, char *error_string)
 	lv_obj_set_style_local_pad_right(ui_chart, LV_OBJ_PART_MAIN,
 					 LV_STATE_DEFAULT, CHART_PADDING_RIGHT);
 
-	chart_series_temperature = lv_chart_add_series(ui_chart, LV_COLOR_RED);
-	chart_series_humidity = lv_chart_add_series(ui_chart, LV_COLOR_YELLOW);
-	chart_series_pressure = lv_chart_add_series(ui_chart, LV_COLOR_GREEN);
-	chart_series_dew_point = lv_chart_add_series(ui_chart, LV_COLOR_BLUE);
+	chart_traces[CHART_TRACE_TEMPERATURE].series =
+		lv_chart_add_series(ui_chart, LV_COLOR_RED);
+	chart_traces[CHART_TRACE_HUMIDITY].series =
+		lv_chart_add_series(ui_chart, LV_COLOR_YELLOW);
+	chart_traces[CHART_TRACE_PRESSURE].series =
+		lv_chart_add_series(ui_chart, LV_COLOR_GREEN);
+	chart_traces[CHART_TRACE_DEW_POINT].series =
+		lv_chart_add_series(ui_chart, LV_COLOR_BLUE);
 
 	ui_check_temperature =
 		lv_checkbox_create(ui_container_selections, NULL);
@@ -373,6 +717,28 @@ void setup_lcd(bool error, char *error_string)
 					    LV_CHECKBOX_PART_BULLET,
 					    LV_STATE_DEFAULT, LV_COLOR_BLUE);
 
+	chart_traces[CHART_TRACE_TEMPERATURE].checkbox = ui_check_temperature;
+	chart_traces[CHART_TRACE_HUMIDITY].checkbox = ui_check_humidity;
+	chart_traces[CHART_TRACE_PRESSURE].checkbox = ui_check_pressure;
+	chart_traces[CHART_TRACE_DEW_POINT].checkbox = ui_check_dew_point;
+
+	chart_fill(chart_blank_points);
+	for (i = 0; i < ARRAY_SIZE(chart_levels); ++i) {
+		chart_reducer_init(&chart_levels[i], chart_zoom_windows_ms[i],
+				   CONFIG_ESS_SAMPLE_PERIOD_MIN_MS,
+				   LV_CHART_POINT_DEF);
+	}
+	for (i = 0; i < ARRAY_SIZE(chart_traces); ++i) {
+		chart_show(&chart_traces[i], true);
+	}
+
+	ui_button_zoom = lv_btn_create(ui_container_selections, NULL);
+	lv_obj_align(ui_button_zoom, NULL, LV_ALIGN_CENTER, 0, 0);
+	lv_btn_set_fit(ui_button_zoom, LV_FIT_TIGHT);
+	lv_obj_set_event_cb(ui_button_zoom, zoom_event_handler);
+	ui_text_zoom = lv_label_create(ui_button_zoom, NULL);
+	lv_label_set_text(ui_text_zoom, chart_zoom_names[chart_zoom]);
+
 	ui_button_clear = lv_btn_create(ui_container_main, NULL);
 	lv_obj_align(ui_button_clear, NULL, LV_ALIGN_CENTER, 0, 0);
 	lv_btn_set_fit(ui_button_clear, LV_FIT_TIGHT);
@@ -380,19 +746,43 @@ void setup_lcd(bool error, char *error_string)
 	ui_text_clear = lv_label_create(ui_button_clear, NULL);
 	lv_label_set_text(ui_text_clear, "Clear");
 
-	ui_text_status = lv_label_create(ui_container_main, NULL);
+	/* Fixed width so that a change in the number of uptime digits does
+	 * not realign the other objects in the container
+	 */
+	ui_text_uptime = lv_label_create(ui_container_main, NULL);
+	lv_label_set_long_mode(ui_text_uptime, LV_LABEL_LONG_CROP);
+	lv_label_set_align(ui_text_uptime, LV_LABEL_ALIGN_CENTER);
+	lv_obj_set_width(ui_text_uptime, CHART_WIDTH);
+	update_lcd_uptime((uint32_t)(k_uptime_get() / MS_PER_SECOND));
 
-	lv_label_set_text(ui_text_status, display_string_buffer);
+	ui_text_status = lv_label_create(ui_container_main, NULL);
 	lv_obj_align(ui_text_status, NULL, LV_ALIGN_CENTER, 0, 0);
 
+	format_advertising_text();
 	update_lcd_text();
 
 	display_blanking_off(display_dev);
-	lv_task_handler();
 
-	k_timer_start(&ess_lcd_display_update_timer,
-		      K_MSEC(DISPLAY_INPUT_PERIOD_MS),
-		      K_MSEC(DISPLAY_INPUT_PERIOD_MS));
+#ifdef CONFIG_ESS_DISPLAY_FLUSH
+	if (lcd_flush_init() != 0) {
+		LOG_WRN("Display transfers are not overlapped with rendering");
+	}
+#endif
+
+#ifdef CONFIG_ESS_DISPLAY_TOUCH
+	if (lcd_touch_init(display_wakeup) != 0) {
+		LOG_WRN("Touch input is not available");
+	}
+#endif
+
+	display_refresh_task = lv_disp_get_default()->refr_task;
+	display_refresh_prio = display_refresh_task->prio;
+	display_text_next = k_uptime_get() + DISPLAY_SCREEN_UPDATE_PERIOD_MS;
+
+	k_work_submit(&ess_lcd_display_update);
+
+	sample_ring_reader_init(&chart_reader);
+	acquisition_register_consumer(&chart_consumer);
 }
 
 bool is_lcd_present(void)
@@ -400,122 +790,115 @@ bool is_lcd_present(void)
 	return lcd_present;
 }
 
-void update_lcd_graph(float temperature, float humidity, float pressure,
-		      float dew_point)
+void update_lcd_graph(const struct ess_sample *sample)
 {
-	/* Move all the buffered data up by a position */
-	memmove(chart_data_buffer_temperature,
-		&chart_data_buffer_temperature[1],
-		sizeof(chart_data_buffer_temperature) -
-			sizeof(chart_data_buffer_temperature[0]));
-	memmove(chart_data_buffer_humidity, &chart_data_buffer_temperature[1],
-		sizeof(chart_data_buffer_humidity) -
-			sizeof(chart_data_buffer_temperature[0]));
-	memmove(chart_data_buffer_pressure, &chart_data_buffer_temperature[1],
-		sizeof(chart_data_buffer_pressure) -
-			sizeof(chart_data_buffer_temperature[0]));
-	memmove(chart_data_buffer_dew_point, &chart_data_buffer_temperature[1],
-		sizeof(chart_data_buffer_dew_point) -
-			sizeof(chart_data_buffer_temperature[0]));
-
-	/* Append the newest data to the end of the array */
-	chart_data_buffer_temperature[CHART_NUMBER_OF_POINTS - 1] =
-		(int16_t)temperature;
-	chart_data_buffer_humidity[CHART_NUMBER_OF_POINTS - 1] =
-		(int16_t)humidity;
-	chart_data_buffer_pressure[CHART_NUMBER_OF_POINTS - 1] =
-		(int16_t)((pressure / PRESSURE_TO_Y_AXIS_DIVISION) -
-			  PRESSURE_TO_Y_AXIS_SUBTRACTION);
-	chart_data_buffer_dew_point[CHART_NUMBER_OF_POINTS - 1] =
-		(int16_t)dew_point;
-
-	if (chart_readings < CHART_NUMBER_OF_POINTS) {
-		++chart_readings;
-	}
-
-	/* Only add the data to the graph if the respective checkbox is 
-	 * ticked
-	 */
-	if (lv_checkbox_is_checked(ui_check_temperature)) {
-		lv_chart_set_next(
-			ui_chart, chart_series_temperature,
-			chart_data_buffer_temperature[CHART_NUMBER_OF_POINTS -
-						      1]);
-	}
-
-	if (lv_checkbox_is_checked(ui_check_humidity)) {
-		lv_chart_set_next(
-			ui_chart, chart_series_humidity,
-			chart_data_buffer_humidity[CHART_NUMBER_OF_POINTS - 1]);
-	}
+	int16_t values[CHART_TRACE_COUNT];
+	uint16_t first;
+	uint16_t count;
+	size_t i;
 
-	if (lv_checkbox_is_checked(ui_check_pressure)) {
-		lv_chart_set_next(
-			ui_chart, chart_series_pressure,
-			chart_data_buffer_pressure[CHART_NUMBER_OF_POINTS - 1]);
+	for (i = 0; i < ARRAY_SIZE(values); ++i) {
+		values[i] = chart_value(i, sample);
 	}
 
-	if (lv_checkbox_is_checked(ui_check_dew_point)) {
-		lv_chart_set_next(
-			ui_chart, chart_series_dew_point,
-			chart_data_buffer_dew_point[CHART_NUMBER_OF_POINTS - 1]);
+	/* O(1) per sample and level, points are only written when a bucket
+	 * of the level closes and only those of the shown level are drawn
+	 */
+	for (i = 0; i < ARRAY_SIZE(chart_levels); ++i) {
+		first = chart_levels[i].head;
+		count = chart_reducer_add(&chart_levels[i], sample->timestamp,
+					  values);
+		if (i == chart_zoom && count > 0) {
+			chart_draw(first, count);
+		}
 	}
 }
 
 void update_lcd_text(void)
 {
-	uint32_t uptime_seconds = (uint32_t)(k_uptime_get() / MS_PER_SECOND);
+	const struct remote_device *remote;
+	const char *text;
+	uint8_t connections = 0;
+	size_t length;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(remote_devices); ++i) {
+		if (remote_devices[i].connected) {
+			++connections;
+		}
+	}
 
-	if (remote_device_connected) {
-		/* In a connection, output the uptime and the remote BLE address
-		 * of the connected device
+	if (connections > 0) {
+		/* In a connection, output the remote BLE address of each
+		 * connected device
 		 */
-		sprintf(display_string_buffer,
-			"Up %d seconds, connected\n"
-			"Remote Address: %02x %02x%02x%02x%02x%02x%02x",
-			uptime_seconds, remote_device_type,
-			remote_device_address[BLE_ADDRESS_OUTPUT_A],
-			remote_device_address[BLE_ADDRESS_OUTPUT_B],
-			remote_device_address[BLE_ADDRESS_OUTPUT_C],
-			remote_device_address[BLE_ADDRESS_OUTPUT_D],
-			remote_device_address[BLE_ADDRESS_OUTPUT_E],
-			remote_device_address[BLE_ADDRESS_OUTPUT_F]);
+		length = snprintf(display_string_buffer,
+				  sizeof(display_string_buffer),
+				  "%d connected", connections);
+
+		for (i = 0; i < ARRAY_SIZE(remote_devices) &&
+			    length < sizeof(display_string_buffer);
+		     ++i) {
+			remote = &remote_devices[i];
+			if (!remote->connected) {
+				continue;
+			}
+
+			length += snprintf(
+				&display_string_buffer[length],
+				sizeof(display_string_buffer) - length,
+				"\nRemote Address: %02x "
+				"%02x%02x%02x%02x%02x%02x",
+				remote->type,
+				remote->address[BLE_ADDRESS_OUTPUT_A],
+				remote->address[BLE_ADDRESS_OUTPUT_B],
+				remote->address[BLE_ADDRESS_OUTPUT_C],
+				remote->address[BLE_ADDRESS_OUTPUT_D],
+				remote->address[BLE_ADDRESS_OUTPUT_E],
+				remote->address[BLE_ADDRESS_OUTPUT_F]);
+		}
+
+		text = display_string_buffer;
 	} else {
-		/* In advertising, output the uptime, the device name being
-		 * advertised and the BLE address of the advert
-		 */
-		bt_addr_le_t ble_address_local;
-		size_t ble_address_count = BLE_ADDRESS_COUNT;
-		bt_id_get(&ble_address_local, &ble_address_count);
-		sprintf(display_string_buffer,
-			"Up %d seconds, advertising\n"
-			"Name: %s\nAddress: %02x %02x%02x%02x%02x%02x%02x",
-			uptime_seconds, bt_get_name(), ble_address_local.type,
-			ble_address_local.a.val[BLE_ADDRESS_OUTPUT_A],
-			ble_address_local.a.val[BLE_ADDRESS_OUTPUT_B],
-			ble_address_local.a.val[BLE_ADDRESS_OUTPUT_C],
-			ble_address_local.a.val[BLE_ADDRESS_OUTPUT_D],
-			ble_address_local.a.val[BLE_ADDRESS_OUTPUT_E],
-			ble_address_local.a.val[BLE_ADDRESS_OUTPUT_F]);
+		text = display_advertising_buffer;
 	}
 
-	lv_label_set_text(ui_text_status, display_string_buffer);
+	lv_label_set_text_static(ui_text_status, text);
 }
 
-void update_lcd_connected_address(bool connected, uint8_t type,
-				  const uint8_t *address)
+void update_lcd_connected_address(uint8_t index, bool connected,
+				  uint8_t type, const uint8_t *address)
 {
-	/* Update the local buffer if there is a remote device connected and
-	 * what the BLE address is
+	struct remote_device *remote;
+
+	if (index >= ARRAY_SIZE(remote_devices)) {
+		return;
+	}
+
+	/* Update the local buffer if there is a remote device connected on
+	 * this connection and what the BLE address is
 	 */
-	remote_device_connected = connected;
+	remote = &remote_devices[index];
+	remote->connected = connected;
 	if (connected == true) {
-		remote_device_type = type;
-		memcpy(remote_device_address, address,
-		       sizeof(remote_device_address));
+		remote->type = type;
+		memcpy(remote->address, address, sizeof(remote->address));
 	}
 
-	update_lcd_text();
+	/* Called from the Bluetooth thread, LVGL is only used from the display
+	 * work so the text is rebuilt there
+	 */
+	atomic_set(&display_text_changed, 1);
+	display_wakeup();
+}
+
+void lcd_get_stats(struct lcd_stats *stats)
+{
+	*stats = display_stats;
+	if (display_suspended) {
+		stats->idle_ms +=
+			(uint32_t)(k_uptime_get() - display_suspended_at);
+	}
 }
 
 #endif
@@ -0,0 +1,145 @@
+/**
+ * @file lcd_flush.c
+ * @brief Flushes rendered LVGL stripes to the display from a separate
+ * thread, so the SPI transfer of one stripe overlaps rendering of the next
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <device.h>
+#include <logging/log.h>
+#include <drivers/display.h>
+#include <lvgl.h>
+
+#include "lcd_flush.h"
+
+LOG_MODULE_REGISTER(lcd_flush);
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define BYTES_PER_PIXEL 2
+
+BUILD_ASSERT(CONFIG_LVGL_BITS_PER_PIXEL == 16,
+	     "Only 16 bit colour displays are supported");
+
+/* Stripe handed over from LVGL, only one is in flight at a time as LVGL
+ * waits for the previous flush before starting the next
+ */
+struct lcd_flush_request {
+	lv_disp_drv_t *drv;
+	lv_area_t area;
+	lv_color_t *buffer;
+};
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static void flush_cb(lv_disp_drv_t *drv, const lv_area_t *area,
+		     lv_color_t *buffer);
+static void wait_cb(lv_disp_drv_t *drv);
+static void flush_thread(void *p1, void *p2, void *p3);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+K_SEM_DEFINE(flush_pending, 0, 1);
+K_SEM_DEFINE(flush_done, 0, 1);
+
+K_THREAD_DEFINE(lcd_flush_tid, CONFIG_ESS_DISPLAY_FLUSH_STACK_SIZE,
+		flush_thread, NULL, NULL, NULL,
+		CONFIG_ESS_DISPLAY_FLUSH_THREAD_PRIORITY, 0, 0);
+
+static struct lcd_flush_request flush_request;
+static struct lcd_flush_stats flush_stats;
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static void flush_cb(lv_disp_drv_t *drv, const lv_area_t *area,
+		     lv_color_t *buffer)
+{
+	flush_request.drv = drv;
+	flush_request.area = *area;
+	flush_request.buffer = buffer;
+
+	k_sem_reset(&flush_done);
+	k_sem_give(&flush_pending);
+}
+
+static void wait_cb(lv_disp_drv_t *drv)
+{
+	uint32_t start = k_cycle_get_32();
+
+	/* Called in a loop by LVGL until the flush is ready, sleeping here
+	 * lets the flush thread and anything else run instead of spinning
+	 */
+	k_sem_take(&flush_done, K_MSEC(CONFIG_ESS_DISPLAY_FLUSH_TIMEOUT_MS));
+
+	flush_stats.wait_us +=
+		(uint32_t)k_cyc_to_us_floor64(k_cycle_get_32() - start);
+}
+
+static void flush_thread(void *p1, void *p2, void *p3)
+{
+	struct display_buffer_descriptor desc;
+	const struct device *display_dev;
+	uint32_t start;
+	uint16_t width;
+	uint16_t height;
+
+	while (1) {
+		k_sem_take(&flush_pending, K_FOREVER);
+
+		width = lv_area_get_width(&flush_request.area);
+		height = lv_area_get_height(&flush_request.area);
+		desc.buf_size = width * height * BYTES_PER_PIXEL;
+		desc.width = width;
+		desc.pitch = width;
+		desc.height = height;
+
+		/* The display is written with SPI DMA, this thread sleeps
+		 * until the transfer completes whilst LVGL renders the next
+		 * stripe into the other buffer
+		 */
+		display_dev = flush_request.drv->user_data;
+		start = k_cycle_get_32();
+		display_write(display_dev, flush_request.area.x1,
+			      flush_request.area.y1, &desc,
+			      flush_request.buffer);
+		flush_stats.bus_us += (uint32_t)k_cyc_to_us_floor64(
+			k_cycle_get_32() - start);
+		++flush_stats.stripes;
+
+		lv_disp_flush_ready(flush_request.drv);
+		k_sem_give(&flush_done);
+	}
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+int lcd_flush_init(void)
+{
+	lv_disp_t *disp = lv_disp_get_default();
+
+	if (disp == NULL || disp->driver.user_data == NULL) {
+		return -ENODEV;
+	}
+
+	disp->driver.flush_cb = flush_cb;
+	disp->driver.wait_cb = wait_cb;
+
+	return 0;
+}
+
+void lcd_flush_get_stats(struct lcd_flush_stats *stats)
+{
+	*stats = flush_stats;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file lcd_touch.c
+ * @brief LVGL pointer input from the touch controller, the display loop is
+ * woken from the touch interrupt instead of polling for input
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <device.h>
+#include <logging/log.h>
+#include <drivers/display.h>
+#include <drivers/kscan.h>
+#include <lvgl.h>
+
+#include "lcd_touch.h"
+
+LOG_MODULE_REGISTER(lcd_touch);
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static void touch_callback(const struct device *dev, uint32_t row,
+			   uint32_t column, bool pressed);
+static bool touch_read(lv_indev_drv_t *drv, lv_indev_data_t *data);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+K_MSGQ_DEFINE(touch_events, sizeof(lv_indev_data_t),
+	      CONFIG_ESS_DISPLAY_TOUCH_QUEUE_SIZE, 4);
+
+static lcd_touch_wakeup_t touch_wakeup;
+static struct display_capabilities touch_display_caps;
+
+/* Last state returned to LVGL, repeated when no new events are queued */
+static lv_indev_data_t touch_state = {
+	.state = LV_INDEV_STATE_REL,
+};
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static void touch_callback(const struct device *dev, uint32_t row,
+			   uint32_t column, bool pressed)
+{
+	lv_indev_data_t data = {
+		.point.x = column,
+		.point.y = row,
+		.state = (pressed ? LV_INDEV_STATE_PR : LV_INDEV_STATE_REL),
+	};
+	lv_coord_t swap;
+
+	if (IS_ENABLED(CONFIG_ESS_DISPLAY_TOUCH_SWAP_XY)) {
+		swap = data.point.x;
+		data.point.x = data.point.y;
+		data.point.y = swap;
+	}
+
+	if (IS_ENABLED(CONFIG_ESS_DISPLAY_TOUCH_INVERT_X)) {
+		data.point.x = touch_display_caps.x_resolution - data.point.x;
+	}
+
+	if (IS_ENABLED(CONFIG_ESS_DISPLAY_TOUCH_INVERT_Y)) {
+		data.point.y = touch_display_caps.y_resolution - data.point.y;
+	}
+
+	if (k_msgq_put(&touch_events, &data, K_NO_WAIT) != 0) {
+		LOG_DBG("Touch event dropped");
+	}
+
+	touch_wakeup();
+}
+
+static bool touch_read(lv_indev_drv_t *drv, lv_indev_data_t *data)
+{
+	k_msgq_get(&touch_events, &touch_state, K_NO_WAIT);
+	*data = touch_state;
+
+	/* LVGL reads again straight away whilst more events are queued */
+	return (k_msgq_num_used_get(&touch_events) > 0);
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+int lcd_touch_init(lcd_touch_wakeup_t wakeup)
+{
+	const struct device *touch_dev;
+	const struct device *display_dev;
+	lv_indev_drv_t indev_drv;
+
+	touch_dev = device_get_binding(CONFIG_ESS_DISPLAY_TOUCH_DEV_NAME);
+	if (touch_dev == NULL) {
+		LOG_ERR("Touch device %s was not found",
+			CONFIG_ESS_DISPLAY_TOUCH_DEV_NAME);
+		return -ENODEV;
+	}
+
+	display_dev = device_get_binding(CONFIG_LVGL_DISPLAY_DEV_NAME);
+	if (display_dev != NULL) {
+		display_get_capabilities(display_dev, &touch_display_caps);
+	}
+
+	touch_wakeup = wakeup;
+
+	lv_indev_drv_init(&indev_drv);
+	indev_drv.type = LV_INDEV_TYPE_POINTER;
+	indev_drv.read_cb = touch_read;
+	if (lv_indev_drv_register(&indev_drv) == NULL) {
+		return -ENOMEM;
+	}
+
+	kscan_config(touch_dev, touch_callback);
+	kscan_enable_callback(touch_dev);
+
+	return 0;
+}
+
+bool lcd_touch_is_active(void)
+{
+	return (touch_state.state == LV_INDEV_STATE_PR ||
+		k_msgq_num_used_get(&touch_events) > 0);
+}
@@ -0,0 +1,121 @@
+/**
+ * @file link.c
+ * @brief Requests a larger ATT MTU, data length and the 2M PHY on new
+ * connections so that notifications and bulk transfers use fewer, fuller
+ * packets
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <logging/log.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/gatt.h>
+
+#include "link.h"
+
+LOG_MODULE_REGISTER(link);
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static void mtu_exchanged(struct bt_conn *conn, uint8_t err,
+			  struct bt_gatt_exchange_params *params);
+#ifdef CONFIG_BT_USER_DATA_LEN_UPDATE
+static void data_len_updated(struct bt_conn *conn,
+			     struct bt_conn_le_data_len_info *info);
+#endif
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+static void phy_updated(struct bt_conn *conn,
+			struct bt_conn_le_phy_info *info);
+#endif
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+/* Must stay valid until the exchange completes, so one per connection */
+static struct bt_gatt_exchange_params mtu_exchange_params[CONFIG_BT_MAX_CONN];
+
+static struct bt_conn_cb link_conn_callbacks = {
+#ifdef CONFIG_BT_USER_DATA_LEN_UPDATE
+	.le_data_len_updated = data_len_updated,
+#endif
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+	.le_phy_updated = phy_updated,
+#endif
+};
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static void mtu_exchanged(struct bt_conn *conn, uint8_t err,
+			  struct bt_gatt_exchange_params *params)
+{
+	if (err) {
+		LOG_WRN("MTU exchange failed (err 0x%02x)", err);
+	} else {
+		LOG_INF("ATT MTU %u", bt_gatt_get_mtu(conn));
+	}
+}
+
+#ifdef CONFIG_BT_USER_DATA_LEN_UPDATE
+static void data_len_updated(struct bt_conn *conn,
+			     struct bt_conn_le_data_len_info *info)
+{
+	LOG_INF("Data length TX %u bytes/%u us, RX %u bytes/%u us",
+		info->tx_max_len, info->tx_max_time, info->rx_max_len,
+		info->rx_max_time);
+}
+#endif
+
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+static void phy_updated(struct bt_conn *conn,
+			struct bt_conn_le_phy_info *info)
+{
+	LOG_INF("PHY TX %u, RX %u", info->tx_phy, info->rx_phy);
+}
+#endif
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void link_init(void)
+{
+	bt_conn_cb_register(&link_conn_callbacks);
+}
+
+void link_connected(struct bt_conn *conn)
+{
+	struct bt_gatt_exchange_params *params =
+		&mtu_exchange_params[bt_conn_index(conn)];
+	int rc;
+
+	/* The data length is raised first so that the larger MTU does not
+	 * have to be fragmented into 27 byte packets
+	 */
+#ifdef CONFIG_BT_USER_DATA_LEN_UPDATE
+	rc = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+	if (rc != 0) {
+		LOG_WRN("Data length update failed (err %d)", rc);
+	}
+#endif
+
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+	rc = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+	if (rc != 0) {
+		LOG_WRN("PHY update failed (err %d)", rc);
+	}
+#endif
+
+	params->func = mtu_exchanged;
+	rc = bt_gatt_exchange_mtu(conn, params);
+	if (rc != 0) {
+		LOG_WRN("MTU exchange failed (err %d)", rc);
+	}
+}
@@ -26,14 +26,29 @@
 #include <bluetooth/uuid.h>
 #include <bluetooth/gatt.h>
 #include <bluetooth/services/bas.h>
-#include <ble_ess_service.h>
 #ifdef CONFIG_LCZ_BLE_DIS
 #include <dis.h>
 #endif
 
 #include "app_version.h"
 #include "sensor.h"
-#include "dewpoint.h"
+#include "acquisition.h"
+#include "ess_service.h"
+#include "sample_scheduler.h"
+#include "advertising.h"
+#include "link.h"
+#include "conn_policy.h"
+#include "trace.h"
+#ifdef CONFIG_ESS_HISTORY
+#include "history.h"
+#include "history_service.h"
+#endif
+#ifdef CONFIG_ESS_BULK
+#include "bulk.h"
+#endif
+#ifdef CONFIG_ESS_DERIVED_SERVICE
+#include "derived_service.h"
+#endif
 #ifdef CONFIG_DISPLAY
 #include "lcd.h"
 #endif
@@ -43,17 +58,14 @@ LOG_MODULE_REGISTER(main);
 /******************************************************************************/
 /* Local Data Definitions                                                     */
 /******************************************************************************/
-#define ESS_SERVICE_START_TIMER_S 2
-#define ESS_SERVICE_UPDATE_TIMER_S 10
-
-#define ADVERTISING_INTERVAL_MIN 320 /* in 0.625ms units */
-#define ADVERTISING_INTERVAL_MAX 800 /* in 0.625ms units */
-
 static void ess_svc_update_handler(struct k_work *work);
-static void ess_svc_update_timer_handler(struct k_timer *dummy);
 
 K_WORK_DEFINE(ess_svc_update, ess_svc_update_handler);
-K_TIMER_DEFINE(ess_svc_update_timer, ess_svc_update_timer_handler, NULL);
+
+static struct sample_ring_reader ess_svc_reader;
+static struct acquisition_consumer ess_svc_consumer = {
+	.work = &ess_svc_update,
+};
 
 /******************************************************************************/
 /* Local Function Prototypes                                                  */
@@ -70,22 +82,27 @@ static void connected(struct bt_conn *conn, uint8_t err)
 {
 	if (err) {
 		LOG_ERR("Connection failed (err 0x%02x)\n", err);
-	} else {
-		LOG_INF("Connected\n");
+		return;
 	}
 
+	LOG_INF("Connected\n");
+
 #ifdef CONFIG_DISPLAY
 	struct bt_conn_info ble_info;
 
 	bt_conn_get_info(conn, &ble_info);
-	update_lcd_connected_address(true, ble_info.le.dst->type,
+	update_lcd_connected_address(bt_conn_index(conn), true,
+				     ble_info.le.dst->type,
 				     ble_info.le.dst->a.val);
-#else
-	k_timer_start(&ess_svc_update_timer,
-		      K_SECONDS(ESS_SERVICE_UPDATE_TIMER_S),
-		      K_SECONDS(ESS_SERVICE_UPDATE_TIMER_S));
-	ess_svc_update_handler(NULL);
 #endif
+
+	link_connected(conn);
+
+	/* Give the new central a fresh reading, the sample is shared with any
+	 * other connected centrals
+	 */
+	sample_scheduler_connection_changed(true);
+	acquisition_trigger();
 }
 
 static void disconnected(struct bt_conn *conn, uint8_t reason)
@@ -93,10 +110,10 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
 	LOG_INF("Disconnected (reason 0x%02x)\n", reason);
 
 #ifdef CONFIG_DISPLAY
-	update_lcd_connected_address(false, 0, NULL);
-#else
-	k_timer_stop(&ess_svc_update_timer);
+	update_lcd_connected_address(bt_conn_index(conn), false, 0, NULL);
 #endif
+
+	sample_scheduler_connection_changed(false);
 }
 
 static struct bt_conn_cb conn_callbacks = {
@@ -104,23 +121,13 @@ static struct bt_conn_cb conn_callbacks = {
 	.disconnected = disconnected,
 };
 
-static const struct bt_data ad[] = {
-	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
-	BT_DATA_BYTES(BT_DATA_UUID16_ALL, BT_UUID_16_ENCODE(BT_UUID_ESS_VAL))
-};
-
 static void bt_ready(void)
 {
 	int err;
 
 	LOG_INF("Bluetooth initialized\n");
 
-	err = bt_le_adv_start(BT_LE_ADV_PARAM((BT_LE_ADV_OPT_CONNECTABLE |
-					       BT_LE_ADV_OPT_USE_NAME |
-					       BT_LE_ADV_OPT_FORCE_NAME_IN_AD),
-					      ADVERTISING_INTERVAL_MIN,
-					      ADVERTISING_INTERVAL_MAX, NULL),
-			      ad, ARRAY_SIZE(ad), NULL, 0);
+	err = advertising_start();
 	if (err) {
 		LOG_ERR("Advertising failed to start (err %d)\n", err);
 		return;
@@ -131,30 +138,25 @@ static void bt_ready(void)
 
 static void ess_svc_update_handler(struct k_work *work)
 {
-	int8_t dew_point;
-	float temperature, humidity;
-
-	read_sensor();
-
-	read_temperature_float(&temperature);
-	read_humidity_float(&humidity);
-	dew_point = calculate_dew_point(temperature, humidity);
-
-	ess_svc_update_temperature(NULL, read_temperature());
-	ess_svc_update_humidity(NULL, read_humidity());
-	ess_svc_update_pressure(NULL, read_pressure());
-	ess_svc_update_dew_point(NULL, dew_point);
+	struct ess_sample sample;
+	bool updated = false;
+	uint32_t start;
+
+	/* Samples are read from the sensor by the acquisition thread, this
+	 * only passes the newest one on so never waits on the sensor bus
+	 */
+	while (sample_ring_read(&ess_svc_reader, &sample) == 0) {
+		updated = true;
+	}
 
-#ifdef CONFIG_DISPLAY
-	float pressure;
-	read_pressure_float(&pressure);
-	update_lcd_graph(temperature, humidity, pressure, (float)dew_point);
+	if (updated) {
+		start = trace_begin();
+		ess_service_update(&sample);
+		trace_end(TRACE_STAGE_GATT, start);
+#ifdef CONFIG_ESS_TRACE
+		trace_end(TRACE_STAGE_PIPELINE, sample.trace_start);
 #endif
-}
-
-static void ess_svc_update_timer_handler(struct k_timer *dummy)
-{
-	k_work_submit(&ess_svc_update);
+	}
 }
 
 /******************************************************************************/
@@ -164,6 +166,10 @@ void main(void)
 {
 	int err;
 
+#ifdef CONFIG_ESS_TRACE
+	trace_init();
+#endif
+
 	setup_sensor();
 	if (!is_sensor_present()) {
 		LOG_ERR("Sensor not detected, application cannot start");
@@ -182,23 +188,44 @@ void main(void)
 		return;
 	}
 
-	bt_ready();
-
 	bt_conn_cb_register(&conn_callbacks);
+	link_init();
+	conn_policy_init();
 
 #ifdef CONFIG_LCZ_BLE_DIS
 	dis_initialize(APP_VERSION_STRING);
 #endif
 
-	ess_svc_init();
+	ess_service_init();
 
-#ifdef CONFIG_DISPLAY
-	setup_lcd(false, NULL);
+	sample_ring_reader_init(&ess_svc_reader);
+	acquisition_register_consumer(&ess_svc_consumer);
+
+#ifdef CONFIG_ESS_DERIVED_SERVICE
+	derived_service_init();
+#endif
 
-	k_timer_start(&ess_svc_update_timer,
-		      K_SECONDS(ESS_SERVICE_START_TIMER_S),
-		      K_SECONDS(ESS_SERVICE_UPDATE_TIMER_S));
+#ifdef CONFIG_ESS_HISTORY
+	history_init();
+	history_service_init();
+#endif
+
+#ifdef CONFIG_ESS_BULK
+	err = bulk_init();
+	if (err) {
+		LOG_ERR("Bulk channel registration failed (err %d)", err);
+	}
+#endif
 
-	read_sensor();
+	/* Connections are only accepted once every module has registered
+	 * its connection callbacks
+	 */
+	bt_ready();
+
+#ifdef CONFIG_DISPLAY
+	setup_lcd(false, NULL);
 #endif
+
+	acquisition_start_gas();
+	sample_scheduler_start();
 }
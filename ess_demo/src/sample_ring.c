@@ -0,0 +1,152 @@
+/**
+ * @file sample_ring.c
+ * @brief Single producer, multiple consumer ring buffer of sensor samples
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <sys/atomic.h>
+
+#include "sample_ring.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define SAMPLE_RING_SIZE CONFIG_ESS_SAMPLE_RING_SIZE
+#define SAMPLE_RING_MASK (SAMPLE_RING_SIZE - 1)
+
+BUILD_ASSERT((SAMPLE_RING_SIZE & SAMPLE_RING_MASK) == 0,
+	     "Sample ring size must be a power of two");
+
+/* Each slot is protected by a sequence lock: the version is odd whilst the
+ * slot is being written, readers copy the slot and retry if the version
+ * was odd or changed during the copy. The index identifies which write the
+ * slot holds, so a reader can detect that it has been lapped.
+ */
+struct sample_ring_slot {
+	atomic_t version;
+	uint32_t index;
+	struct ess_sample sample;
+};
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static struct sample_ring_slot ring_slots[SAMPLE_RING_SIZE];
+/* Total number of samples written */
+static atomic_t ring_head = ATOMIC_INIT(0);
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static uint32_t read_slot(uint32_t index, struct ess_sample *sample);
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+/* Copies the slot which holds the given write, returns the index of the
+ * write the slot actually held
+ */
+static uint32_t read_slot(uint32_t index, struct ess_sample *sample)
+{
+	struct sample_ring_slot *slot = &ring_slots[index & SAMPLE_RING_MASK];
+	atomic_val_t version;
+	uint32_t slot_index;
+
+	do {
+		version = atomic_get(&slot->version);
+		compiler_barrier();
+		slot_index = slot->index;
+		*sample = slot->sample;
+		compiler_barrier();
+	} while ((version & 1) != 0 || version != atomic_get(&slot->version));
+
+	return slot_index;
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void sample_ring_write(const struct ess_sample *sample)
+{
+	uint32_t head = (uint32_t)atomic_get(&ring_head);
+	struct sample_ring_slot *slot = &ring_slots[head & SAMPLE_RING_MASK];
+
+	/* The scheduler is locked for the copy so that a reader thread never
+	 * preempts a partially written slot and has to wait for it
+	 */
+	k_sched_lock();
+	atomic_inc(&slot->version);
+	compiler_barrier();
+	slot->index = head;
+	slot->sample = *sample;
+	compiler_barrier();
+	atomic_inc(&slot->version);
+
+	/* Published before the scheduler is unlocked, so that no reader runs
+	 * whilst the slot already holds a write the head does not include
+	 */
+	atomic_set(&ring_head, (atomic_val_t)(head + 1));
+	k_sched_unlock();
+}
+
+void sample_ring_reader_init(struct sample_ring_reader *reader)
+{
+	reader->next = (uint32_t)atomic_get(&ring_head);
+	reader->dropped = 0;
+}
+
+int sample_ring_read(struct sample_ring_reader *reader,
+		     struct ess_sample *sample)
+{
+	uint32_t slot_index;
+	uint32_t head;
+
+	while (true) {
+		head = (uint32_t)atomic_get(&ring_head);
+
+		if (head == reader->next) {
+			return -EAGAIN;
+		}
+
+		if ((head - reader->next) > SAMPLE_RING_SIZE) {
+			reader->dropped += head - reader->next - SAMPLE_RING_SIZE;
+			reader->next = head - SAMPLE_RING_SIZE;
+		}
+
+		slot_index = read_slot(reader->next, sample);
+		if (slot_index == reader->next) {
+			++reader->next;
+			return 0;
+		}
+
+		/* The slot was overwritten since the head was read, possibly
+		 * by a write the head does not include yet. The reader is moved
+		 * past the overwritten samples rather than waiting for the
+		 * head, which could otherwise spin forever
+		 */
+		if ((int32_t)(slot_index - reader->next) > 0) {
+			head = slot_index + 1;
+			reader->dropped += head - reader->next - SAMPLE_RING_SIZE;
+			reader->next = head - SAMPLE_RING_SIZE;
+		}
+	}
+}
+
+int sample_ring_peek(uint32_t age, struct ess_sample *sample)
+{
+	uint32_t head = (uint32_t)atomic_get(&ring_head);
+	uint32_t index = head - 1 - age;
+
+	if (age >= head || age >= SAMPLE_RING_SIZE) {
+		return -ENOENT;
+	}
+
+	return (read_slot(index, sample) == index ? 0 : -ENOENT);
+}
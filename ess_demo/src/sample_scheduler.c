@@ -0,0 +1,230 @@
+/**
+ * @file sample_scheduler.c
+ * @brief Adaptive sampling scheduler which sets the sensor sampling period
+ * from the rate of change of the readings, the connection state and the
+ * number of subscribers
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <stdlib.h>
+#include <logging/log.h>
+
+#include "sample_scheduler.h"
+#include "acquisition.h"
+#include "ess_service.h"
+#include "conn_policy.h"
+
+LOG_MODULE_REGISTER(sample_scheduler);
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define MS_PER_MINUTE 60000
+
+BUILD_ASSERT(CONFIG_ESS_SAMPLE_PERIOD_MIN_MS <=
+		     CONFIG_ESS_SAMPLE_PERIOD_SUBSCRIBED_MS,
+	     "Subscribed sample period is below the minimum");
+BUILD_ASSERT(CONFIG_ESS_SAMPLE_PERIOD_SUBSCRIBED_MS <=
+		     CONFIG_ESS_SAMPLE_PERIOD_MAX_MS,
+	     "Subscribed sample period is above the maximum");
+
+enum signal_activity {
+	/* All channels are changing by less than half of their threshold */
+	SIGNAL_QUIET = 0,
+	/* Between the two, the period is kept as it is */
+	SIGNAL_STEADY,
+	/* At least one channel is changing faster than its threshold */
+	SIGNAL_FAST,
+};
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static enum signal_activity channel_activity(int32_t from, int32_t to,
+					     int64_t elapsed_ms,
+					     uint32_t threshold);
+static enum signal_activity sample_activity(const struct ess_sample *from,
+					    const struct ess_sample *to);
+static uint32_t upper_period(void);
+static void scheduler_work_handler(struct k_work *work);
+static void scheduler_timer_handler(struct k_timer *timer);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+K_WORK_DEFINE(scheduler_work, scheduler_work_handler);
+K_TIMER_DEFINE(scheduler_timer, scheduler_timer_handler, NULL);
+
+static struct sample_ring_reader scheduler_reader;
+static struct acquisition_consumer scheduler_consumer = {
+	.work = &scheduler_work,
+};
+
+/* Inputs, written from the Bluetooth callbacks */
+static atomic_t connection_count;
+static atomic_t override_period_ms;
+
+/* Only accessed from the work handler, apart from reads of the period */
+static struct ess_sample last_sample;
+static bool have_last_sample;
+static uint32_t adaptive_period_ms;
+static atomic_t current_period_ms;
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static enum signal_activity channel_activity(int32_t from, int32_t to,
+					     int64_t elapsed_ms,
+					     uint32_t threshold)
+{
+	/* Compares |to - from| / elapsed with the threshold per minute
+	 * without dividing
+	 */
+	int64_t change = (int64_t)abs(to - from) * MS_PER_MINUTE;
+	int64_t limit = (int64_t)threshold * elapsed_ms;
+
+	if (threshold == 0) {
+		return SIGNAL_QUIET;
+	} else if (change > limit) {
+		return SIGNAL_FAST;
+	} else if (change * 2 > limit) {
+		return SIGNAL_STEADY;
+	} else {
+		return SIGNAL_QUIET;
+	}
+}
+
+static enum signal_activity sample_activity(const struct ess_sample *from,
+					    const struct ess_sample *to)
+{
+	int64_t elapsed_ms = to->timestamp - from->timestamp;
+
+	if (elapsed_ms <= 0) {
+		return SIGNAL_STEADY;
+	}
+
+	return MAX(channel_activity(from->temperature, to->temperature,
+				    elapsed_ms,
+				    CONFIG_ESS_SAMPLE_RATE_TEMPERATURE),
+		   MAX(channel_activity(from->humidity, to->humidity,
+					elapsed_ms,
+					CONFIG_ESS_SAMPLE_RATE_HUMIDITY),
+		       channel_activity(from->pressure, to->pressure,
+					elapsed_ms,
+					CONFIG_ESS_SAMPLE_RATE_PRESSURE)));
+}
+
+static uint32_t upper_period(void)
+{
+	/* The display and beacon show every sample, so count as subscribers */
+	if (IS_ENABLED(CONFIG_DISPLAY) || IS_ENABLED(CONFIG_ESS_BEACON) ||
+	    (atomic_get(&connection_count) > 0 &&
+	     ess_service_subscriber_count() > 0)) {
+		return CONFIG_ESS_SAMPLE_PERIOD_SUBSCRIBED_MS;
+	}
+
+	return CONFIG_ESS_SAMPLE_PERIOD_MAX_MS;
+}
+
+static void scheduler_work_handler(struct k_work *work)
+{
+	enum signal_activity activity = SIGNAL_STEADY;
+	struct ess_sample sample;
+	uint32_t upper = upper_period();
+	uint32_t period;
+
+	while (sample_ring_read(&scheduler_reader, &sample) == 0) {
+		if (have_last_sample) {
+			activity = MAX(activity,
+				       sample_activity(&last_sample, &sample));
+		}
+		last_sample = sample;
+		have_last_sample = true;
+	}
+
+	/* Transients are reacted to immediately, the period is then widened
+	 * gradually once the readings settle
+	 */
+	if (activity == SIGNAL_FAST) {
+		adaptive_period_ms = CONFIG_ESS_SAMPLE_PERIOD_MIN_MS;
+	} else if (activity == SIGNAL_QUIET) {
+		adaptive_period_ms = MIN(adaptive_period_ms * 2, upper);
+	}
+	adaptive_period_ms = MIN(adaptive_period_ms, upper);
+
+	period = (uint32_t)atomic_get(&override_period_ms);
+	if (period == 0) {
+		period = adaptive_period_ms;
+	}
+
+	if (period != (uint32_t)atomic_get(&current_period_ms)) {
+		LOG_DBG("Sample period %u ms", period);
+		atomic_set(&current_period_ms, period);
+		k_timer_start(&scheduler_timer, K_MSEC(period), K_MSEC(period));
+		ess_service_set_update_interval(
+			ceiling_fraction(period, MSEC_PER_SEC));
+		conn_policy_update();
+	}
+}
+
+static void scheduler_timer_handler(struct k_timer *timer)
+{
+	acquisition_trigger();
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void sample_scheduler_start(void)
+{
+	sample_ring_reader_init(&scheduler_reader);
+	acquisition_register_consumer(&scheduler_consumer);
+
+	atomic_set(&current_period_ms, upper_period());
+	adaptive_period_ms = (uint32_t)atomic_get(&current_period_ms);
+	ess_service_set_update_interval(
+		ceiling_fraction(adaptive_period_ms, MSEC_PER_SEC));
+
+	k_timer_start(&scheduler_timer, K_NO_WAIT, K_MSEC(adaptive_period_ms));
+}
+
+void sample_scheduler_connection_changed(bool connected)
+{
+	if (connected) {
+		atomic_inc(&connection_count);
+	} else {
+		atomic_dec(&connection_count);
+	}
+
+	k_work_submit(&scheduler_work);
+}
+
+void sample_scheduler_update(void)
+{
+	k_work_submit(&scheduler_work);
+}
+
+int sample_scheduler_set_override(uint32_t period_ms)
+{
+	if (period_ms != 0 && (period_ms < CONFIG_ESS_SAMPLE_PERIOD_MIN_MS ||
+			       period_ms > CONFIG_ESS_SAMPLE_PERIOD_MAX_MS)) {
+		return -EINVAL;
+	}
+
+	atomic_set(&override_period_ms, period_ms);
+	k_work_submit(&scheduler_work);
+
+	return 0;
+}
+
+uint32_t sample_scheduler_get_period(void)
+{
+	return (uint32_t)atomic_get(&current_period_ms);
+}
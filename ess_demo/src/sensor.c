@@ -11,7 +11,9 @@
 /* Includes                                                                   */
 /******************************************************************************/
 #include <logging/log.h>
+#include <stdlib.h>
 #include "sensor.h"
+#include "trace.h"
 
 LOG_MODULE_REGISTER(sensor);
 
@@ -24,52 +26,183 @@ LOG_MODULE_REGISTER(sensor);
 #define HUMIDITY_VAL2_DIVIDER       10000
 #define PRESSURE_VAL1_MULTIPLIER    10000
 #define PRESSURE_VAL2_DIVIDER       100
-#define PRESSURE_VAL2_DIVIDER_DBG   1000
-#define FLOAT_TEMPERATURE_DIVIDER   1000000
-#define FLOAT_HUMIDITY_DIVIDER      1000000
-#define FLOAT_PRESSURE_DIVIDER      1000
-#define FLOAT_PRESSURE_MULTIPLIER   1000
+#define TEMPERATURE_DBG_DIVIDER     100
+#define HUMIDITY_DBG_DIVIDER        100
+#define PRESSURE_DBG_DIVIDER        10
 
-#if defined(CONFIG_BOARD_BL5340_DVK_CPUAPP)
+#define OVERSAMPLING_MAX 16
+#define IIR_FILTER_MIN 2
+#define IIR_FILTER_MAX 16
+
+/* SENSOR_FETCH_CHANNELS is set for drivers which can fetch a single channel,
+ * others always fetch all channels
+ */
+#if defined(CONFIG_ESS_SENSOR_EMUL)
+#define SENSOR_LABEL CONFIG_ESS_SENSOR_EMUL_DEV_NAME
+#define SENSOR_FETCH_CHANNELS 1
+#elif defined(CONFIG_BOARD_BL5340_DVK_CPUAPP)
 #define SENSOR_TYPE bosch_bme680
+#define SENSOR_FETCH_CHANNELS 0
 #elif defined(CONFIG_BOARD_PINNACLE_100_DVK)
 #define SENSOR_TYPE bosch_bme680
+#define SENSOR_FETCH_CHANNELS 0
 #elif defined(CONFIG_BOARD_BL654_SENSOR_BOARD)
 #define SENSOR_TYPE bosch_bme280
+#define SENSOR_FETCH_CHANNELS 0
 #else
 #error "Unsupported board"
 #endif
 
+#ifndef SENSOR_LABEL
+#define SENSOR_LABEL DT_LABEL(DT_INST(0, SENSOR_TYPE))
+#endif
+
 /******************************************************************************/
 /* Local Data Definitions                                                     */
 /******************************************************************************/
-static struct sensor_value temperature_value, pressure_value, humidity_value;
 static bool sensor_present = false;
+static const struct device *sensor_dev;
+static enum ess_sensor_gas_mode sensor_gas_mode = ESS_SENSOR_GAS_NONE;
+
+static struct ess_sensor_config sensor_config = {
+	.temperature_oversampling =
+		CONFIG_ESS_SENSOR_TEMPERATURE_OVERSAMPLING,
+	.humidity_oversampling = CONFIG_ESS_SENSOR_HUMIDITY_OVERSAMPLING,
+	.pressure_oversampling = CONFIG_ESS_SENSOR_PRESSURE_OVERSAMPLING,
+	.iir_filter = CONFIG_ESS_SENSOR_IIR_FILTER,
+	.mode = (IS_ENABLED(CONFIG_ESS_SENSOR_MODE_NORMAL) ?
+			 ESS_SENSOR_MODE_NORMAL :
+			 ESS_SENSOR_MODE_FORCED),
+	.standby_time_ms = CONFIG_ESS_SENSOR_STANDBY_TIME_MS,
+};
+
+/* Sensor channel for each SENSOR_READ_* bit */
+static const enum sensor_channel read_channels[] = {
+	SENSOR_CHAN_AMBIENT_TEMP,
+	SENSOR_CHAN_HUMIDITY,
+	SENSOR_CHAN_PRESS,
+};
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static bool is_oversampling_valid(uint8_t oversampling);
+static bool is_iir_filter_valid(uint8_t iir_filter);
+static int set_attribute(enum sensor_channel chan, int attr, int32_t value);
+static int apply_sensor_config(const struct ess_sensor_config *config);
+static void setup_gas(void);
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static bool is_oversampling_valid(uint8_t oversampling)
+{
+	return (oversampling == 0 || (oversampling <= OVERSAMPLING_MAX &&
+				      is_power_of_two(oversampling)));
+}
+
+static bool is_iir_filter_valid(uint8_t iir_filter)
+{
+	return (iir_filter == 0 ||
+		(iir_filter >= IIR_FILTER_MIN && iir_filter <= IIR_FILTER_MAX &&
+		 is_power_of_two(iir_filter)));
+}
+
+static int set_attribute(enum sensor_channel chan, int attr, int32_t value)
+{
+	struct sensor_value val = { .val1 = value, .val2 = 0 };
+
+	return sensor_attr_set(sensor_dev, chan, (enum sensor_attribute)attr,
+			       &val);
+}
+
+static int apply_sensor_config(const struct ess_sensor_config *config)
+{
+	int rc;
+
+	rc = set_attribute(SENSOR_CHAN_AMBIENT_TEMP, SENSOR_ATTR_OVERSAMPLING,
+			   config->temperature_oversampling);
+	if (rc == 0) {
+		rc = set_attribute(SENSOR_CHAN_HUMIDITY,
+				   SENSOR_ATTR_OVERSAMPLING,
+				   config->humidity_oversampling);
+	}
+	if (rc == 0) {
+		rc = set_attribute(SENSOR_CHAN_PRESS, SENSOR_ATTR_OVERSAMPLING,
+				   config->pressure_oversampling);
+	}
+	if (rc == 0) {
+		rc = set_attribute(SENSOR_CHAN_ALL, ESS_SENSOR_ATTR_IIR_FILTER,
+				   config->iir_filter);
+	}
+	if (rc == 0) {
+		rc = set_attribute(SENSOR_CHAN_ALL,
+				   ESS_SENSOR_ATTR_STANDBY_TIME,
+				   config->standby_time_ms);
+	}
+	if (rc == 0) {
+		/* Mode is set last so that a normal mode sensor starts with
+		 * the new settings
+		 */
+		rc = set_attribute(SENSOR_CHAN_ALL, ESS_SENSOR_ATTR_MODE,
+				   config->mode);
+	}
+
+	if (rc == -ENOTSUP) {
+		LOG_DBG("Runtime configuration not supported, using driver "
+			"Kconfig settings");
+	} else if (rc != 0) {
+		LOG_ERR("Sensor configuration failed (err %d)", rc);
+	}
+
+	return rc;
+}
+
+static void setup_gas(void)
+{
+#ifdef CONFIG_ESS_SENSOR_GAS
+	int rc;
+
+	rc = set_attribute(SENSOR_CHAN_GAS_RES,
+			   ESS_SENSOR_ATTR_HEATER_TEMPERATURE,
+			   CONFIG_ESS_SENSOR_GAS_HEATER_TEMPERATURE);
+	if (rc == 0) {
+		rc = set_attribute(SENSOR_CHAN_GAS_RES,
+				   ESS_SENSOR_ATTR_HEATER_DURATION,
+				   CONFIG_ESS_SENSOR_GAS_HEATER_DURATION_MS);
+	}
+
+	if (rc == 0) {
+		sensor_gas_mode = ESS_SENSOR_GAS_INTERLEAVED;
+	} else if (rc == -ENOTSUP) {
+		LOG_INF("Heater control not supported, the driver heater "
+			"profile runs with every read");
+		sensor_gas_mode = ESS_SENSOR_GAS_EVERY_READ;
+	} else {
+		LOG_ERR("Gas heater configuration failed (err %d)", rc);
+	}
+#endif
+}
 
 /******************************************************************************/
 /* Global Function Definitions                                                */
 /******************************************************************************/
 void setup_sensor(void)
 {
-	const struct device *dev =
-		device_get_binding(DT_LABEL(DT_INST(0, SENSOR_TYPE)));
-	if (dev == NULL) {
+	sensor_dev = device_get_binding(SENSOR_LABEL);
+	if (sensor_dev == NULL) {
 		sensor_present = false;
-		LOG_ERR("Error! %s sensor was not found\n",
-			DT_LABEL(DT_INST(0, SENSOR_TYPE)));
+		LOG_ERR("Error! %s sensor was not found\n", SENSOR_LABEL);
 	} else {
 		sensor_present = true;
-	}
-
-	LOG_DBG("Device %p name is %s\n", dev, dev->name);
+		LOG_DBG("Device %p name is %s\n", sensor_dev, sensor_dev->name);
 
-	/* Clear initial sensor readings */
-	temperature_value.val1 = 0;
-	temperature_value.val2 = 0;
-	pressure_value.val1 = 0;
-	pressure_value.val2 = 0;
-	humidity_value.val1 = 0;
-	humidity_value.val2 = 0;
+		/* On failure the driver keeps its Kconfig settings, which the
+		 * board files set to the same values as sensor_config
+		 */
+		(void)apply_sensor_config(&sensor_config);
+		setup_gas();
+	}
 }
 
 bool is_sensor_present(void)
@@ -77,62 +210,166 @@ bool is_sensor_present(void)
 	return sensor_present;
 }
 
-void read_sensor(void)
+int configure_sensor(const struct ess_sensor_config *config)
 {
-	if (sensor_present) {
-		const struct device *dev =
-			device_get_binding(DT_LABEL(DT_INST(0, SENSOR_TYPE)));
-		sensor_sample_fetch(dev);
-		sensor_channel_get(dev, SENSOR_CHAN_AMBIENT_TEMP,
-				   &temperature_value);
-		sensor_channel_get(dev, SENSOR_CHAN_PRESS, &pressure_value);
-		sensor_channel_get(dev, SENSOR_CHAN_HUMIDITY, &humidity_value);
+	int rc;
+
+	if (!is_oversampling_valid(config->temperature_oversampling) ||
+	    !is_oversampling_valid(config->humidity_oversampling) ||
+	    !is_oversampling_valid(config->pressure_oversampling) ||
+	    !is_iir_filter_valid(config->iir_filter) ||
+	    (config->mode != ESS_SENSOR_MODE_FORCED &&
+	     config->mode != ESS_SENSOR_MODE_NORMAL)) {
+		return -EINVAL;
+	}
 
-		LOG_DBG("T: %d.%02dC, H: %d.%02d%%, P: %d%03dPa\n",
-			temperature_value.val1,
-			temperature_value.val2 / TEMPERATURE_VAL2_DIVIDER,
-			humidity_value.val1,
-			humidity_value.val2 / HUMIDITY_VAL2_DIVIDER,
-			pressure_value.val1,
-			pressure_value.val2 / PRESSURE_VAL2_DIVIDER_DBG);
+	if (!sensor_present) {
+		return -ENODEV;
+	}
+
+	/* The settings are only reported once the sensor is using them */
+	rc = apply_sensor_config(config);
+	if (rc == 0) {
+		sensor_config = *config;
+	} else {
+		/* Some attributes may have been set before the failure, so
+		 * the previous settings are restored
+		 */
+		(void)apply_sensor_config(&sensor_config);
 	}
+
+	return rc;
 }
 
-int16_t read_temperature(void)
+void get_sensor_config(struct ess_sensor_config *config)
 {
-	return (temperature_value.val1 * TEMPERATURE_VAL1_MULTIPLIER) +
-	       (temperature_value.val2 / TEMPERATURE_VAL2_DIVIDER);
+	*config = sensor_config;
 }
 
-int16_t read_humidity(void)
+int read_sensor(struct ess_sample *sample)
 {
-	return (humidity_value.val1 * HUMIDITY_VAL1_MULTIPLIER) +
-	       (humidity_value.val2 / HUMIDITY_VAL2_DIVIDER);
+	return read_sensor_channels(SENSOR_READ_ALL, sample);
+}
+
+int read_sensor_channels(uint8_t channels, struct ess_sample *sample)
+{
+	struct sensor_value value;
+	uint32_t start;
+	int rc;
+
+	if (!sensor_present) {
+		return -ENODEV;
+	}
+
+	channels &= SENSOR_READ_ALL;
+	if (channels == 0) {
+		return 0;
+	}
+
+	start = trace_begin();
+	if (SENSOR_FETCH_CHANNELS && (channels & (channels - 1)) == 0) {
+		/* Single channel, only that measurement is needed */
+		rc = sensor_sample_fetch_chan(
+			sensor_dev, read_channels[find_lsb_set(channels) - 1]);
+	} else {
+		rc = sensor_sample_fetch(sensor_dev);
+	}
+	trace_end(TRACE_STAGE_SENSOR_FETCH, start);
+
+	if (rc != 0) {
+		LOG_ERR("Sensor fetch failed (err %d)", rc);
+		return rc;
+	}
+
+	start = trace_begin();
+	if (channels & SENSOR_READ_TEMPERATURE) {
+		sensor_channel_get(sensor_dev, SENSOR_CHAN_AMBIENT_TEMP, &value);
+		sample->temperature = sensor_value_to_temperature(&value);
+	}
+
+	if (channels & SENSOR_READ_HUMIDITY) {
+		sensor_channel_get(sensor_dev, SENSOR_CHAN_HUMIDITY, &value);
+		sample->humidity = sensor_value_to_humidity(&value);
+	}
+
+	if (channels & SENSOR_READ_PRESSURE) {
+		sensor_channel_get(sensor_dev, SENSOR_CHAN_PRESS, &value);
+		sample->pressure = sensor_value_to_pressure(&value);
+	}
+
+	if (sensor_gas_mode == ESS_SENSOR_GAS_EVERY_READ) {
+		/* The heater has run as part of the fetch */
+		sensor_channel_get(sensor_dev, SENSOR_CHAN_GAS_RES, &value);
+		sample->gas_resistance = sensor_value_to_gas_resistance(&value);
+		++sample->gas_sequence;
+	}
+	trace_end(TRACE_STAGE_CONVERSION, start);
+
+	LOG_DBG("T: %d.%02dC, H: %u.%02u%%, P: %u.%uPa\n",
+		sample->temperature / TEMPERATURE_DBG_DIVIDER,
+		abs(sample->temperature % TEMPERATURE_DBG_DIVIDER),
+		sample->humidity / HUMIDITY_DBG_DIVIDER,
+		sample->humidity % HUMIDITY_DBG_DIVIDER,
+		sample->pressure / PRESSURE_DBG_DIVIDER,
+		sample->pressure % PRESSURE_DBG_DIVIDER);
+
+	return 0;
+}
+
+enum ess_sensor_gas_mode get_sensor_gas_mode(void)
+{
+	return sensor_gas_mode;
+}
+
+int read_sensor_gas(struct ess_sample *sample)
+{
+	struct sensor_value value;
+	uint32_t start;
+	int rc;
+
+	if (!sensor_present) {
+		return -ENODEV;
+	} else if (sensor_gas_mode != ESS_SENSOR_GAS_INTERLEAVED) {
+		return -ENOTSUP;
+	}
+
+	start = trace_begin();
+	rc = sensor_sample_fetch_chan(sensor_dev, SENSOR_CHAN_GAS_RES);
+	trace_end(TRACE_STAGE_GAS, start);
+
+	if (rc != 0) {
+		LOG_ERR("Gas measurement failed (err %d)", rc);
+		return rc;
+	}
+
+	sensor_channel_get(sensor_dev, SENSOR_CHAN_GAS_RES, &value);
+	sample->gas_resistance = sensor_value_to_gas_resistance(&value);
+	++sample->gas_sequence;
+
+	LOG_DBG("G: %u Ohm\n", sample->gas_resistance);
+
+	return 0;
 }
 
-int32_t read_pressure(void)
+int16_t sensor_value_to_temperature(const struct sensor_value *value)
 {
-	return (pressure_value.val1 * PRESSURE_VAL1_MULTIPLIER) +
-	       (pressure_value.val2 / PRESSURE_VAL2_DIVIDER);
+	return (value->val1 * TEMPERATURE_VAL1_MULTIPLIER) +
+	       (value->val2 / TEMPERATURE_VAL2_DIVIDER);
 }
 
-void read_temperature_float(float *temperature)
+uint16_t sensor_value_to_humidity(const struct sensor_value *value)
 {
-	*temperature = temperature_value.val2;
-	*temperature /= FLOAT_TEMPERATURE_DIVIDER;
-	*temperature += temperature_value.val1;
+	return (value->val1 * HUMIDITY_VAL1_MULTIPLIER) +
+	       (value->val2 / HUMIDITY_VAL2_DIVIDER);
 }
 
-void read_humidity_float(float *humidity)
+uint32_t sensor_value_to_pressure(const struct sensor_value *value)
 {
-	*humidity = humidity_value.val2;
-	*humidity /= FLOAT_HUMIDITY_DIVIDER;
-	*humidity += humidity_value.val1;
+	return (value->val1 * PRESSURE_VAL1_MULTIPLIER) +
+	       (value->val2 / PRESSURE_VAL2_DIVIDER);
 }
 
-void read_pressure_float(float *pressure)
+uint32_t sensor_value_to_gas_resistance(const struct sensor_value *value)
 {
-	*pressure = pressure_value.val2;
-	*pressure /= FLOAT_PRESSURE_DIVIDER;
-	*pressure += ((float)pressure_value.val1) * FLOAT_PRESSURE_MULTIPLIER;
+	return (value->val1 < 0 ? 0 : (uint32_t)value->val1);
 }
@@ -0,0 +1,343 @@
+/**
+ * @file sensor_emul.c
+ * @brief Emulated BME280/BME680 sensor which replays a trace of readings
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <device.h>
+#include <init.h>
+#include <drivers/sensor.h>
+#include <logging/log.h>
+
+#include "sensor.h"
+
+LOG_MODULE_REGISTER(sensor_emul);
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define TEMPERATURE_VAL1_DIVIDER 100
+#define TEMPERATURE_VAL2_MULTIPLIER 10000
+#define HUMIDITY_VAL1_DIVIDER 100
+#define HUMIDITY_VAL2_MULTIPLIER 10000
+#define PRESSURE_VAL1_DIVIDER 10000
+#define PRESSURE_VAL2_MULTIPLIER 100
+
+/* Typical measurement times from the BME280 datasheet, appendix B */
+#define CONVERSION_BASE_US 1000
+#define CONVERSION_PER_OVERSAMPLE_US 2000
+#define CONVERSION_CHANNEL_SETUP_US 500
+
+/* BME680 gas conversion after the heater has run */
+#define GAS_CONVERSION_US 1000
+
+/* Trace point, in the same units as the ESS characteristics */
+struct emul_trace_point {
+	int16_t temperature; /* 0.01 C */
+	uint16_t humidity; /* 0.01 % */
+	uint32_t pressure; /* 0.1 Pa */
+	uint32_t gas_resistance; /* Ohm, 0 if the trace has no gas readings */
+};
+
+struct sensor_emul_data {
+	struct emul_trace_point sample;
+	bool filter_primed;
+	int32_t temperature_filtered;
+	int32_t pressure_filtered;
+	uint8_t temperature_oversampling;
+	uint8_t humidity_oversampling;
+	uint8_t pressure_oversampling;
+	uint8_t iir_filter;
+	enum ess_sensor_mode mode;
+	uint16_t heater_duration_ms;
+};
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static const struct emul_trace_point emul_trace[] = {
+#ifdef ESS_SENSOR_EMUL_TRACE_INC
+#include ESS_SENSOR_EMUL_TRACE_INC
+#else
+	/* Scripted trace: an indoor day/night cycle with a fast humidity
+	 * transient (e.g. a shower or kettle) part way through, cooking
+	 * lowers the gas resistance around the same time
+	 */
+	{ 1850, 4200, 1012800, 152000 }, { 1900, 4150, 1012900, 150000 },
+	{ 1980, 4100, 1013000, 148000 }, { 2070, 4000, 1013150, 141000 },
+	{ 2160, 3900, 1013250, 133000 }, { 2240, 3850, 1013300, 126000 },
+	{ 2300, 6800, 1013350, 84000 }, { 2420, 8500, 1013300, 61000 },
+	{ 2380, 7200, 1013200, 72000 }, { 2310, 5600, 1013100, 95000 },
+	{ 2250, 4700, 1012950, 118000 }, { 2190, 4400, 1012800, 131000 },
+	{ 2110, 4300, 1012700, 139000 }, { 2030, 4250, 1012650, 145000 },
+	{ 1950, 4250, 1012700, 149000 }, { 1880, 4220, 1012750, 151000 },
+#endif
+};
+
+static struct sensor_emul_data sensor_emul_data = {
+	.temperature_oversampling = 1,
+	.humidity_oversampling = 1,
+	.pressure_oversampling = 1,
+	.mode = ESS_SENSOR_MODE_FORCED,
+};
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static int32_t interpolate(int32_t from, int32_t to, int32_t position,
+			   int32_t span);
+static uint32_t conversion_time_us(struct sensor_emul_data *data,
+				   enum sensor_channel chan);
+static int32_t iir_filter(int32_t previous, int32_t value, uint8_t coefficient);
+static void trace_position(struct emul_trace_point *point);
+static int sensor_emul_init(const struct device *dev);
+static int sensor_emul_attr_set(const struct device *dev,
+				enum sensor_channel chan,
+				enum sensor_attribute attr,
+				const struct sensor_value *val);
+static int sensor_emul_sample_fetch(const struct device *dev,
+				    enum sensor_channel chan);
+static int sensor_emul_channel_get(const struct device *dev,
+				   enum sensor_channel chan,
+				   struct sensor_value *val);
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static int32_t interpolate(int32_t from, int32_t to, int32_t position,
+			   int32_t span)
+{
+	return from + (int32_t)(((int64_t)(to - from) * position) / span);
+}
+
+static uint32_t conversion_time_us(struct sensor_emul_data *data,
+				   enum sensor_channel chan)
+{
+	uint32_t time_us = CONVERSION_BASE_US;
+
+	if ((chan == SENSOR_CHAN_ALL || chan == SENSOR_CHAN_AMBIENT_TEMP) &&
+	    data->temperature_oversampling != 0) {
+		time_us += CONVERSION_PER_OVERSAMPLE_US *
+			   data->temperature_oversampling;
+	}
+
+	if ((chan == SENSOR_CHAN_ALL || chan == SENSOR_CHAN_PRESS) &&
+	    data->pressure_oversampling != 0) {
+		time_us += CONVERSION_PER_OVERSAMPLE_US *
+				   data->pressure_oversampling +
+			   CONVERSION_CHANNEL_SETUP_US;
+	}
+
+	if ((chan == SENSOR_CHAN_ALL || chan == SENSOR_CHAN_HUMIDITY) &&
+	    data->humidity_oversampling != 0) {
+		time_us += CONVERSION_PER_OVERSAMPLE_US *
+				   data->humidity_oversampling +
+			   CONVERSION_CHANNEL_SETUP_US;
+	}
+
+	return time_us;
+}
+
+static int32_t iir_filter(int32_t previous, int32_t value, uint8_t coefficient)
+{
+	if (coefficient == 0) {
+		return value;
+	}
+
+	return (previous * (coefficient - 1) + value) / coefficient;
+}
+
+static void trace_position(struct emul_trace_point *point)
+{
+	const struct emul_trace_point *from, *to;
+	int64_t position;
+	int32_t offset;
+	size_t index;
+
+	position = k_uptime_get() * CONFIG_ESS_SENSOR_EMUL_SPEED;
+	index = (size_t)((position / CONFIG_ESS_SENSOR_EMUL_STEP_MS) %
+			 ARRAY_SIZE(emul_trace));
+	offset = (int32_t)(position % CONFIG_ESS_SENSOR_EMUL_STEP_MS);
+
+	from = &emul_trace[index];
+	to = &emul_trace[(index + 1) % ARRAY_SIZE(emul_trace)];
+
+	point->temperature = interpolate(from->temperature, to->temperature,
+					 offset,
+					 CONFIG_ESS_SENSOR_EMUL_STEP_MS);
+	point->humidity = interpolate(from->humidity, to->humidity, offset,
+				      CONFIG_ESS_SENSOR_EMUL_STEP_MS);
+	point->pressure = interpolate(from->pressure, to->pressure, offset,
+				      CONFIG_ESS_SENSOR_EMUL_STEP_MS);
+	point->gas_resistance =
+		interpolate(from->gas_resistance, to->gas_resistance, offset,
+			    CONFIG_ESS_SENSOR_EMUL_STEP_MS);
+}
+
+static int sensor_emul_sample_fetch(const struct device *dev,
+				    enum sensor_channel chan)
+{
+	struct sensor_emul_data *data = dev->data;
+	struct emul_trace_point point;
+	uint32_t time_us = CONFIG_ESS_SENSOR_EMUL_BUS_US;
+
+	if (chan == SENSOR_CHAN_GAS_RES) {
+		if (data->heater_duration_ms == 0) {
+			return -ENOTSUP;
+		}
+
+		/* The heater temperature is not emulated, the resistance is
+		 * taken from the trace whatever the profile
+		 */
+		k_usleep(time_us + data->heater_duration_ms * USEC_PER_MSEC +
+			 GAS_CONVERSION_US);
+		trace_position(&point);
+		data->sample.gas_resistance = point.gas_resistance;
+
+		return 0;
+	} else if (chan != SENSOR_CHAN_ALL &&
+		   chan != SENSOR_CHAN_AMBIENT_TEMP &&
+		   chan != SENSOR_CHAN_HUMIDITY && chan != SENSOR_CHAN_PRESS) {
+		return -ENOTSUP;
+	}
+
+	/* In normal mode the conversion has already taken place in the
+	 * background, only the bus transfer is needed
+	 */
+	if (data->mode == ESS_SENSOR_MODE_FORCED) {
+		time_us += conversion_time_us(data, chan);
+	}
+	k_usleep(time_us);
+
+	trace_position(&point);
+
+	if (!data->filter_primed) {
+		data->temperature_filtered = point.temperature;
+		data->pressure_filtered = point.pressure;
+		data->filter_primed = true;
+	}
+
+	if ((chan == SENSOR_CHAN_ALL || chan == SENSOR_CHAN_AMBIENT_TEMP) &&
+	    data->temperature_oversampling != 0) {
+		data->temperature_filtered =
+			iir_filter(data->temperature_filtered,
+				   point.temperature, data->iir_filter);
+		data->sample.temperature = data->temperature_filtered;
+	}
+
+	if ((chan == SENSOR_CHAN_ALL || chan == SENSOR_CHAN_HUMIDITY) &&
+	    data->humidity_oversampling != 0) {
+		data->sample.humidity = point.humidity;
+	}
+
+	if ((chan == SENSOR_CHAN_ALL || chan == SENSOR_CHAN_PRESS) &&
+	    data->pressure_oversampling != 0) {
+		data->pressure_filtered = iir_filter(data->pressure_filtered,
+						     point.pressure,
+						     data->iir_filter);
+		data->sample.pressure = data->pressure_filtered;
+	}
+
+	return 0;
+}
+
+static int sensor_emul_attr_set(const struct device *dev,
+				enum sensor_channel chan,
+				enum sensor_attribute attr,
+				const struct sensor_value *val)
+{
+	struct sensor_emul_data *data = dev->data;
+
+	if (attr == SENSOR_ATTR_OVERSAMPLING) {
+		switch (chan) {
+		case SENSOR_CHAN_AMBIENT_TEMP:
+			data->temperature_oversampling = val->val1;
+			break;
+		case SENSOR_CHAN_HUMIDITY:
+			data->humidity_oversampling = val->val1;
+			break;
+		case SENSOR_CHAN_PRESS:
+			data->pressure_oversampling = val->val1;
+			break;
+		default:
+			return -ENOTSUP;
+		}
+	} else if ((int)attr == ESS_SENSOR_ATTR_IIR_FILTER) {
+		data->iir_filter = val->val1;
+	} else if ((int)attr == ESS_SENSOR_ATTR_MODE) {
+		data->mode = (enum ess_sensor_mode)val->val1;
+	} else if ((int)attr == ESS_SENSOR_ATTR_STANDBY_TIME) {
+		/* Normal mode results are taken from the trace at the time of
+		 * the read, so the standby time has no effect
+		 */
+	} else if ((int)attr == ESS_SENSOR_ATTR_HEATER_TEMPERATURE) {
+		/* Only the heater duration changes the emulated timing */
+	} else if ((int)attr == ESS_SENSOR_ATTR_HEATER_DURATION) {
+		data->heater_duration_ms = val->val1;
+	} else {
+		return -ENOTSUP;
+	}
+
+	return 0;
+}
+
+static int sensor_emul_channel_get(const struct device *dev,
+				   enum sensor_channel chan,
+				   struct sensor_value *val)
+{
+	struct sensor_emul_data *data = dev->data;
+
+	switch (chan) {
+	case SENSOR_CHAN_AMBIENT_TEMP:
+		val->val1 = data->sample.temperature / TEMPERATURE_VAL1_DIVIDER;
+		val->val2 = (data->sample.temperature %
+			     TEMPERATURE_VAL1_DIVIDER) *
+			    TEMPERATURE_VAL2_MULTIPLIER;
+		break;
+	case SENSOR_CHAN_HUMIDITY:
+		val->val1 = data->sample.humidity / HUMIDITY_VAL1_DIVIDER;
+		val->val2 = (data->sample.humidity % HUMIDITY_VAL1_DIVIDER) *
+			    HUMIDITY_VAL2_MULTIPLIER;
+		break;
+	case SENSOR_CHAN_PRESS:
+		/* Zephyr reports pressure in kilopascals */
+		val->val1 = data->sample.pressure / PRESSURE_VAL1_DIVIDER;
+		val->val2 = (data->sample.pressure % PRESSURE_VAL1_DIVIDER) *
+			    PRESSURE_VAL2_MULTIPLIER;
+		break;
+	case SENSOR_CHAN_GAS_RES:
+		val->val1 = data->sample.gas_resistance;
+		val->val2 = 0;
+		break;
+	default:
+		return -ENOTSUP;
+	}
+
+	return 0;
+}
+
+static int sensor_emul_init(const struct device *dev)
+{
+	LOG_INF("Emulated sensor replaying %u trace points every %d ms",
+		(uint32_t)ARRAY_SIZE(emul_trace),
+		CONFIG_ESS_SENSOR_EMUL_STEP_MS);
+
+	return 0;
+}
+
+static const struct sensor_driver_api sensor_emul_api = {
+	.attr_set = sensor_emul_attr_set,
+	.sample_fetch = sensor_emul_sample_fetch,
+	.channel_get = sensor_emul_channel_get,
+};
+
+DEVICE_DEFINE(sensor_emul, CONFIG_ESS_SENSOR_EMUL_DEV_NAME, sensor_emul_init,
+	      NULL, &sensor_emul_data, NULL, POST_KERNEL,
+	      CONFIG_SENSOR_INIT_PRIORITY, &sensor_emul_api);
@@ -0,0 +1,115 @@
+/**
+ * @file trace.c
+ * @brief Per-stage latency histograms of the sample pipeline
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <string.h>
+
+#include "trace.h"
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static uint32_t cycles_to_us(uint32_t cycles);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static const char *const trace_stage_names[TRACE_STAGE_COUNT] = {
+	[TRACE_STAGE_QUEUE_WAIT] = "queue wait",
+	[TRACE_STAGE_SENSOR_FETCH] = "sensor fetch",
+	[TRACE_STAGE_CONVERSION] = "conversion",
+	[TRACE_STAGE_GAS] = "gas heater",
+	[TRACE_STAGE_DERIVED] = "derived metrics",
+	[TRACE_STAGE_GATT] = "gatt update",
+	[TRACE_STAGE_LCD_GRAPH] = "lcd graph",
+	[TRACE_STAGE_LCD_TASKS] = "lvgl tasks",
+	[TRACE_STAGE_PIPELINE] = "trigger to gatt",
+};
+
+/* Stages are recorded from the acquisition thread and the system workqueue
+ * and read from the shell and Bluetooth threads
+ */
+static struct k_spinlock trace_lock;
+static struct trace_stage_stats trace_stages[TRACE_STAGE_COUNT];
+static uint32_t trace_clock_hz;
+static uint32_t trace_cycles_per_us;
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static uint32_t cycles_to_us(uint32_t cycles)
+{
+	/* A 32-bit divide for clocks of 1 MHz and above, only slower clocks
+	 * need the 64-bit conversion
+	 */
+	if (trace_cycles_per_us > 0) {
+		return cycles / trace_cycles_per_us;
+	}
+
+	return (uint32_t)(((uint64_t)cycles * USEC_PER_SEC) / trace_clock_hz);
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void trace_init(void)
+{
+#ifdef CONFIG_CORTEX_M_DWT
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	trace_clock_hz = SystemCoreClock;
+#else
+	trace_clock_hz = sys_clock_hw_cycles_per_sec();
+#endif
+
+	trace_cycles_per_us = trace_clock_hz / USEC_PER_SEC;
+}
+
+void trace_record(enum trace_stage stage, uint32_t start)
+{
+	/* Unsigned subtraction handles the 32-bit counter wrapping */
+	uint32_t us = cycles_to_us(trace_begin() - start);
+	struct trace_stage_stats *stats = &trace_stages[stage];
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&trace_lock);
+
+	++stats->count;
+	stats->total_us += us;
+	stats->max_us = MAX(stats->max_us, us);
+	++stats->buckets[MIN(find_msb_set(us), TRACE_HISTOGRAM_BUCKETS - 1)];
+
+	k_spin_unlock(&trace_lock, key);
+}
+
+void trace_get_stage(enum trace_stage stage, struct trace_stage_stats *stats)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&trace_lock);
+	*stats = trace_stages[stage];
+	k_spin_unlock(&trace_lock, key);
+}
+
+const char *trace_stage_name(enum trace_stage stage)
+{
+	return trace_stage_names[stage];
+}
+
+void trace_reset(void)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&trace_lock);
+	memset(trace_stages, 0, sizeof(trace_stages));
+	k_spin_unlock(&trace_lock, key);
+}
@@ -0,0 +1,136 @@
+/**
+ * @file trace_service.c
+ * @brief Vendor specific service exporting the sample pipeline latency
+ * histograms
+ *
+ * The histograms are too large for a single ATT read, so a snapshot is
+ * taken when a read starts at offset 0 and later read blob requests return
+ * the rest of the same snapshot.
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <logging/log.h>
+#include <sys/byteorder.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/uuid.h>
+#include <bluetooth/gatt.h>
+
+#include "trace_service.h"
+#include "trace.h"
+
+LOG_MODULE_REGISTER(trace_service);
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define TRACE_OPCODE_RESET 0x01
+#define ATT_MAX_ATTRIBUTE_LEN 512
+
+/* Number of stages, number of buckets */
+#define HEADER_SIZE 2
+/* Count, mean, maximum, uint16 buckets */
+#define STAGE_SIZE (3 * sizeof(uint32_t) +                                    \
+		    TRACE_HISTOGRAM_BUCKETS * sizeof(uint16_t))
+#define SNAPSHOT_SIZE (HEADER_SIZE + TRACE_STAGE_COUNT * STAGE_SIZE)
+
+BUILD_ASSERT(SNAPSHOT_SIZE <= ATT_MAX_ATTRIBUTE_LEN,
+	     "Trace histograms do not fit in an attribute");
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static void take_snapshot(void);
+static ssize_t read_histograms(struct bt_conn *conn,
+			       const struct bt_gatt_attr *attr, void *buf,
+			       uint16_t len, uint16_t offset);
+static ssize_t write_histograms(struct bt_conn *conn,
+				const struct bt_gatt_attr *attr,
+				const void *buf, uint16_t len,
+				uint16_t offset, uint8_t flags);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static uint8_t trace_snapshot[SNAPSHOT_SIZE];
+
+BT_GATT_SERVICE_DEFINE(
+	trace_svc, BT_GATT_PRIMARY_SERVICE(BT_UUID_TRACE_SERVICE),
+	BT_GATT_CHARACTERISTIC(BT_UUID_TRACE_HISTOGRAMS,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+			       read_histograms, write_histograms, NULL), );
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static void take_snapshot(void)
+{
+	struct trace_stage_stats stats;
+	uint8_t *data = trace_snapshot;
+	enum trace_stage stage;
+	size_t i;
+
+	*data++ = TRACE_STAGE_COUNT;
+	*data++ = TRACE_HISTOGRAM_BUCKETS;
+
+	for (stage = 0; stage < TRACE_STAGE_COUNT; ++stage) {
+		trace_get_stage(stage, &stats);
+
+		sys_put_le32(stats.count, data);
+		data += sizeof(uint32_t);
+		sys_put_le32((stats.count == 0 ?
+				      0 :
+				      (uint32_t)(stats.total_us / stats.count)),
+			     data);
+		data += sizeof(uint32_t);
+		sys_put_le32(stats.max_us, data);
+		data += sizeof(uint32_t);
+
+		for (i = 0; i < ARRAY_SIZE(stats.buckets); ++i) {
+			sys_put_le16(MIN(stats.buckets[i], UINT16_MAX), data);
+			data += sizeof(uint16_t);
+		}
+	}
+}
+
+static ssize_t read_histograms(struct bt_conn *conn,
+			       const struct bt_gatt_attr *attr, void *buf,
+			       uint16_t len, uint16_t offset)
+{
+	if (offset == 0) {
+		take_snapshot();
+	}
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, trace_snapshot,
+				 sizeof(trace_snapshot));
+}
+
+static ssize_t write_histograms(struct bt_conn *conn,
+				const struct bt_gatt_attr *attr,
+				const void *buf, uint16_t len,
+				uint16_t offset, uint8_t flags)
+{
+	const uint8_t *data = buf;
+
+	if (offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	} else if (len != 1) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	} else if (data[0] != TRACE_OPCODE_RESET) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+
+	trace_reset();
+	LOG_DBG("Trace histograms reset by connection %u",
+		bt_conn_index(conn));
+
+	return len;
+}
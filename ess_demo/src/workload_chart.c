@@ -0,0 +1,68 @@
+/**
+ * @file workload_chart.c
+ * @brief Day of samples added to the chart zoom levels by the benchmarks
+ * and tests
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+
+#include "chart_reducer.h"
+#include "workload.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define CHART_VALUE_RANGE 1000
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static const uint32_t chart_windows_ms[WORKLOAD_CHART_LEVELS] = {
+	60 * MSEC_PER_SEC,
+	60 * 60 * MSEC_PER_SEC,
+	24 * 60 * 60 * MSEC_PER_SEC,
+};
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void workload_chart_init(struct chart_reducer_level *levels, int16_t blank)
+{
+	size_t level;
+
+	for (level = 0; level < WORKLOAD_CHART_LEVELS; ++level) {
+		chart_reducer_init(&levels[level], chart_windows_ms[level],
+				   WORKLOAD_CHART_SAMPLE_PERIOD_MS, blank);
+	}
+}
+
+uint32_t workload_chart_run(struct chart_reducer_level *levels)
+{
+	int16_t values[CHART_REDUCER_SERIES];
+	uint32_t points = 0;
+	int64_t time;
+	size_t level;
+	size_t i;
+	uint32_t n;
+
+	for (n = 0; n < WORKLOAD_CHART_SAMPLES; ++n) {
+		time = (int64_t)n * WORKLOAD_CHART_SAMPLE_PERIOD_MS;
+		for (i = 0; i < ARRAY_SIZE(values); ++i) {
+			values[i] = (int16_t)((n * (i + 1)) %
+					      CHART_VALUE_RANGE);
+		}
+		for (level = 0; level < WORKLOAD_CHART_LEVELS; ++level) {
+			points += chart_reducer_add(&levels[level], time,
+						    values);
+		}
+	}
+
+	return points;
+}
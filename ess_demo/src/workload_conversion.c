@@ -0,0 +1,70 @@
+/**
+ * @file workload_conversion.c
+ * @brief Sensor value grids and conversion baseline of the benchmarks and
+ * tests
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <drivers/sensor.h>
+
+#include "sensor.h"
+#include "workload.h"
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static const struct conversion_grid
+	conversion_grids[CONVERSION_CHANNEL_COUNT] = {
+	[CONVERSION_CHANNEL_TEMPERATURE] = { "temperature",
+					     GRID_SENSOR_TEMPERATURE_MIN,
+					     GRID_SENSOR_TEMPERATURE_MAX, 100 },
+	[CONVERSION_CHANNEL_HUMIDITY] = { "humidity", GRID_SENSOR_HUMIDITY_MIN,
+					  GRID_SENSOR_HUMIDITY_MAX, 100 },
+	[CONVERSION_CHANNEL_PRESSURE] = { "pressure", GRID_SENSOR_PRESSURE_MIN,
+					  GRID_SENSOR_PRESSURE_MAX, 10000 },
+};
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+const struct conversion_grid *
+workload_conversion_grid(enum conversion_channel channel)
+{
+	return &conversion_grids[channel];
+}
+
+void workload_conversion_value(struct sensor_value *value, int32_t whole,
+			       int32_t fraction)
+{
+	value->val1 = whole;
+	value->val2 = (whole < 0 ? -fraction : fraction);
+}
+
+int32_t workload_conversion_fixed(enum conversion_channel channel,
+				  const struct sensor_value *value)
+{
+	switch (channel) {
+	case CONVERSION_CHANNEL_TEMPERATURE:
+		return sensor_value_to_temperature(value);
+	case CONVERSION_CHANNEL_HUMIDITY:
+		return sensor_value_to_humidity(value);
+	case CONVERSION_CHANNEL_PRESSURE:
+	default:
+		return (int32_t)sensor_value_to_pressure(value);
+	}
+}
+
+int32_t workload_conversion_float(enum conversion_channel channel,
+				  const struct sensor_value *value)
+{
+	return (int32_t)((value->val1 +
+			  value->val2 / (float)SENSOR_FRACTION_DIVIDER) *
+			 conversion_grids[channel].multiplier);
+}
@@ -0,0 +1,44 @@
+/**
+ * @file workload_dewpoint.c
+ * @brief Dew point baseline and reference of the benchmarks and tests
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <math.h>
+
+#include "workload.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define CENTI_DIVIDER 100.0f
+#define HUMIDITY_DIVIDER 10000.0f
+#define MAGNUS_B 17.62f
+#define MAGNUS_C 243.12f
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+float workload_dew_point_float(int16_t temperature, uint16_t humidity)
+{
+	float t = temperature / CENTI_DIVIDER;
+	float gamma = logf(humidity / HUMIDITY_DIVIDER) +
+		      (MAGNUS_B * t) / (MAGNUS_C + t);
+
+	return MAGNUS_C * gamma / (MAGNUS_B - gamma);
+}
+
+double workload_dew_point_exact(int16_t temperature, uint16_t humidity)
+{
+	double t = temperature / 100.0;
+	double gamma = log(humidity / 10000.0) + (17.62 * t) / (243.12 + t);
+
+	return 24312.0 * gamma / (17.62 - gamma);
+}
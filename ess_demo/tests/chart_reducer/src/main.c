@@ -0,0 +1,239 @@
+/**
+ * @file main.c
+ * @brief Point and benchmark tests of the chart min/max downsampling
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <ztest.h>
+
+#include "chart_reducer.h"
+#include "test_budget.h"
+#include "workload.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define CHART_WINDOW_MS (60 * MSEC_PER_SEC)
+#define CHART_BLANK INT16_MAX
+
+/* Series which rise then fall back within a bucket and the reverse */
+#define SERIES_RISING 0
+#define SERIES_FALLING 1
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static struct chart_reducer_level chart_levels[WORKLOAD_CHART_LEVELS];
+
+static const int16_t bucket_values[][CHART_REDUCER_SERIES] = {
+	{ 10, 50, 7, 7 },
+	{ 50, 10, 7, 7 },
+	{ 30, 30, 7, 7 },
+};
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static void test_chart_reducer_blank(void)
+{
+	struct chart_reducer_level *level = &chart_levels[0];
+	size_t i, j;
+
+	chart_reducer_init(level, CHART_WINDOW_MS, 0, CHART_BLANK);
+
+	zassert_equal(level->bucket_ms, CHART_WINDOW_MS / CHART_REDUCER_BUCKETS,
+		      "Window is not split into the buckets");
+	zassert_equal(level->point_count, CHART_REDUCER_POINTS,
+		      "Not all the points are used");
+	zassert_equal(level->head, 0, "Head is not at the start");
+	for (i = 0; i < CHART_REDUCER_SERIES; ++i) {
+		for (j = 0; j < CHART_REDUCER_POINTS; ++j) {
+			zassert_equal(level->points[i][j], CHART_BLANK,
+				      "Point %u of series %u is not blank",
+				      (uint32_t)j, (uint32_t)i);
+		}
+	}
+
+	/* The first sample opens a bucket, nothing is drawn yet */
+	zassert_equal(chart_reducer_add(level, 0, bucket_values[0]), 0,
+		      "Points written before a bucket closed");
+}
+
+static void test_chart_reducer_min_max_order(void)
+{
+	struct chart_reducer_level *level = &chart_levels[0];
+	uint16_t written;
+	size_t i;
+
+	chart_reducer_init(level, CHART_WINDOW_MS, 0, CHART_BLANK);
+
+	for (i = 0; i < ARRAY_SIZE(bucket_values); ++i) {
+		zassert_equal(chart_reducer_add(level, i, bucket_values[i]), 0,
+			      "Bucket closed early");
+	}
+
+	/* A sample at the end of the bucket closes it */
+	written = chart_reducer_add(level, level->bucket_ms, bucket_values[0]);
+	zassert_equal(written, 2, "Closed bucket is not two points");
+	zassert_equal(level->head, 2, "Head did not advance");
+
+	/* The extremes are drawn in the order they occurred */
+	zassert_equal(level->points[SERIES_RISING][0], 10, "Minimum not first");
+	zassert_equal(level->points[SERIES_RISING][1], 50, "Maximum not last");
+	zassert_equal(level->points[SERIES_FALLING][0], 50,
+		      "Maximum not first");
+	zassert_equal(level->points[SERIES_FALLING][1], 10,
+		      "Minimum not last");
+	zassert_equal(level->points[2][0], 7, "Constant series changed");
+	zassert_equal(level->points[2][1], 7, "Constant series changed");
+}
+
+static void test_chart_reducer_gap(void)
+{
+	struct chart_reducer_level *level = &chart_levels[0];
+	const uint16_t skipped = 3;
+	uint16_t written;
+	size_t i;
+
+	chart_reducer_init(level, CHART_WINDOW_MS, 0, CHART_BLANK);
+
+	for (i = 0; i < ARRAY_SIZE(bucket_values); ++i) {
+		chart_reducer_add(level, i, bucket_values[i]);
+	}
+
+	/* Buckets with no samples hold the line at the last value */
+	written = chart_reducer_add(level, (skipped + 1) * level->bucket_ms,
+				    bucket_values[0]);
+	zassert_equal(written, (skipped + 1) * 2, "Skipped buckets not drawn");
+
+	for (i = 2; i < written; ++i) {
+		zassert_equal(level->points[SERIES_RISING][i],
+			      bucket_values[ARRAY_SIZE(bucket_values) - 1]
+					   [SERIES_RISING],
+			      "Point %u is not the last value",
+			      (uint32_t)i);
+	}
+}
+
+static void test_chart_reducer_gap_capped(void)
+{
+	struct chart_reducer_level *level = &chart_levels[0];
+	uint16_t written;
+
+	chart_reducer_init(level, CHART_WINDOW_MS, 0, CHART_BLANK);
+	chart_reducer_add(level, 0, bucket_values[0]);
+
+	/* At most one window is drawn however long the gap is */
+	written = chart_reducer_add(level, 10 * CHART_WINDOW_MS,
+				    bucket_values[1]);
+	zassert_equal(written, CHART_REDUCER_POINTS,
+		      "Gap drew more than one window");
+	zassert_equal(level->head, 0, "Head did not wrap");
+}
+
+static void test_chart_reducer_clear(void)
+{
+	struct chart_reducer_level *level = &chart_levels[0];
+	size_t i;
+
+	chart_reducer_init(level, CHART_WINDOW_MS, 0, CHART_BLANK);
+	chart_reducer_add(level, 0, bucket_values[0]);
+	chart_reducer_add(level, level->bucket_ms, bucket_values[1]);
+
+	chart_reducer_clear(level);
+
+	zassert_equal(level->head, 0, "Head is not at the start");
+	for (i = 0; i < CHART_REDUCER_SERIES; ++i) {
+		zassert_equal(level->points[i][0], CHART_BLANK,
+			      "Series %u is not blank", (uint32_t)i);
+	}
+
+	/* The open bucket is discarded, so the first sample opens a new one */
+	zassert_equal(chart_reducer_add(level, 2 * level->bucket_ms,
+					bucket_values[0]),
+		      0, "Bucket from before the clear was closed");
+}
+
+static void test_chart_reducer_min_bucket(void)
+{
+	struct chart_reducer_level *level = &chart_levels[0];
+	const uint32_t period_ms = CONFIG_ESS_SAMPLE_PERIOD_MIN_MS;
+	uint16_t written;
+
+	chart_reducer_init(level, CHART_WINDOW_MS, period_ms, CHART_BLANK);
+
+	/* Every bucket is at least one sample period, so none are drawn
+	 * without a sample of their own
+	 */
+	zassert_true(level->bucket_ms >= period_ms,
+		     "Bucket of %u ms is shorter than the sample period",
+		     level->bucket_ms);
+	zassert_equal(level->point_count,
+		      MIN(CHART_WINDOW_MS / period_ms, CHART_REDUCER_BUCKETS) *
+			      2,
+		      "Window is not split into sample periods");
+
+	/* The ring wraps at the points in use */
+	chart_reducer_add(level, 0, bucket_values[0]);
+	written = chart_reducer_add(level, 10 * CHART_WINDOW_MS,
+				    bucket_values[1]);
+	zassert_equal(written, level->point_count,
+		      "Gap drew more than one window");
+	zassert_equal(level->head, 0, "Head did not wrap");
+}
+
+static void test_chart_reducer_benchmark(void)
+{
+	uint32_t expected = 0;
+	uint32_t points;
+	uint32_t start, end;
+	int64_t time;
+	size_t level;
+
+	workload_chart_init(chart_levels, CHART_BLANK);
+
+	start = k_cycle_get_32();
+	points = workload_chart_run(chart_levels);
+	end = k_cycle_get_32();
+
+	/* Buckets are aligned to their length, every one which ended before
+	 * the last sample has been drawn
+	 */
+	time = (int64_t)(WORKLOAD_CHART_SAMPLES - 1) *
+	       WORKLOAD_CHART_SAMPLE_PERIOD_MS;
+	for (level = 0; level < ARRAY_SIZE(chart_levels); ++level) {
+		expected += (uint32_t)(time / chart_levels[level].bucket_ms) *
+			    2;
+	}
+	zassert_equal(points, expected, "%u points drawn instead of %u",
+		      points, expected);
+
+	test_budget_check("chart",
+			  test_budget_ns_per_op(start, end,
+						WORKLOAD_CHART_SAMPLES),
+			  CONFIG_ESS_TEST_CHART_BUDGET_NS);
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void test_main(void)
+{
+	ztest_test_suite(chart_reducer,
+			 ztest_unit_test(test_chart_reducer_blank),
+			 ztest_unit_test(test_chart_reducer_min_max_order),
+			 ztest_unit_test(test_chart_reducer_gap),
+			 ztest_unit_test(test_chart_reducer_gap_capped),
+			 ztest_unit_test(test_chart_reducer_clear),
+			 ztest_unit_test(test_chart_reducer_min_bucket),
+			 ztest_unit_test(test_chart_reducer_benchmark));
+
+	ztest_run_test_suite(chart_reducer);
+}
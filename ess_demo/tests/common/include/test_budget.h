@@ -0,0 +1,64 @@
+/**
+ * @file test_budget.h
+ * @brief Timing of the benchmark test cases against a per-platform budget
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __TEST_BUDGET_H__
+#define __TEST_BUDGET_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <ztest.h>
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+/**
+ * @brief Gets the average time of the operations of a timed loop
+ *
+ * @param Cycle count before the loop
+ * @param Cycle count after the loop
+ * @param Number of operations run by the loop
+ *
+ * @retval Time of each operation in ns
+ */
+static inline uint32_t test_budget_ns_per_op(uint32_t start, uint32_t end,
+					     uint32_t operations)
+{
+	return (uint32_t)(k_cyc_to_ns_floor64(end - start) /
+			  MAX(operations, 1));
+}
+
+/**
+ * @brief Reports the time of an operation and fails the test case if it is
+ * over the budget. Budgets are set for each platform by the testcase.yaml of
+ * the suite, a budget of 0 is not checked
+ *
+ * @param Name of the operation
+ * @param Time of each operation in ns
+ * @param Budget in ns
+ */
+static inline void test_budget_check(const char *name, uint32_t ns_per_op,
+				     uint32_t budget_ns)
+{
+	TC_PRINT("%s: %u ns/op, budget %u ns\n", name, ns_per_op, budget_ns);
+
+	zassert_true(budget_ns == 0 || ns_per_op <= budget_ns,
+		     "%s regressed, %u ns/op is over the budget of %u ns",
+		     name, ns_per_op, budget_ns);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TEST_BUDGET_H__ */
@@ -0,0 +1,159 @@
+/**
+ * @file main.c
+ * @brief Accuracy and benchmark tests of the sensor value conversions
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <ztest.h>
+#include <drivers/sensor.h>
+
+#include "sensor.h"
+#include "test_budget.h"
+#include "workload.h"
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+/* Prevents the compiler from optimising away the calculations */
+static volatile int32_t test_sink;
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static void test_conversion_accuracy(void)
+{
+	const struct conversion_grid *grid;
+	enum conversion_channel channel;
+	struct sensor_value value;
+	int64_t micro, expected;
+	int32_t whole, fraction;
+	int32_t result;
+
+	for (channel = 0; channel < CONVERSION_CHANNEL_COUNT; ++channel) {
+		grid = workload_conversion_grid(channel);
+
+		for (whole = grid->min; whole <= grid->max; ++whole) {
+			for (fraction = 0; fraction < SENSOR_FRACTION_DIVIDER;
+			     fraction += GRID_SENSOR_FRACTION_STEP) {
+				workload_conversion_value(&value, whole,
+							  fraction);
+
+				/* The whole number and fraction have the same
+				 * sign, so the conversion truncates the exact
+				 * value towards zero
+				 */
+				micro = (int64_t)value.val1 *
+						SENSOR_FRACTION_DIVIDER +
+					value.val2;
+				expected = micro * grid->multiplier /
+					   SENSOR_FRACTION_DIVIDER;
+				result = workload_conversion_fixed(channel,
+								   &value);
+				zassert_equal(result, expected,
+					      "%s %d.%06d is not %d",
+					      grid->name, whole, fraction,
+					      (int32_t)expected);
+			}
+		}
+	}
+}
+
+static void test_conversion_negative(void)
+{
+	struct sensor_value value;
+
+	/* A negative fraction must not be added to the whole number */
+	workload_conversion_value(&value, -5, 500000);
+	zassert_equal(sensor_value_to_temperature(&value), -550,
+		      "-5.5 C is not -550");
+
+	value.val1 = 0;
+	value.val2 = -250000;
+	zassert_equal(sensor_value_to_temperature(&value), -25,
+		      "-0.25 C is not -25");
+}
+
+static void test_conversion_gas_resistance(void)
+{
+	struct sensor_value value;
+
+	/* The resistance is in whole ohms, a negative reading is invalid */
+	workload_conversion_value(&value, 123456, 789000);
+	zassert_equal(sensor_value_to_gas_resistance(&value), 123456,
+		      "Fraction of an ohm is not dropped");
+
+	workload_conversion_value(&value, -1, 0);
+	zassert_equal(sensor_value_to_gas_resistance(&value), 0,
+		      "Negative resistance is not 0");
+}
+
+static void test_conversion_benchmark(void)
+{
+	const struct conversion_grid *grid;
+	enum conversion_channel channel;
+	struct sensor_value value;
+	uint32_t fixed_ops = 0;
+	uint32_t float_ops = 0;
+	uint32_t fixed_cycles = 0;
+	uint32_t float_cycles = 0;
+	uint32_t start;
+	int32_t whole, fraction;
+
+	for (channel = 0; channel < CONVERSION_CHANNEL_COUNT; ++channel) {
+		grid = workload_conversion_grid(channel);
+
+		start = k_cycle_get_32();
+		for (whole = grid->min; whole <= grid->max; ++whole) {
+			for (fraction = 0; fraction < SENSOR_FRACTION_DIVIDER;
+			     fraction += GRID_SENSOR_FRACTION_STEP) {
+				workload_conversion_value(&value, whole,
+							  fraction);
+				test_sink = workload_conversion_float(channel,
+								     &value);
+				++float_ops;
+			}
+		}
+		float_cycles += k_cycle_get_32() - start;
+
+		start = k_cycle_get_32();
+		for (whole = grid->min; whole <= grid->max; ++whole) {
+			for (fraction = 0; fraction < SENSOR_FRACTION_DIVIDER;
+			     fraction += GRID_SENSOR_FRACTION_STEP) {
+				workload_conversion_value(&value, whole,
+							  fraction);
+				test_sink = workload_conversion_fixed(channel,
+								     &value);
+				++fixed_ops;
+			}
+		}
+		fixed_cycles += k_cycle_get_32() - start;
+	}
+
+	TC_PRINT("float: %u ns/op\n",
+		 test_budget_ns_per_op(0, float_cycles, float_ops));
+
+	/* Only the implementation used by the firmware is guarded */
+	test_budget_check("fixed",
+			  test_budget_ns_per_op(0, fixed_cycles, fixed_ops),
+			  CONFIG_ESS_TEST_CONVERSION_BUDGET_NS);
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void test_main(void)
+{
+	ztest_test_suite(conversion, ztest_unit_test(test_conversion_accuracy),
+			 ztest_unit_test(test_conversion_negative),
+			 ztest_unit_test(test_conversion_gas_resistance),
+			 ztest_unit_test(test_conversion_benchmark));
+
+	ztest_run_test_suite(conversion);
+}
@@ -0,0 +1,168 @@
+/**
+ * @file main.c
+ * @brief Accuracy and benchmark tests of the fixed point dew point
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <ztest.h>
+#include <math.h>
+
+#include "dewpoint.h"
+#include "fixed_math.h"
+#include "test_budget.h"
+#include "workload.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+/* The fixed point dew point is accurate to better than 0.01 C over the
+ * grid, in 0.01 C units
+ */
+#define DEW_POINT_FIXED_ERROR_MAX 5
+
+/* Humidity is clamped to the range of the sensor */
+#define HUMIDITY_MIN 1
+#define HUMIDITY_MAX 10000
+
+/* Error of the logarithm table interpolation in Q16.16, around 2e-4 */
+#define FIXED_LN_ERROR_MAX 16
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+/* Prevents the compiler from optimising away the calculations */
+static volatile int32_t test_sink;
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static void test_dew_point_accuracy(void)
+{
+	double error, error_max = 0;
+	int16_t t;
+	uint16_t h;
+
+	for (t = GRID_TEMPERATURE_MIN; t <= GRID_TEMPERATURE_MAX;
+	     t += GRID_TEMPERATURE_STEP) {
+		for (h = GRID_HUMIDITY_MIN; h <= GRID_HUMIDITY_MAX;
+		     h += GRID_HUMIDITY_STEP) {
+			error = fabs(calculate_dew_point_fixed(t, h) -
+				     workload_dew_point_exact(t, h));
+			zassert_true(error <= DEW_POINT_FIXED_ERROR_MAX,
+				     "Dew point at %d, %u is off by %d",
+				     t, h, (int32_t)error);
+			error_max = MAX(error, error_max);
+		}
+	}
+
+	TC_PRINT("Maximum error %u mC\n", (uint32_t)(error_max * 10.0));
+}
+
+static void test_dew_point_saturated(void)
+{
+	int16_t t;
+
+	/* At 100 % the air is saturated, the dew point is the temperature */
+	for (t = GRID_TEMPERATURE_MIN; t <= GRID_TEMPERATURE_MAX;
+	     t += GRID_TEMPERATURE_STEP) {
+		zassert_within(calculate_dew_point_fixed(t, HUMIDITY_MAX), t,
+			       DEW_POINT_FIXED_ERROR_MAX,
+			       "Saturated dew point at %d is not %d", t, t);
+	}
+}
+
+static void test_dew_point_humidity_clamp(void)
+{
+	int16_t t;
+
+	/* A reading of 0 % or over 100 % must not overflow the logarithm */
+	for (t = GRID_TEMPERATURE_MIN; t <= GRID_TEMPERATURE_MAX;
+	     t += GRID_TEMPERATURE_STEP) {
+		zassert_equal(calculate_dew_point_fixed(t, 0),
+			      calculate_dew_point_fixed(t, HUMIDITY_MIN),
+			      "0 %% at %d is not clamped", t);
+		zassert_equal(calculate_dew_point_fixed(t, UINT16_MAX),
+			      calculate_dew_point_fixed(t, HUMIDITY_MAX),
+			      "Over 100 %% at %d is not clamped", t);
+	}
+}
+
+static void test_fixed_ln_range(void)
+{
+	uint64_t value;
+	int32_t expected;
+
+	/* The interpolation must not overflow for the largest inputs */
+	for (value = 1; value <= UINT32_MAX; value = value * 3 + 1) {
+		expected = (int32_t)(log((double)value) * 65536.0);
+		zassert_within(fixed_ln_q16((uint32_t)value), expected,
+			       FIXED_LN_ERROR_MAX, "ln(%u) is not %d",
+			       (uint32_t)value, expected);
+	}
+
+	expected = (int32_t)(log((double)UINT32_MAX) * 65536.0);
+	zassert_within(fixed_ln_q16(UINT32_MAX), expected, FIXED_LN_ERROR_MAX,
+		       "ln(UINT32_MAX) is not %d", expected);
+}
+
+static void test_dew_point_benchmark(void)
+{
+	uint32_t operations = 0;
+	uint32_t start, end;
+	uint32_t ns_per_op;
+	int16_t t;
+	uint16_t h;
+
+	start = k_cycle_get_32();
+	for (t = GRID_TEMPERATURE_MIN; t <= GRID_TEMPERATURE_MAX;
+	     t += GRID_TEMPERATURE_STEP) {
+		for (h = GRID_HUMIDITY_MIN; h <= GRID_HUMIDITY_MAX;
+		     h += GRID_HUMIDITY_STEP) {
+			/* The baseline is only timed */
+			test_sink = workload_dew_point_float(t, h);
+			++operations;
+		}
+	}
+	end = k_cycle_get_32();
+
+	TC_PRINT("float: %u ns/op\n",
+		 test_budget_ns_per_op(start, end, operations));
+
+	operations = 0;
+	start = k_cycle_get_32();
+	for (t = GRID_TEMPERATURE_MIN; t <= GRID_TEMPERATURE_MAX;
+	     t += GRID_TEMPERATURE_STEP) {
+		for (h = GRID_HUMIDITY_MIN; h <= GRID_HUMIDITY_MAX;
+		     h += GRID_HUMIDITY_STEP) {
+			test_sink = calculate_dew_point_fixed(t, h);
+			++operations;
+		}
+	}
+	end = k_cycle_get_32();
+	ns_per_op = test_budget_ns_per_op(start, end, operations);
+
+	/* Only the implementation used by the firmware is guarded */
+	test_budget_check("fixed", ns_per_op,
+			  CONFIG_ESS_TEST_DEW_POINT_BUDGET_NS);
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void test_main(void)
+{
+	ztest_test_suite(dewpoint, ztest_unit_test(test_dew_point_accuracy),
+			 ztest_unit_test(test_dew_point_saturated),
+			 ztest_unit_test(test_dew_point_humidity_clamp),
+			 ztest_unit_test(test_fixed_ln_range),
+			 ztest_unit_test(test_dew_point_benchmark));
+
+	ztest_run_test_suite(dewpoint);
+}
@@ -0,0 +1,275 @@
+/**
+ * @file main.c
+ * @brief Chart and benchmark tests of the LCD graph on a headless display
+ *
+ * Copyright (c) 2021 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr.h>
+#include <ztest.h>
+#include <string.h>
+#include <lvgl.h>
+
+#include "acquisition.h"
+#include "lcd.h"
+#include "sample_ring.h"
+#include "test_budget.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define GRAPH_SERIES 4
+#define GRAPH_SAMPLE_PERIOD_MS 1000
+
+/* Samples written through the sample ring, two minutes so that every point
+ * of the minute zoom level is rewritten. The ring is filled by half at a
+ * time so that the chart reader does not fall behind
+ */
+#define RING_SAMPLES (2 * 60)
+#define RING_BATCH (CONFIG_ESS_SAMPLE_RING_SIZE / 2)
+
+/* An hour of samples passed to update_lcd_graph() directly */
+#define BENCHMARK_SAMPLES (60 * 60)
+#define BENCHMARK_VALUE_RANGE 4000
+
+/* Readings of the ring samples and the chart value of each series */
+#define RING_TEMPERATURE 2512
+#define RING_HUMIDITY 4567
+#define RING_PRESSURE 1013250
+#define RING_DEW_POINT 1234
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static void run_on_workqueue(void (*function)(void));
+static void test_work_handler(struct k_work *work);
+static void sync_workqueue(void);
+static lv_obj_t *find_chart(lv_obj_t *parent);
+static void read_chart(void);
+static void feed_graph(void);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+K_WORK_DEFINE(test_work, test_work_handler);
+K_SEM_DEFINE(test_work_done, 0, 1);
+
+static void (*test_work_function)(void);
+
+static const lv_coord_t ring_points[GRAPH_SERIES] = {
+	RING_TEMPERATURE / 100,
+	RING_HUMIDITY / 100,
+	RING_PRESSURE / 1000 - 980,
+	RING_DEW_POINT / 100,
+};
+
+static struct acquisition_consumer *graph_consumer;
+
+/* Uptime of the next sample, the test cases continue from each other */
+static int64_t graph_time;
+
+/* Newest point of each series shown by the chart */
+static bool chart_found;
+static size_t chart_series;
+static lv_coord_t chart_newest[GRAPH_SERIES];
+
+static uint32_t graph_ns_per_sample;
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+/* LVGL is only used from the system workqueue, as in the application */
+static void run_on_workqueue(void (*function)(void))
+{
+	test_work_function = function;
+	k_work_submit(&test_work);
+	k_sem_take(&test_work_done, K_FOREVER);
+}
+
+static void test_work_handler(struct k_work *work)
+{
+	test_work_function();
+	k_sem_give(&test_work_done);
+}
+
+/* Work submitted before this has run once it returns */
+static void sync_workqueue(void)
+{
+}
+
+static lv_obj_t *find_chart(lv_obj_t *parent)
+{
+	lv_obj_type_t type;
+	lv_obj_t *child = NULL;
+	lv_obj_t *chart;
+
+	lv_obj_get_type(parent, &type);
+	if (strcmp(type.type[0], "lv_chart") == 0) {
+		return parent;
+	}
+
+	while ((child = lv_obj_get_child(parent, child)) != NULL) {
+		chart = find_chart(child);
+		if (chart != NULL) {
+			return chart;
+		}
+	}
+
+	return NULL;
+}
+
+static void read_chart(void)
+{
+	lv_obj_t *chart = find_chart(lv_scr_act());
+	lv_chart_series_t *series;
+	lv_chart_ext_t *ext;
+	uint16_t count;
+	uint16_t newest;
+
+	chart_found = (chart != NULL);
+	chart_series = 0;
+	if (!chart_found) {
+		return;
+	}
+
+	ext = lv_obj_get_ext_attr(chart);
+	count = lv_chart_get_point_count(chart);
+
+	/* The start point is the oldest point, which is overwritten next */
+	_LV_LL_READ(ext->series_ll, series) {
+		if (chart_series < ARRAY_SIZE(chart_newest)) {
+			newest = (series->start_point + count - 1) % count;
+			chart_newest[chart_series] = series->points[newest];
+		}
+		++chart_series;
+	}
+}
+
+static void feed_graph(void)
+{
+	struct ess_sample sample = { 0 };
+	uint32_t start;
+	int32_t value;
+	uint32_t n;
+
+	start = k_cycle_get_32();
+	for (n = 0; n < BENCHMARK_SAMPLES; ++n) {
+		value = (int32_t)(n % BENCHMARK_VALUE_RANGE);
+		sample.timestamp = graph_time;
+		sample.temperature = (int16_t)(value - 1000);
+		sample.humidity = (uint16_t)(value * 2);
+		sample.pressure = 980000 + (uint32_t)value * 10;
+		sample.derived[DERIVED_METRIC_DEW_POINT] = value - 2000;
+		update_lcd_graph(&sample);
+		graph_time += GRAPH_SAMPLE_PERIOD_MS;
+	}
+	graph_ns_per_sample = test_budget_ns_per_op(start, k_cycle_get_32(),
+						    BENCHMARK_SAMPLES);
+}
+
+static void test_lcd_setup(void)
+{
+	size_t i;
+
+	setup_lcd(false, NULL);
+
+	zassert_true(is_lcd_present(), "Dummy display was not found");
+	zassert_not_null(graph_consumer, "Graph is not fed from the ring");
+
+	run_on_workqueue(read_chart);
+	zassert_true(chart_found, "No chart was created");
+	zassert_equal(chart_series, GRAPH_SERIES, "Chart has %u series",
+		      (uint32_t)chart_series);
+	for (i = 0; i < GRAPH_SERIES; ++i) {
+		zassert_equal(chart_newest[i], LV_CHART_POINT_DEF,
+			      "Series %u is not blank", (uint32_t)i);
+	}
+}
+
+static void test_lcd_graph_ring(void)
+{
+	struct ess_sample sample = { 0 };
+	struct lcd_stats before, after;
+	uint32_t found = 0;
+	uint32_t n;
+	size_t i, j;
+
+	lcd_get_stats(&before);
+
+	sample.temperature = RING_TEMPERATURE;
+	sample.humidity = RING_HUMIDITY;
+	sample.pressure = RING_PRESSURE;
+	sample.derived[DERIVED_METRIC_DEW_POINT] = RING_DEW_POINT;
+
+	/* Samples reach update_lcd_graph() through the consumer work, as
+	 * they do from the acquisition thread
+	 */
+	for (n = 0; n < RING_SAMPLES; ++n) {
+		sample.timestamp = graph_time;
+		sample.sequence = n;
+		sample_ring_write(&sample);
+		graph_time += GRAPH_SAMPLE_PERIOD_MS;
+
+		if ((n % RING_BATCH) == RING_BATCH - 1 ||
+		    n == RING_SAMPLES - 1) {
+			k_work_submit(graph_consumer->work);
+			run_on_workqueue(sync_workqueue);
+		}
+	}
+
+	/* The consumer work wakes the display, which then draws the chart */
+	run_on_workqueue(sync_workqueue);
+	lcd_get_stats(&after);
+	zassert_true(after.wakeups > before.wakeups,
+		     "Display was not woken by the new samples");
+
+	/* The series are not in a defined order, each must show one of the
+	 * readings
+	 */
+	run_on_workqueue(read_chart);
+	zassert_true(chart_found, "No chart was found");
+	for (i = 0; i < GRAPH_SERIES; ++i) {
+		for (j = 0; j < GRAPH_SERIES; ++j) {
+			if (chart_newest[i] == ring_points[j]) {
+				found |= BIT(j);
+			}
+		}
+	}
+	zassert_equal(found, BIT_MASK(GRAPH_SERIES),
+		      "Chart does not show the readings (%d %d %d %d)",
+		      chart_newest[0], chart_newest[1], chart_newest[2],
+		      chart_newest[3]);
+}
+
+static void test_lcd_graph_benchmark(void)
+{
+	run_on_workqueue(feed_graph);
+
+	test_budget_check("update_lcd_graph", graph_ns_per_sample,
+			  CONFIG_ESS_TEST_GRAPH_BUDGET_NS);
+}
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+/* Test double of the acquisition thread, the test cases write the samples
+ * to the ring instead
+ */
+void acquisition_register_consumer(struct acquisition_consumer *consumer)
+{
+	graph_consumer = consumer;
+}
+
+void test_main(void)
+{
+	ztest_test_suite(lcd_graph, ztest_unit_test(test_lcd_setup),
+			 ztest_unit_test(test_lcd_graph_ring),
+			 ztest_unit_test(test_lcd_graph_benchmark));
+
+	ztest_run_test_suite(lcd_graph);
+}